@@ -7,8 +7,15 @@ import android.support.constraint.solver.widgets.ConstraintWidgetContainer;
 import org.json.simple.JSONArray;
 import org.json.simple.JSONObject;
 import org.json.simple.parser.ParseException;
+import srl.inf.ethz.ch.proto.LayoutSolverProtos.LayoutConstraint;
+import srl.inf.ethz.ch.proto.LayoutSolverProtos.LayoutDimension;
+import srl.inf.ethz.ch.proto.LayoutSolverProtos.LayoutLocation;
+import srl.inf.ethz.ch.proto.LayoutSolverProtos.LayoutRequest;
+import srl.inf.ethz.ch.proto.LayoutSolverProtos.LayoutRequestView;
+import srl.inf.ethz.ch.proto.LayoutSolverProtos.LayoutResponse;
 
 import java.io.File;
+import java.util.ArrayList;
 import java.util.HashMap;
 import java.util.List;
 import java.util.Map;
@@ -335,4 +342,91 @@ public class LayoutUtil {
     }
 
 
+    private static ConstraintWidget ProtoToWidget(LayoutRequestView view) {
+        ConstraintWidget widget = new ConstraintWidget(view.getWidth().getValue(), view.getHeight().getValue());
+        widget.setHorizontalDimensionBehaviour(ProtoToBehaviour(view.getWidth()));
+        widget.setVerticalDimensionBehaviour(ProtoToBehaviour(view.getHeight()));
+        return widget;
+    }
+
+    private static ConstraintWidget.DimensionBehaviour ProtoToBehaviour(LayoutDimension dimension) {
+        switch (dimension.getBehaviour()) {
+            case MATCH_PARENT:
+                return ConstraintWidget.DimensionBehaviour.MATCH_PARENT;
+            case MATCH_CONSTRAINT:
+                return ConstraintWidget.DimensionBehaviour.MATCH_CONSTRAINT;
+            default:
+                return ConstraintWidget.DimensionBehaviour.FIXED;
+        }
+    }
+
+    private static ConstraintAnchor.Type ProtoToAnchor(LayoutConstraint.Anchor anchor) {
+        switch (anchor) {
+            case LEFT:
+                return ConstraintAnchor.Type.LEFT;
+            case TOP:
+                return ConstraintAnchor.Type.TOP;
+            case RIGHT:
+                return ConstraintAnchor.Type.RIGHT;
+            default:
+                return ConstraintAnchor.Type.BOTTOM;
+        }
+    }
+
+    private static LayoutLocation WidgetToProto(ConstraintWidget widget, int xOffset, int yOffset) {
+        return LayoutLocation.newBuilder()
+                .setX(widget.getLeft() + xOffset)
+                .setY(widget.getTop() + yOffset)
+                .setWidth(widget.getWidth())
+                .setHeight(widget.getHeight())
+                .build();
+    }
+
+    // Same as LayoutViews(JSONObject) but for requests sent as protobuf.
+    // Constraints reference their targets by position in the request, position 0 is the parent.
+    public static LayoutResponse LayoutViews(LayoutRequest request) {
+        List<ConstraintWidget> widgets = new ArrayList<>(request.getViewsCount());
+        for (LayoutRequestView view : request.getViewsList()) {
+            widgets.add(ProtoToWidget(view));
+        }
+
+        LayoutRequestView parent = request.getViews(0);
+        ConstraintWidget container = widgets.get(0);
+        ConstraintWidgetContainer root = new ConstraintWidgetContainer(
+                0,
+                0,
+                container.getWidth(),
+                container.getHeight());
+
+        container.setWidth(container.getWidth() - parent.getPaddingLeft() - parent.getPaddingRight());
+        container.setHeight(container.getHeight() - parent.getPaddingTop() - parent.getPaddingBottom());
+        root.add(container);
+        container.connect(ConstraintAnchor.Type.LEFT, root, ConstraintAnchor.Type.LEFT, parent.getPaddingLeft());
+        container.connect(ConstraintAnchor.Type.TOP, root, ConstraintAnchor.Type.TOP, parent.getPaddingTop());
+
+        for (int i = 1; i < widgets.size(); i++) {
+            LayoutRequestView view = request.getViews(i);
+            ConstraintWidget widget = widgets.get(i);
+            root.add(widget);
+
+            widget.setHorizontalBiasPercent(view.getHorizontalBias());
+            widget.setVerticalBiasPercent(view.getVerticalBias());
+            for (LayoutConstraint constraint : view.getConstraintsList()) {
+                widget.connect(ProtoToAnchor(constraint.getAnchor()), widgets.get(constraint.getTarget()),
+                        ProtoToAnchor(constraint.getTargetAnchor()), constraint.getMargin());
+            }
+        }
+
+        root.layout();
+
+        int xOffset = request.getXOffset();
+        int yOffset = request.getYOffset();
+        LayoutResponse.Builder response = LayoutResponse.newBuilder();
+        response.setContentFrame(WidgetToProto(root, xOffset, yOffset));
+        for (int i = 1; i < widgets.size(); i++) {
+            response.addComponents(WidgetToProto(widgets.get(i), xOffset, yOffset));
+        }
+        return response.build();
+    }
+
 }
@@ -10,8 +10,12 @@ import org.json.simple.JSONArray;
 import org.json.simple.JSONObject;
 import org.json.simple.parser.JSONParser;
 import org.json.simple.parser.ParseException;
+import srl.inf.ethz.ch.proto.LayoutSolverProtos.LayoutRequest;
+import srl.inf.ethz.ch.proto.LayoutSolverProtos.LayoutResponse;
 
+import java.io.File;
 import java.io.IOException;
+import java.io.InputStream;
 import java.io.InputStreamReader;
 import java.io.OutputStream;
 
@@ -23,13 +27,54 @@ import static srl.inf.ethz.ch.LayoutUtil.getField;
 
 public class NetworkServer {
 
+    static final String PROTOBUF_CONTENT_TYPE = "application/x-protobuf";
+
     private static void SetResponse(HttpExchange t, String data) throws IOException {
-        t.sendResponseHeaders(200, data.length());
+        SetResponse(t, data.getBytes());
+    }
+
+    private static void SetResponse(HttpExchange t, byte[] data) throws IOException {
+        t.sendResponseHeaders(200, data.length);
         OutputStream os = t.getResponseBody();
-        os.write(data.getBytes());
+        os.write(data);
         os.close();
     }
 
+    static boolean IsProtobufRequest(String contentType) {
+        return contentType != null && contentType.startsWith(PROTOBUF_CONTENT_TYPE);
+    }
+
+    static byte[] HandleProtobufRequest(InputStream body) {
+        LayoutResponse response;
+        try {
+            response = LayoutUtil.LayoutViews(LayoutRequest.parseFrom(body));
+        } catch (Exception e) {
+            e.printStackTrace();
+            response = LayoutResponse.newBuilder().setError(e.toString()).build();
+        }
+        return response.toByteArray();
+    }
+
+    // Returns null if the request could not be processed
+    static byte[] HandleJsonRequest(InputStream body) {
+        JSONParser parser = new JSONParser();
+        try {
+            JSONObject data = (JSONObject) parser.parse(new InputStreamReader(body, "UTF-8"));
+            System.out.println("Parsed Data:");
+            System.out.println(data.toJSONString());
+            JSONObject responseData = LayoutUtil.LayoutViews(data);
+            System.out.println("Writing Response:");
+            System.out.println(responseData.toJSONString());
+            return responseData.toJSONString().getBytes();
+        } catch (ParseException e) {
+            System.out.println("Parse Error!");
+            return "{\"error\": \"ParseException\"}".getBytes();
+        } catch (Exception e) {
+            e.printStackTrace();
+        }
+        return null;
+    }
+
     public static void main(String[] args) throws IOException {
         // create the command line parser
         CommandLineParser parser = new DefaultParser();
@@ -39,6 +84,7 @@ public class NetworkServer {
         options.addOption("help", "print this message");
         options.addOption("origin", true, "value of expected Access-Control-Allow-Origin field (e.g. 'http://inferui.com'). default: *");
         options.addOption("port", true, "server port. default: 9000");
+        options.addOption("socket", true, "listen on this unix domain socket path instead of the server port");
         CommandLine cmd = new CommandLine.Builder().build();
         try {
             cmd = parser.parse(options, args);
@@ -56,6 +102,11 @@ public class NetworkServer {
         final String ORIGIN = cmd.getOptionValue("origin", "*");
         final int port = Integer.parseInt(cmd.getOptionValue("port", "9100"));
 
+        if (cmd.hasOption("socket")) {
+            new UnixSocketServer(new File(cmd.getOptionValue("socket")), ORIGIN).run();
+            return;
+        }
+
         HttpServer server = HttpServer.create(new InetSocketAddress(port), 0);
         System.out.println("server started at " + port);
         server.createContext("/layout", new HttpHandler() {
@@ -75,22 +126,16 @@ public class NetworkServer {
                     System.out.println("request POST");
                     Headers headers = t.getResponseHeaders();
                     headers.add("Access-Control-Allow-Origin", ORIGIN);
+                    if (IsProtobufRequest(t.getRequestHeaders().getFirst("Content-Type"))) {
+                        headers.add("Content-Type", PROTOBUF_CONTENT_TYPE);
+                        SetResponse(t, HandleProtobufRequest(t.getRequestBody()));
+                        return;
+                    }
                     headers.add("Content-Type", "application/json");
 
-                    JSONParser parser = new JSONParser();
-                    try {
-                        JSONObject data = (JSONObject) parser.parse(new InputStreamReader(t.getRequestBody(), "UTF-8"));
-                        System.out.println("Parsed Data:");
-                        System.out.println(data.toJSONString());
-                        JSONObject responseData = LayoutUtil.LayoutViews(data);
-                        System.out.println("Writing Response:");
-                        System.out.println(responseData.toJSONString());
-                        SetResponse(t, responseData.toJSONString());
-                    } catch (ParseException e) {
-                        System.out.println("Parse Error!");
-                        SetResponse(t, "{\"error\": \"ParseException\"}");
-                    } catch (Exception e) {
-                        e.printStackTrace();
+                    byte[] response = HandleJsonRequest(t.getRequestBody());
+                    if (response != null) {
+                        SetResponse(t, response);
                     }
                     return;
                 }
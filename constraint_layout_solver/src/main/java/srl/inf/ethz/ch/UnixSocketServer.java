@@ -0,0 +1,150 @@
+package srl.inf.ethz.ch;
+
+
+import org.newsclub.net.unix.AFUNIXServerSocket;
+import org.newsclub.net.unix.AFUNIXSocketAddress;
+
+import java.io.BufferedInputStream;
+import java.io.BufferedOutputStream;
+import java.io.ByteArrayInputStream;
+import java.io.DataInputStream;
+import java.io.EOFException;
+import java.io.File;
+import java.io.IOException;
+import java.io.InputStream;
+import java.io.OutputStream;
+import java.net.Socket;
+import java.nio.charset.StandardCharsets;
+import java.util.HashMap;
+import java.util.Map;
+import java.util.concurrent.ExecutorService;
+import java.util.concurrent.Executors;
+
+
+/**
+ * Serves the /layout endpoint over a unix domain socket, for clients running on the same machine.
+ * Implements the small subset of HTTP/1.1 used by the InferUI client (POST with Content-Length and keep-alive).
+ */
+public class UnixSocketServer {
+
+    private final File socketFile;
+    private final String origin;
+    private final ExecutorService executor = Executors.newCachedThreadPool();
+
+    public UnixSocketServer(File socketFile, String origin) {
+        this.socketFile = socketFile;
+        this.origin = origin;
+    }
+
+    public void run() throws IOException {
+        // Remove stale socket left by a previous run, otherwise bind fails
+        socketFile.delete();
+        AFUNIXServerSocket server = AFUNIXServerSocket.newInstance();
+        server.bind(new AFUNIXSocketAddress(socketFile));
+        socketFile.deleteOnExit();
+        System.out.println("server started at " + socketFile);
+        while (!Thread.interrupted()) {
+            final Socket socket = server.accept();
+            executor.execute(new Runnable() {
+                @Override
+                public void run() {
+                    try {
+                        HandleConnection(socket);
+                    } catch (IOException e) {
+                        e.printStackTrace();
+                    } finally {
+                        try {
+                            socket.close();
+                        } catch (IOException e) {
+                            e.printStackTrace();
+                        }
+                    }
+                }
+            });
+        }
+    }
+
+    private void HandleConnection(Socket socket) throws IOException {
+        DataInputStream in = new DataInputStream(new BufferedInputStream(socket.getInputStream()));
+        OutputStream out = new BufferedOutputStream(socket.getOutputStream());
+        while (true) {
+            String requestLine = ReadLine(in);
+            if (requestLine == null) {
+                return;
+            }
+            if (requestLine.isEmpty()) {
+                continue;
+            }
+            String[] request = requestLine.split(" ");
+            Map<String, String> headers = new HashMap<>();
+            for (String line = ReadLine(in); line != null && !line.isEmpty(); line = ReadLine(in)) {
+                int separator = line.indexOf(':');
+                if (separator > 0) {
+                    headers.put(line.substring(0, separator).trim().toLowerCase(), line.substring(separator + 1).trim());
+                }
+            }
+            if ("100-continue".equalsIgnoreCase(headers.get("expect"))) {
+                // curl waits for this before sending larger request bodies
+                out.write("HTTP/1.1 100 Continue\r\n\r\n".getBytes(StandardCharsets.US_ASCII));
+                out.flush();
+            }
+            byte[] body = new byte[Integer.parseInt(headers.getOrDefault("content-length", "0"))];
+            in.readFully(body);
+
+            if (request.length < 2 || !request[1].startsWith("/layout")) {
+                WriteResponse(out, 404, null, new byte[0]);
+            } else if (request[0].equals("OPTIONS")) {
+                WriteResponse(out, 200, null, new byte[0]);
+            } else if (request[0].equals("POST")) {
+                if (NetworkServer.IsProtobufRequest(headers.get("content-type"))) {
+                    WriteResponse(out, 200, NetworkServer.PROTOBUF_CONTENT_TYPE,
+                            NetworkServer.HandleProtobufRequest(new ByteArrayInputStream(body)));
+                } else {
+                    byte[] response = NetworkServer.HandleJsonRequest(new ByteArrayInputStream(body));
+                    if (response != null) {
+                        WriteResponse(out, 200, "application/json", response);
+                    } else {
+                        WriteResponse(out, 500, null, new byte[0]);
+                    }
+                }
+            } else {
+                WriteResponse(out, 405, null, new byte[0]);
+            }
+
+            if ("close".equalsIgnoreCase(headers.get("connection"))) {
+                return;
+            }
+        }
+    }
+
+    private void WriteResponse(OutputStream out, int status, String contentType, byte[] data) throws IOException {
+        StringBuilder header = new StringBuilder();
+        header.append("HTTP/1.1 ").append(status).append(status == 200 ? " OK" : " Error").append("\r\n");
+        header.append("Access-Control-Allow-Origin: ").append(origin).append("\r\n");
+        if (contentType != null) {
+            header.append("Content-Type: ").append(contentType).append("\r\n");
+        }
+        header.append("Content-Length: ").append(data.length).append("\r\n\r\n");
+        out.write(header.toString().getBytes(StandardCharsets.US_ASCII));
+        out.write(data);
+        out.flush();
+    }
+
+    // Returns null at the end of the stream
+    private static String ReadLine(InputStream in) throws IOException {
+        StringBuilder line = new StringBuilder();
+        int c;
+        while ((c = in.read()) != '\n') {
+            if (c == -1) {
+                if (line.length() == 0) {
+                    return null;
+                }
+                throw new EOFException("Incomplete request");
+            }
+            if (c != '\r') {
+                line.append((char) c);
+            }
+        }
+        return line.toString();
+    }
+}
@@ -23,6 +23,7 @@
 #include <map>
 #include <glog/logging.h>
 #include <cmath>
+#include "base/metrics.h"
 
 typedef long long int64;
 typedef unsigned long long uint64;
@@ -57,6 +58,7 @@ public:
     return ((double)(GetCurrentTimeMicros() - time_)) / 1000.0;
   }
 
+  // Logs the runtime of each scope and records it in the "phase.<scope>_ms" histogram (see Metrics())
   void Dump() {
     int64 total = 0;
     for (const auto& entry : runtimes) {
@@ -64,6 +66,7 @@ public:
     }
     for (const auto& entry : runtimes) {
       LOG(INFO) << entry.first << ": " << std::round(entry.second / 1000.0) << "ms (" << std::round(entry.second * 100.0 / total) << "%)";
+      RecordLabeled("phase." + entry.first + "_ms", entry.second / 1000.0);
     }
   }
 
@@ -0,0 +1,121 @@
+/*
+   Copyright 2018 Software Reliability Lab, ETH Zurich
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#include "base/metrics.h"
+
+#include <algorithm>
+
+namespace {
+
+const std::string kNoLabel;
+thread_local const std::string* current_label = &kNoLabel;
+
+}  // namespace
+
+Histogram::Histogram() : count(0), sum(0), max(0), buckets(Bounds().size(), 0) {
+}
+
+const std::vector<double>& Histogram::Bounds() {
+  static const std::vector<double> bounds = [] {
+    std::vector<double> res;
+    for (double scale = 1; scale <= 1e9; scale *= 10) {
+      res.push_back(scale);
+      res.push_back(2 * scale);
+      res.push_back(5 * scale);
+    }
+    return res;
+  }();
+  return bounds;
+}
+
+void Histogram::Add(double value) {
+  const std::vector<double>& bounds = Bounds();
+  size_t bucket = std::lower_bound(bounds.begin(), bounds.end(), value) - bounds.begin();
+  buckets[std::min(bucket, bounds.size() - 1)]++;
+  max = (count == 0) ? value : std::max(max, value);
+  count++;
+  sum += value;
+}
+
+double Histogram::Percentile(double percentile) const {
+  if (count == 0) return 0;
+  int64_t rank = std::max<int64_t>(1, static_cast<int64_t>(count * percentile / 100.0 + 0.5));
+  int64_t seen = 0;
+  for (size_t i = 0; i < buckets.size(); i++) {
+    seen += buckets[i];
+    if (seen >= rank) {
+      // The last bucket has no upper bound
+      return (i + 1 == buckets.size()) ? max : std::min(Bounds()[i], max);
+    }
+  }
+  return max;
+}
+
+void MetricsRegistry::Increment(const std::string& name, int64_t delta) {
+  std::lock_guard<std::mutex> lock(mutex);
+  metrics.counters[name] += delta;
+}
+
+void MetricsRegistry::SetGauge(const std::string& name, double value) {
+  std::lock_guard<std::mutex> lock(mutex);
+  metrics.gauges[name] = value;
+}
+
+void MetricsRegistry::Record(const std::string& name, double value) {
+  std::lock_guard<std::mutex> lock(mutex);
+  metrics.histograms[name].Add(value);
+}
+
+MetricsRegistry::Snapshot MetricsRegistry::GetSnapshot() const {
+  std::lock_guard<std::mutex> lock(mutex);
+  return metrics;
+}
+
+void MetricsRegistry::Reset() {
+  std::lock_guard<std::mutex> lock(mutex);
+  metrics = Snapshot();
+}
+
+MetricsRegistry& Metrics() {
+  static MetricsRegistry* registry = new MetricsRegistry();
+  return *registry;
+}
+
+ScopedMetricsLabel::ScopedMetricsLabel(const std::string& label) : previous(current_label), label(label) {
+  current_label = &this->label;
+}
+
+ScopedMetricsLabel::~ScopedMetricsLabel() {
+  current_label = previous;
+}
+
+const std::string& ScopedMetricsLabel::Current() {
+  return *current_label;
+}
+
+void RecordLabeled(const std::string& name, double value) {
+  Metrics().Record(name, value);
+  if (!current_label->empty()) {
+    Metrics().Record(*current_label + "." + name, value);
+  }
+}
+
+void IncrementLabeled(const std::string& name, int64_t delta) {
+  Metrics().Increment(name, delta);
+  if (!current_label->empty()) {
+    Metrics().Increment(*current_label + "." + name, delta);
+  }
+}
@@ -0,0 +1,87 @@
+/*
+   Copyright 2018 Software Reliability Lab, ETH Zurich
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#ifndef BASE_METRICS_H_
+#define BASE_METRICS_H_
+
+#include <stdint.h>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Distribution of recorded values in exponential buckets with upper bounds 1, 2, 5, 10, 20, 50, ...
+class Histogram {
+public:
+  Histogram();
+
+  void Add(double value);
+
+  // Upper bound of the bucket containing the given percentile (0-100) of the values.
+  double Percentile(double percentile) const;
+
+  // Upper bounds of the buckets, values above the last bound are counted in the last bucket.
+  static const std::vector<double>& Bounds();
+
+  int64_t count;
+  double sum;
+  double max;
+  std::vector<int64_t> buckets;
+};
+
+// Process wide counters, gauges and histograms (e.g., latencies of the synthesis phases). Thread safe.
+class MetricsRegistry {
+public:
+  struct Snapshot {
+    std::map<std::string, int64_t> counters;
+    std::map<std::string, double> gauges;
+    std::map<std::string, Histogram> histograms;
+  };
+
+  void Increment(const std::string& name, int64_t delta = 1);
+  void SetGauge(const std::string& name, double value);
+  void Record(const std::string& name, double value);
+
+  Snapshot GetSnapshot() const;
+  void Reset();
+
+private:
+  mutable std::mutex mutex;
+  Snapshot metrics;
+};
+
+MetricsRegistry& Metrics();
+
+// Name of the synthesizer running on the current thread. Phase latencies and statuses recorded
+// during the lifetime of the object are also reported under this label.
+class ScopedMetricsLabel {
+public:
+  explicit ScopedMetricsLabel(const std::string& label);
+  ~ScopedMetricsLabel();
+
+  // Empty if there is no label
+  static const std::string& Current();
+
+private:
+  const std::string* previous;
+  const std::string label;
+};
+
+// Records the value under the name and, if there is a label, also under "<label>.<name>".
+void RecordLabeled(const std::string& name, double value);
+void IncrementLabeled(const std::string& name, int64_t delta = 1);
+
+#endif /* BASE_METRICS_H_ */
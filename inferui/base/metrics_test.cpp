@@ -0,0 +1,89 @@
+/*
+   Copyright 2018 Software Reliability Lab, ETH Zurich
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "glog/logging.h"
+
+#include "metrics.h"
+
+TEST(MetricsTest, HistogramPercentiles) {
+  Histogram histogram;
+  EXPECT_EQ(0, histogram.Percentile(50));
+  for (int i = 1; i <= 100; i++) {
+    histogram.Add(i);
+  }
+  EXPECT_EQ(100, histogram.count);
+  EXPECT_EQ(5050, histogram.sum);
+  EXPECT_EQ(100, histogram.max);
+  EXPECT_EQ(50, histogram.Percentile(50));
+  EXPECT_EQ(100, histogram.Percentile(90));
+  EXPECT_EQ(100, histogram.Percentile(100));
+
+  // Values above the last bound are counted in the last bucket
+  histogram.Add(1e12);
+  EXPECT_EQ(1, histogram.buckets.back());
+  EXPECT_EQ(1e12, histogram.Percentile(100));
+}
+
+TEST(MetricsTest, Labels) {
+  MetricsRegistry& metrics = Metrics();
+  metrics.Reset();
+  RecordLabeled("phase.solve_ms", 10);
+  {
+    ScopedMetricsLabel label("syn");
+    EXPECT_EQ("syn", ScopedMetricsLabel::Current());
+    RecordLabeled("phase.solve_ms", 20);
+    IncrementLabeled("status.SUCCESS");
+  }
+  EXPECT_EQ("", ScopedMetricsLabel::Current());
+
+  MetricsRegistry::Snapshot snapshot = metrics.GetSnapshot();
+  EXPECT_EQ(2, snapshot.histograms["phase.solve_ms"].count);
+  EXPECT_EQ(1, snapshot.histograms["syn.phase.solve_ms"].count);
+  EXPECT_EQ(20, snapshot.histograms["syn.phase.solve_ms"].max);
+  EXPECT_EQ(1, snapshot.counters["status.SUCCESS"]);
+  EXPECT_EQ(1, snapshot.counters["syn.status.SUCCESS"]);
+}
+
+TEST(MetricsTest, ConcurrentUpdates) {
+  MetricsRegistry& metrics = Metrics();
+  metrics.Reset();
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; t++) {
+    threads.emplace_back([t]() {
+      ScopedMetricsLabel label(t % 2 == 0 ? "even" : "odd");
+      for (int i = 0; i < 1000; i++) {
+        IncrementLabeled("requests");
+      }
+    });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  MetricsRegistry::Snapshot snapshot = metrics.GetSnapshot();
+  EXPECT_EQ(4000, snapshot.counters["requests"]);
+  EXPECT_EQ(2000, snapshot.counters["even.requests"]);
+  EXPECT_EQ(2000, snapshot.counters["odd.requests"]);
+}
+
+int main(int argc, char **argv) {
+  google::InstallFailureSignalHandler();
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
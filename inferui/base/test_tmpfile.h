@@ -0,0 +1,52 @@
+/*
+   Copyright 2018 Software Reliability Lab, ETH Zurich
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#ifndef BASE_TEST_TMPFILE_H_
+#define BASE_TEST_TMPFILE_H_
+
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <string>
+#include <vector>
+
+#include <glog/logging.h>
+#include "gtest/gtest.h"
+
+// Fixture of the tests that write to a file. path is an empty file with a unique name,
+// created in $TEST_TMPDIR (set by bazel test) or /tmp before each test and removed after it.
+class TempFileTest : public testing::Test {
+protected:
+  void SetUp() override {
+    const char* dir = getenv("TEST_TMPDIR");
+    std::string path_template = std::string((dir != nullptr && dir[0] != 0) ? dir : "/tmp") + "/" +
+        testing::UnitTest::GetInstance()->current_test_info()->test_case_name() + "XXXXXX";
+    std::vector<char> buffer(path_template.begin(), path_template.end());
+    buffer.push_back(0);
+    int fd = mkstemp(buffer.data());
+    CHECK_GE(fd, 0) << "Could not create a file for " << path_template;
+    close(fd);
+    path = buffer.data();
+  }
+
+  void TearDown() override {
+    unlink(path.c_str());
+  }
+
+  std::string path;
+};
+
+#endif /* BASE_TEST_TMPFILE_H_ */
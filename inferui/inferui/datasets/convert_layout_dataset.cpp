@@ -0,0 +1,49 @@
+/*
+   Copyright 2018 Software Reliability Lab, ETH Zurich
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#include <fstream>
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+
+#include "inferui/datasets/layout_dataset.h"
+
+DEFINE_string(input, "", "JSON dataset (one app per line) or binary layout dataset");
+DEFINE_string(output, "", "Converted dataset, binary if the input is JSON and JSON otherwise");
+
+int main(int argc, char** argv) {
+  google::InstallFailureSignalHandler();
+  google::ParseCommandLineFlags(&argc, &argv, true);
+  google::InitGoogleLogging(argv[0]);
+  CHECK(!FLAGS_input.empty() && !FLAGS_output.empty()) << "--input and --output must be set";
+
+  if (IsLayoutDatasetFile(FLAGS_input)) {
+    LayoutDataset dataset(FLAGS_input);
+    Json::FastWriter writer;
+    std::ofstream out_file(FLAGS_output);
+    CHECK(out_file.is_open()) << "Could not create " << FLAGS_output;
+    for (size_t i = 0; i < dataset.size(); i++) {
+      out_file << writer.write(dataset.ToJson(i));
+    }
+    out_file.close();
+    CHECK(!out_file.fail()) << "Could not write " << FLAGS_output;
+    LOG(INFO) << "Wrote " << dataset.size() << " apps to " << FLAGS_output;
+    return 0;
+  }
+
+  JsonToLayoutDataset(FLAGS_input, FLAGS_output);
+  return 0;
+}
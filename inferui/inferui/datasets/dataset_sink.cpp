@@ -0,0 +1,73 @@
+/*
+   Copyright 2018 Software Reliability Lab, ETH Zurich
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#include "dataset_sink.h"
+
+#include <glog/logging.h>
+
+#include "base/fileutil.h"
+#include "json_lines.h"
+
+OrderedDatasetSink::OrderedDatasetSink(const std::string& filename, bool resume, const std::string& key_field)
+    : next_index_(0), closed_(false) {
+  if (resume && FileExists(filename.c_str())) {
+    LoadExisting(filename, key_field);
+    out_.open(filename, std::ios::app);
+  } else {
+    out_.open(filename, std::ios::trunc);
+  }
+  CHECK(out_.is_open()) << "Could not open " << filename;
+}
+
+OrderedDatasetSink::~OrderedDatasetSink() {
+  Close();
+}
+
+void OrderedDatasetSink::LoadExisting(const std::string& filename, const std::string& key_field) {
+  for (const Json::Value& root : ReadJsonLines(filename, true)) {
+    existing_keys_.insert(root[key_field].asString());
+  }
+  LOG(INFO) << "Resuming " << filename << " with " << existing_keys_.size() << " apps";
+}
+
+void OrderedDatasetSink::Add(int64_t index, const Json::Value& value) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  CHECK(!closed_);
+  CHECK_GE(index, next_index_) << "Index added twice";
+  CHECK(pending_.emplace(index, value).second) << "Index added twice";
+
+  bool written = false;
+  for (auto it = pending_.begin(); it != pending_.end() && it->first == next_index_; it = pending_.erase(it)) {
+    if (!it->second.isNull()) {
+      out_ << writer_.write(it->second);
+      written = true;
+    }
+    next_index_++;
+  }
+  if (written) {
+    // Finished apps survive a crash of the generator
+    out_.flush();
+  }
+}
+
+void OrderedDatasetSink::Close() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (closed_) return;
+  closed_ = true;
+  CHECK(pending_.empty()) << "Missing result for input " << next_index_;
+  out_.close();
+  CHECK(!out_.fail()) << "Could not write the dataset";
+}
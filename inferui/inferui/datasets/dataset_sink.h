@@ -0,0 +1,88 @@
+/*
+   Copyright 2018 Software Reliability Lab, ETH Zurich
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#ifndef CC_SYNTHESIS_DATASET_SINK_H
+#define CC_SYNTHESIS_DATASET_SINK_H
+
+#include <stdint.h>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <unordered_set>
+
+#include "json/json.h"
+
+// Writes the apps of a generated dataset (one JSON value per line) while they are produced by a parallel loop.
+// The result of each input is added with its index and the results are written in the order of the indices
+// as soon as all the preceding ones are available, so only the out of order results are kept in memory.
+class OrderedDatasetSink {
+public:
+  // With resume the apps already in the file are kept and the new ones appended,
+  // key_field is the field identifying the app (e.g., "id" or "filename").
+  OrderedDatasetSink(const std::string& filename, bool resume, const std::string& key_field = "id");
+  ~OrderedDatasetSink();
+
+  // True if an app with the given key was written by a previous run.
+  bool Contains(const std::string& key) const {
+    return existing_keys_.count(key) > 0;
+  }
+
+  size_t num_existing() const {
+    return existing_keys_.size();
+  }
+
+  // Result of the index-th input, a null value if the input produced no app. Each index in [0, n) has to be added
+  // exactly once. Thread safe.
+  void Add(int64_t index, const Json::Value& value);
+
+  void Close();
+
+  // Adds the value set in the scope (or a null value) once the scope is left, also on continue.
+  class Slot {
+  public:
+    Slot(OrderedDatasetSink* sink, int64_t index) : sink_(sink), index_(index) {
+    }
+
+    ~Slot() {
+      sink_->Add(index_, value_);
+    }
+
+    void Set(const Json::Value& value) {
+      value_ = value;
+    }
+
+  private:
+    OrderedDatasetSink* sink_;
+    int64_t index_;
+    Json::Value value_;
+  };
+
+private:
+  void LoadExisting(const std::string& filename, const std::string& key_field);
+
+  std::unordered_set<std::string> existing_keys_;
+
+  std::mutex mutex_;
+  std::ofstream out_;
+  Json::FastWriter writer_;
+  int64_t next_index_;
+  // Results waiting for a preceding result
+  std::map<int64_t, Json::Value> pending_;
+  bool closed_;
+};
+
+#endif //CC_SYNTHESIS_DATASET_SINK_H
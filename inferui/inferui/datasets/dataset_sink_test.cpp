@@ -0,0 +1,124 @@
+/*
+   Copyright 2018 Software Reliability Lab, ETH Zurich
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#include <fstream>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "glog/logging.h"
+
+#include "base/fileutil.h"
+#include "base/strutil.h"
+#include "base/test_tmpfile.h"
+#include "inferui/datasets/dataset_sink.h"
+
+namespace {
+
+class DatasetSinkTest : public TempFileTest {
+protected:
+  std::vector<std::string> ReadIds() {
+    std::vector<std::string> lines;
+    SplitStringUsing(ReadFileToStringOrDie(path.c_str()), '\n', &lines, false);
+    std::vector<std::string> ids;
+    Json::Reader reader;
+    for (const std::string& line : lines) {
+      Json::Value root;
+      CHECK(reader.parse(line, root));
+      ids.push_back(root["id"].asString());
+    }
+    return ids;
+  }
+};
+
+Json::Value AppJson(int id) {
+  Json::Value value(Json::objectValue);
+  value["id"] = std::to_string(id);
+  return value;
+}
+
+}  // namespace
+
+TEST_F(DatasetSinkTest, WritesContiguousPrefix) {
+  OrderedDatasetSink sink(path, false);
+  sink.Add(1, AppJson(1));
+  sink.Add(2, Json::Value());
+  EXPECT_TRUE(ReadIds().empty());
+  sink.Add(0, AppJson(0));
+  // Written without waiting for the remaining results
+  EXPECT_EQ(std::vector<std::string>({"0", "1"}), ReadIds());
+  {
+    OrderedDatasetSink::Slot slot(&sink, 3);
+    slot.Set(AppJson(3));
+  }
+  sink.Close();
+  EXPECT_EQ(std::vector<std::string>({"0", "1", "3"}), ReadIds());
+}
+
+TEST_F(DatasetSinkTest, ParallelResultsInOrder) {
+  {
+    OrderedDatasetSink sink(path, false);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; t++) {
+      threads.emplace_back([&sink, t]() {
+        for (int i = 99 - t; i >= 0; i -= 4) {
+          OrderedDatasetSink::Slot slot(&sink, i);
+          if (i % 5 == 0) continue;
+          slot.Set(AppJson(i));
+        }
+      });
+    }
+    for (std::thread& thread : threads) {
+      thread.join();
+    }
+  }
+  std::vector<std::string> ids = ReadIds();
+  ASSERT_EQ(80u, ids.size());
+  std::vector<std::string> expected;
+  for (int i = 0; i < 100; i++) {
+    if (i % 5 != 0) expected.push_back(std::to_string(i));
+  }
+  EXPECT_EQ(expected, ids);
+}
+
+TEST_F(DatasetSinkTest, Resume) {
+  {
+    OrderedDatasetSink sink(path, false);
+    sink.Add(0, AppJson(0));
+    sink.Add(1, AppJson(1));
+  }
+  // Line cut off by a crash
+  {
+    std::ofstream out(path, std::ios::app);
+    out << "{\"id\": \"2\", \"scr";
+  }
+
+  OrderedDatasetSink sink(path, true);
+  EXPECT_EQ(2u, sink.num_existing());
+  EXPECT_TRUE(sink.Contains("1"));
+  EXPECT_FALSE(sink.Contains("2"));
+  sink.Add(0, Json::Value());
+  sink.Add(1, Json::Value());
+  sink.Add(2, AppJson(2));
+  sink.Close();
+  EXPECT_EQ(std::vector<std::string>({"0", "1", "2"}), ReadIds());
+}
+
+int main(int argc, char **argv) {
+  google::InstallFailureSignalHandler();
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
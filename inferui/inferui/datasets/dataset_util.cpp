@@ -20,11 +20,17 @@
 #include "inferui/model/syn_helper.h"
 #include "inferui/eval/eval_app_util.h"
 #include "inferui/eval/eval_util.h"
+#include "inferui/datasets/eval_journal.h"
+#include "util/thread/cost_scheduler.h"
 
 #include <glog/logging.h>
 
 DEFINE_bool(fix_inconsistencies, true, "Iterate with Normalize and TryFixInconsistencies tricks.");
 DEFINE_bool(base_syn_fallback, true, "Fallback to baseline synthesizer if the synthesis fails.");
+DEFINE_int32(shard_index, 0, "Index of the apps evaluated by this process, in [0, --num_shards).");
+DEFINE_int32(num_shards, 1, "Number of processes evaluating disjoint subsets of the apps.");
+DEFINE_int32(eval_threads, 0, "Number of threads evaluating apps, 0 for one per core.");
+DEFINE_string(cost_history, "", "File with the solve times of the apps, used to start the most expensive apps first.");
 
 void PropertyStats::Add(const Orientation& orientation, bool correct) {
   values[orientation].first++;
@@ -42,6 +48,23 @@ void PropertyStats::AddView(bool correct_horizontal, bool correct_vertical) {
   total++;
 }
 
+void PropertyStats::Merge(const PropertyStats& other) {
+  for (const auto& it : other.values) {
+    values[it.first].first += it.second.first;
+    values[it.first].second += it.second.second;
+  }
+  total += other.total;
+  fully_correct += other.fully_correct;
+  total_apps += other.total_apps;
+  success_apps += other.success_apps;
+  inconsistent_apps += other.inconsistent_apps;
+  failed_syn_apps += other.failed_syn_apps;
+  unsat_apps += other.unsat_apps;
+  timeout_apps += other.timeout_apps;
+  fixed_views += other.fixed_views;
+  total_views += other.total_views;
+}
+
 void PropertyStats::Dump() const {
   LOG(INFO) << "Fully Correct: " << fully_correct << " / " << total << " (" << (fully_correct * 100.0 / total) << "%)";
   for (const Orientation& orientation : {Orientation::HORIZONTAL, Orientation::VERTICAL}) {
@@ -58,6 +81,53 @@ void PropertyStats::Dump() const {
             << " (" << (fixed_views * 100.0 / total_views) << "%)";
 }
 
+Json::Value PropertyStats::ToJson() const {
+  Json::Value json;
+  json["horizontal"].append(values.at(Orientation::HORIZONTAL).first);
+  json["horizontal"].append(values.at(Orientation::HORIZONTAL).second);
+  json["vertical"].append(values.at(Orientation::VERTICAL).first);
+  json["vertical"].append(values.at(Orientation::VERTICAL).second);
+  json["total"] = total;
+  json["fully_correct"] = fully_correct;
+  json["total_apps"] = total_apps;
+  json["success_apps"] = success_apps;
+  json["inconsistent_apps"] = inconsistent_apps;
+  json["failed_syn_apps"] = failed_syn_apps;
+  json["unsat_apps"] = unsat_apps;
+  json["timeout_apps"] = timeout_apps;
+  json["fixed_views"] = fixed_views;
+  json["total_views"] = total_views;
+  return json;
+}
+
+PropertyStats PropertyStats::FromJson(const Json::Value& json) {
+  PropertyStats stats;
+  stats.values[Orientation::HORIZONTAL] = std::make_pair(json["horizontal"][0].asInt(), json["horizontal"][1].asInt());
+  stats.values[Orientation::VERTICAL] = std::make_pair(json["vertical"][0].asInt(), json["vertical"][1].asInt());
+  stats.total = json["total"].asInt();
+  stats.fully_correct = json["fully_correct"].asInt();
+  stats.total_apps = json["total_apps"].asInt();
+  stats.success_apps = json["success_apps"].asInt();
+  stats.inconsistent_apps = json["inconsistent_apps"].asInt();
+  stats.failed_syn_apps = json["failed_syn_apps"].asInt();
+  stats.unsat_apps = json["unsat_apps"].asInt();
+  stats.timeout_apps = json["timeout_apps"].asInt();
+  stats.fixed_views = json["fixed_views"].asInt();
+  stats.total_views = json["total_views"].asInt();
+  return stats;
+}
+
+std::string AppKey(const JsonDataset& dataset, size_t i) {
+  return StringPrintf("%d:%s", dataset.app_id(i), dataset.filename(i).c_str());
+}
+
+std::string ShardSuffix() {
+  if (FLAGS_num_shards == 1) {
+    return "";
+  }
+  return StringPrintf(".shard-%d-of-%d", FLAGS_shard_index, FLAGS_num_shards);
+}
+
 bool ViewsInsideScreen(const App& app) {
   const View& root = app.GetViews()[0];
   for (const View& view : app.GetViews()) {
@@ -72,12 +142,13 @@ bool ViewsInsideScreen(const App& app) {
 
 App LayoutResizeApp(App resized_syn_app, const Device& ref_device, const Device& device, Solver& solver) {
   TryResizeView(resized_syn_app, resized_syn_app.GetViews()[0], ref_device, device);
-  return JsonToApp(solver.sendPost(resized_syn_app.ToJSON()));
+  return RenderApp(resized_syn_app, solver);
 }
 
 bool ComputeGeneralization(const App& ref_app, const App& syn_app,
                            const Device& ref_device, Device device,
-                           Solver& solver, PropertyStats* stats) {
+                           Solver& solver, PropertyStats* stats,
+                           std::vector<std::pair<bool, bool>>* views) {
   App resized_syn_app = LayoutResizeApp(syn_app, ref_device, device, solver);
 
   bool correct = true;
@@ -85,13 +156,13 @@ bool ComputeGeneralization(const App& ref_app, const App& syn_app,
     const View& src_view = ref_app.GetViews()[j];
     const View& syn_view = resized_syn_app.GetViews()[j];
 
-    stats->AddView(
-        src_view.xleft == syn_view.xleft && src_view.xright == syn_view.xright,
-        src_view.ytop == syn_view.ytop && src_view.ybottom == syn_view.ybottom
-    );
-    correct = correct &&
-              src_view.xleft == syn_view.xleft && src_view.xright == syn_view.xright &&
-              src_view.ytop == syn_view.ytop && src_view.ybottom == syn_view.ybottom;
+    bool correct_horizontal = src_view.xleft == syn_view.xleft && src_view.xright == syn_view.xright;
+    bool correct_vertical = src_view.ytop == syn_view.ytop && src_view.ybottom == syn_view.ybottom;
+    stats->AddView(correct_horizontal, correct_vertical);
+    if (views != nullptr) {
+      views->emplace_back(correct_horizontal, correct_vertical);
+    }
+    correct = correct && correct_horizontal && correct_vertical;
   }
   return correct;
 }
@@ -107,7 +178,6 @@ PropertyStats DatasetIterators::ForEachApp(
     int num_samples) const {
 
   PropertyStats stats;
-  Solver solver;
 
   std::unique_ptr<GenSmtMultiDeviceProbOpt> synthesizer;
   if (FLAGS_base_syn_fallback) {
@@ -115,25 +185,73 @@ PropertyStats DatasetIterators::ForEachApp(
     synthesizer = std::unique_ptr<GenSmtMultiDeviceProbOpt>(new GenSmtMultiDeviceProbOpt(true));
   }
 
-  std::atomic<int> total_apps(0), success_apps(0), inconsistent_apps(0), unsat_apps(0), timeout_apps(0), failed_syn_apps(0);
-
-  const auto json_apps = JsonAppSerializer::readFile(path);
+  // Parsed only once per process and shared by all the experiments
+  std::shared_ptr<const JsonDataset> dataset = JsonDataset::Load(path);
   // Collect apps which should be evaluated first to ensure that the parallelization is efficient
-  std::vector<int> valid_ids = CollectValidIds(json_apps, contains_sample_cb, num_samples);
+  std::vector<int> valid_ids = CollectValidIds(*dataset, contains_sample_cb, num_samples);
+
+  if (FLAGS_num_shards > 1) {
+    CHECK(FLAGS_shard_index >= 0 && FLAGS_shard_index < FLAGS_num_shards) << "Invalid --shard_index";
+    // Every num_shards-th app, apps of similar size are next to each other in the datasets
+    std::vector<int> shard_ids;
+    for (size_t i = FLAGS_shard_index; i < valid_ids.size(); i += FLAGS_num_shards) {
+      shard_ids.push_back(valid_ids[i]);
+    }
+    LOG(INFO) << "Shard " << FLAGS_shard_index << " of " << FLAGS_num_shards << ": "
+              << shard_ids.size() << " / " << valid_ids.size() << " apps";
+    valid_ids = shard_ids;
+  }
+
+  // Apps evaluated by a previous run are taken from the journal
+  std::unique_ptr<EvaluationJournal> journal;
+  if (!journal_file_.empty()) {
+    journal.reset(new EvaluationJournal(journal_file_, resume_));
+    std::vector<int> remaining_ids;
+    for (int id : valid_ids) {
+      const Json::Value* record = journal->Find(AppKey(*dataset, id));
+      if (record != nullptr) {
+        stats.Merge(PropertyStats::FromJson((*record)["stats"]));
+      } else {
+        remaining_ids.push_back(id);
+      }
+    }
+    if (remaining_ids.size() != valid_ids.size()) {
+      LOG(INFO) << "Skipping " << (valid_ids.size() - remaining_ids.size()) << " apps evaluated by a previous run";
+    }
+    valid_ids = remaining_ids;
+  }
+
+  // Counts used to report the progress, the statistics of each app are collected separately
+  std::atomic<int> total_apps(stats.total_apps), success_apps(stats.success_apps),
+      inconsistent_apps(stats.inconsistent_apps), failed_syn_apps(stats.failed_syn_apps);
+
+  // Apps are started in the order of decreasing predicted cost (the solve time of previous runs with --cost_history,
+  // otherwise the number of views) so that the run does not end with a single thread solving an expensive app
+  std::vector<std::string> app_keys;
+  std::vector<double> costs;
+  for (int id : valid_ids) {
+    app_keys.push_back(AppKey(*dataset, id));
+    costs.push_back(dataset->num_views(id));
+  }
+  std::unique_ptr<TaskCostHistory> cost_history;
+  if (!FLAGS_cost_history.empty()) {
+    cost_history.reset(new TaskCostHistory(FLAGS_cost_history));
+    costs = cost_history->PredictCosts(app_keys, costs);
+  }
 
-  std::mutex mutex;
-#pragma omp parallel for private(solver) schedule(guided) //reduction(plusstats : correct_view_rank)
-  for (size_t i = 0; i < valid_ids.size(); i++) {
-    const auto &root = json_apps[valid_ids[i]];
+  // Evaluates the i-th app, its statistics are added to app_stats and its results to record
+  auto evaluate_app = [&](size_t i, Solver& solver, PropertyStats* app_stats, Json::Value* record) {
+    const DatasetApp& sample = (*dataset)[valid_ids[i]];
 
     Timer timer;
     timer.Start();
 
-    std::vector<App> apps;
-    App app = App();
-    Device ref_device = Device(0, 0);
-    std::vector<Device> devices;
-    int app_idx = JsonAppSerializer::JsonToApps(root, app, apps, ref_device, devices);
+    // The callback can modify the app
+    App app = sample.app;
+    const std::vector<App>& apps = sample.apps;
+    const Device& ref_device = sample.ref_device;
+    const std::vector<Device>& devices = sample.devices;
+    int app_idx = sample.app_id;
 
     CHECK(contains_sample_cb(app, app_idx)) << "CollectValidIds is expect to return only valid apps!";
 
@@ -141,19 +259,23 @@ PropertyStats DatasetIterators::ForEachApp(
     PrintApp(app, false);
 
     total_apps++;
+    app_stats->total_apps++;
     auto res = cb(app, apps, ref_device, devices, app_idx);
+    (*record)["status"] = StatusStr(res.status);
+    (*record)["synthesis_ms"] = timer.GetMilliSeconds();
 
     // Stats
     if (res.status != Status::SUCCESS) {
-      LOG(INFO) << "Unsuccessful " << root["filename"].asString();
+      LOG(INFO) << "Unsuccessful " << sample.filename;
       LOG(INFO) << "Success: " << success_apps << " / " << total_apps;
       LOG(INFO) << "#Views: " << app.GetViews().size();
       LOG(INFO) << "Took " << std::round(timer.GetMilliSeconds()/1000) << "s";
       failed_syn_apps++;
+      app_stats->failed_syn_apps++;
       if (res.status == Status::TIMEOUT) {
-    	  timeout_apps++;
+    	  app_stats->timeout_apps++;
       } else if (res.status == Status::UNSAT) {
-        unsat_apps++;
+        app_stats->unsat_apps++;
       }
       if (FLAGS_base_syn_fallback) {
         // to make the numbers in evaluation comparable among different models, they should all succeed
@@ -163,11 +285,12 @@ PropertyStats DatasetIterators::ForEachApp(
         CHECK(synthesizer);
         std::vector<App> input_apps;
         res = synthesizer->SynthesizeMultipleAppsSingleQuery(std::move(app), input_apps);
+        (*record)["fallback_status"] = StatusStr(res.status);
         if (res.status != Status::SUCCESS) {
-          continue;
+          return;
         }
       } else {
-        continue;
+        return;
       }
     }
 
@@ -178,6 +301,8 @@ PropertyStats DatasetIterators::ForEachApp(
         LOG(INFO) << "#Views: " << res.app.GetViews().size();
         LOG(INFO) << "Took " << std::round(timer.GetMilliSeconds()/1000) << "s";
         inconsistent_apps++;
+        app_stats->inconsistent_apps++;
+        (*record)["inconsistent"] = true;
       }
 
       NormalizeMargins(&res.app, solver);
@@ -186,58 +311,89 @@ PropertyStats DatasetIterators::ForEachApp(
     LOG(INFO) << "Synthesized App:";
     LOG(INFO) << res.app.ToJSON();
 
-    {
-      std::lock_guard<std::mutex> lock(mutex);
-
-      for (size_t device_id = 0; device_id < devices.size(); device_id++) {
-        const auto &device = devices[device_id];
-        const App &resized_app = apps[device_id];
-        if (!ComputeGeneralization(resized_app, res.app, ref_device, device, solver, &stats)) {
-          LOG(INFO) << "Synthesized Layout does not match Reference Android Layout Renderer";
-          LOG(INFO) << "Success: " << success_apps << " / " << total_apps;
-          LOG(INFO) << "#Views: " << res.app.GetViews().size();
-          LOG(INFO) << "Took " << std::round(timer.GetMilliSeconds()/1000) << "s";
-        }
+    for (size_t device_id = 0; device_id < devices.size(); device_id++) {
+      const auto &device = devices[device_id];
+      const App &resized_app = apps[device_id];
+      std::vector<std::pair<bool, bool>> views;
+      bool correct = ComputeGeneralization(resized_app, res.app, ref_device, device, solver, app_stats, &views);
+      if (!correct) {
+        LOG(INFO) << "Synthesized Layout does not match Reference Android Layout Renderer";
+        LOG(INFO) << "Success: " << success_apps << " / " << total_apps;
+        LOG(INFO) << "#Views: " << res.app.GetViews().size();
+        LOG(INFO) << "Took " << std::round(timer.GetMilliSeconds()/1000) << "s";
       }
 
+      // Correctness of each view as a string of 0/1, e.g. "0110"
+      Json::Value device_result;
+      device_result["width"] = device.width;
+      device_result["height"] = device.height;
+      device_result["correct"] = correct;
+      std::string horizontal, vertical;
+      for (const auto& view : views) {
+        horizontal.push_back(view.first ? '1' : '0');
+        vertical.push_back(view.second ? '1' : '0');
+      }
+      device_result["horizontal"] = horizontal;
+      device_result["vertical"] = vertical;
+      (*record)["devices"].append(device_result);
     }
 
     success_apps++;
+    app_stats->success_apps++;
     LOG(INFO) << "Success: " << success_apps << " / " << total_apps;
     LOG(INFO) << "#Views: " << res.app.GetViews().size();
     LOG(INFO) << "Took " << std::round(timer.GetMilliSeconds()/1000) << "s";
-  }
+  };
 
-  LOG(INFO) << "Success: " << success_apps << " / " << total_apps;
-  LOG(INFO) << "Inconsistent:" << inconsistent_apps;
-  LOG(INFO) << "Failed Synthesis:" << failed_syn_apps;
+  // Each thread renders with its own solver and collects its own statistics, they are merged at the end
+  CostScheduler scheduler(FLAGS_eval_threads);
+  std::vector<Solver> solvers(scheduler.num_threads());
+  std::vector<PropertyStats> thread_stats(scheduler.num_threads());
+  std::vector<ThreadUtilization> utilization = scheduler.Run(costs, [&](size_t i, int thread) {
+    Timer timer;
+    timer.Start();
+    PropertyStats app_stats;
+    Json::Value record;
+    evaluate_app(i, solvers[thread], &app_stats, &record);
+    double elapsed_ms = timer.GetMilliSeconds();
+    thread_stats[thread].Merge(app_stats);
+    if (cost_history) {
+      cost_history->Set(app_keys[i], elapsed_ms);
+    }
+    if (journal) {
+      record["key"] = app_keys[i];
+      record["app_id"] = dataset->app_id(valid_ids[i]);
+      record["filename"] = dataset->filename(valid_ids[i]);
+      record["num_views"] = static_cast<int>(dataset->num_views(valid_ids[i]));
+      record["total_ms"] = elapsed_ms;
+      record["stats"] = app_stats.ToJson();
+      journal->Append(record);
+    }
+  });
+  for (const PropertyStats& value : thread_stats) {
+    stats.Merge(value);
+  }
+  CostScheduler::LogUtilization(utilization);
+  if (cost_history) {
+    cost_history->Save();
+  }
 
-  stats.total_apps = total_apps;
-  stats.success_apps = success_apps;
-  stats.inconsistent_apps = inconsistent_apps;
-  stats.failed_syn_apps = failed_syn_apps;
-  stats.unsat_apps = unsat_apps;
-  stats.timeout_apps = timeout_apps;
+  LOG(INFO) << "Success: " << stats.success_apps << " / " << stats.total_apps;
+  LOG(INFO) << "Inconsistent:" << stats.inconsistent_apps;
+  LOG(INFO) << "Failed Synthesis:" << stats.failed_syn_apps;
   return stats;
 }
 
-std::vector<int> DatasetIterators::CollectValidIds(const std::vector<Json::Value>& json_apps,
+std::vector<int> DatasetIterators::CollectValidIds(const JsonDataset& dataset,
                                  const std::function<bool(const App&, int)>& contains_sample_cb,
                                  int num_samples) const {
   std::vector<int> valid_ids;
-  for (size_t app_id = 0; app_id < json_apps.size(); app_id++) {
+  for (size_t app_id = 0; app_id < dataset.size(); app_id++) {
     if (num_samples != -1 && static_cast<int>(valid_ids.size()) >= num_samples) {
       break;
     }
-    const auto &root = json_apps[app_id];
-
-    std::vector<App> apps;
-    App app = App();
-    Device ref_device = Device(0, 0);
-    std::vector<Device> devices;
-    int app_idx = JsonAppSerializer::JsonToApps(root, app, apps, ref_device, devices);
-
-    if (!contains_sample_cb(app, app_idx)) {
+    const DatasetApp& sample = dataset[app_id];
+    if (!contains_sample_cb(sample.app, sample.app_id)) {
       continue;
     }
     valid_ids.push_back(app_id);
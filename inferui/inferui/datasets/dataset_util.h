@@ -24,8 +24,12 @@
 #include "inferui/synthesis/z3inference.h"
 #include "inferui/layout_solver/solver.h"
 #include "inferui/eval/eval_util.h"
+#include "inferui/datasets/json_dataset.h"
+#include "json/json.h"
 
 DECLARE_bool(base_syn_fallback);
+DECLARE_int32(shard_index);
+DECLARE_int32(num_shards);
 
 struct PropertyStats {
 public:
@@ -41,8 +45,14 @@ public:
 
   void AddView(bool correct_horizontal, bool correct_vertical);
 
+  // Adds the counts of other, used to combine the statistics collected by each thread.
+  void Merge(const PropertyStats& other);
+
   void Dump() const;
 
+  Json::Value ToJson() const;
+  static PropertyStats FromJson(const Json::Value& json);
+
 private:
   std::map<Orientation, std::pair<int, int>> values;
   int total, fully_correct;
@@ -52,6 +62,12 @@ public:
   int fixed_views, total_views;
 };
 
+// Key of the app in the evaluation journal.
+std::string AppKey(const JsonDataset& dataset, size_t i);
+
+// Suffix of the files written by the current shard (e.g., ".shard-2-of-8"), empty if the evaluation is not sharded.
+std::string ShardSuffix();
+
 bool ViewsInsideScreen(const App& app);
 
 enum DatasetType {
@@ -65,6 +81,14 @@ class DatasetIterators {
 
 public:
 
+  // The result of each app is appended to journal_file as soon as it is evaluated (see EvaluationJournal).
+  // With resume the apps already in the journal are not evaluated again and their results are included
+  // in the returned statistics.
+  void SetJournal(const std::string& journal_file, bool resume) {
+    journal_file_ = journal_file;
+    resume_ = resume;
+  }
+
   PropertyStats ForEachApp(
       const std::string& path,
       const std::function<bool(const App&, int)>& contains_sample_cb,
@@ -173,15 +197,20 @@ public:
   }
 
 private:
-  std::vector<int> CollectValidIds(const std::vector<Json::Value>& json_apps,
+  std::vector<int> CollectValidIds(const JsonDataset& dataset,
                                    const std::function<bool(const App&, int)>& contains_sample_cb,
                                    int num_samples = -1) const;
+
+  std::string journal_file_;
+  bool resume_ = false;
 };
 
 
+// If views is set, the correctness of each view (horizontal, vertical) is added to it.
 bool ComputeGeneralization(const App& ref_app, const App& syn_app,
                            const Device& ref_device, Device device,
-                           Solver& solver, PropertyStats* stats);
+                           Solver& solver, PropertyStats* stats,
+                           std::vector<std::pair<bool, bool>>* views = nullptr);
 
 
 
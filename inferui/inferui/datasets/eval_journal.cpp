@@ -0,0 +1,52 @@
+/*
+   Copyright 2018 Software Reliability Lab, ETH Zurich
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#include "eval_journal.h"
+
+#include <glog/logging.h>
+
+#include "base/fileutil.h"
+#include "json_lines.h"
+
+EvaluationJournal::EvaluationJournal(const std::string& filename, bool resume) {
+  if (resume && FileExists(filename.c_str())) {
+    // A line cut off by a crash is removed before appending
+    for (const Json::Value& record : ReadJsonLines(filename, true)) {
+      existing_[record["key"].asString()] = record;
+    }
+    LOG(INFO) << "Resuming " << filename << " with " << existing_.size() << " apps";
+    out_.open(filename, std::ios::app);
+  } else {
+    out_.open(filename, std::ios::trunc);
+  }
+  CHECK(out_.is_open()) << "Could not open " << filename;
+}
+
+const Json::Value* EvaluationJournal::Find(const std::string& key) const {
+  auto it = existing_.find(key);
+  return (it == existing_.end()) ? nullptr : &it->second;
+}
+
+void EvaluationJournal::Append(const Json::Value& record) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  out_ << writer_.write(record);
+  out_.flush();
+  CHECK(!out_.fail()) << "Could not write the journal";
+}
+
+std::vector<Json::Value> EvaluationJournal::ReadRecords(const std::string& filename) {
+  return ReadJsonLines(filename, false);
+}
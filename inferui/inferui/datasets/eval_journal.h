@@ -0,0 +1,58 @@
+/*
+   Copyright 2018 Software Reliability Lab, ETH Zurich
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#ifndef CC_SYNTHESIS_EVAL_JOURNAL_H
+#define CC_SYNTHESIS_EVAL_JOURNAL_H
+
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "json/json.h"
+
+// Results of an evaluation with one JSON object per app and line. Each result is appended as soon as the app
+// is evaluated, so the results of an interrupted run are kept and the run can be resumed.
+// Records are identified by their "key" field.
+class EvaluationJournal {
+public:
+  // With resume the records already in the file are loaded and the new ones appended,
+  // otherwise the file is truncated.
+  EvaluationJournal(const std::string& filename, bool resume);
+
+  // Record of the given key written by a previous run or nullptr.
+  const Json::Value* Find(const std::string& key) const;
+
+  size_t num_existing() const {
+    return existing_.size();
+  }
+
+  // Thread safe.
+  void Append(const Json::Value& record);
+
+  // Records of a journal in the order they were written, a line cut off by a crash is ignored.
+  static std::vector<Json::Value> ReadRecords(const std::string& filename);
+
+private:
+  std::unordered_map<std::string, Json::Value> existing_;
+
+  std::mutex mutex_;
+  std::ofstream out_;
+  Json::FastWriter writer_;
+};
+
+#endif //CC_SYNTHESIS_EVAL_JOURNAL_H
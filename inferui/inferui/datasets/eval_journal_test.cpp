@@ -0,0 +1,105 @@
+/*
+   Copyright 2018 Software Reliability Lab, ETH Zurich
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#include <fstream>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "glog/logging.h"
+
+#include "base/fileutil.h"
+#include "base/test_tmpfile.h"
+#include "inferui/datasets/eval_journal.h"
+
+namespace {
+
+class EvaluationJournalTest : public TempFileTest {
+protected:
+  static Json::Value Record(const std::string& key, double total_ms) {
+    Json::Value record;
+    record["key"] = key;
+    record["total_ms"] = total_ms;
+    return record;
+  }
+};
+
+TEST_F(EvaluationJournalTest, ConcurrentAppend) {
+  {
+    EvaluationJournal journal(path, false);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; t++) {
+      threads.emplace_back([&journal, t]() {
+        for (int i = 0; i < 50; i++) {
+          journal.Append(Record(std::to_string(t * 50 + i), i));
+        }
+      });
+    }
+    for (std::thread& thread : threads) {
+      thread.join();
+    }
+  }
+  std::vector<Json::Value> records = EvaluationJournal::ReadRecords(path);
+  ASSERT_EQ(200, records.size());
+  std::vector<bool> seen(200, false);
+  for (const Json::Value& record : records) {
+    seen[std::stoi(record["key"].asString())] = true;
+  }
+  for (size_t i = 0; i < seen.size(); i++) {
+    EXPECT_TRUE(seen[i]) << i;
+  }
+}
+
+TEST_F(EvaluationJournalTest, ResumeDropsIncompleteLine) {
+  {
+    EvaluationJournal journal(path, false);
+    journal.Append(Record("a", 10));
+    journal.Append(Record("b", 20));
+  }
+  {
+    // Simulates a crash while writing a record
+    std::ofstream out(path, std::ios::app);
+    out << "{\"key\":\"c\",\"tot";
+  }
+  EXPECT_EQ(2, EvaluationJournal::ReadRecords(path).size());
+
+  {
+    EvaluationJournal journal(path, true);
+    EXPECT_EQ(2, journal.num_existing());
+    ASSERT_NE(nullptr, journal.Find("b"));
+    EXPECT_EQ(20, (*journal.Find("b"))["total_ms"].asDouble());
+    EXPECT_EQ(nullptr, journal.Find("c"));
+    journal.Append(Record("c", 30));
+  }
+  std::vector<Json::Value> records = EvaluationJournal::ReadRecords(path);
+  ASSERT_EQ(3, records.size());
+  EXPECT_EQ("c", records[2]["key"].asString());
+
+  // Without resume the journal starts empty
+  {
+    EvaluationJournal journal(path, false);
+    EXPECT_EQ(0, journal.num_existing());
+  }
+  EXPECT_EQ(0, EvaluationJournal::ReadRecords(path).size());
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  google::InstallFailureSignalHandler();
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,202 @@
+/*
+   Copyright 2018 Software Reliability Lab, ETH Zurich
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#include "json_dataset.h"
+
+#include <sys/stat.h>
+
+#include <fstream>
+#include <map>
+#include <mutex>
+
+#include <glog/logging.h>
+
+#include "base/fileutil.h"
+#include "base/strutil.h"
+#include "inferui/model/syn_helper.h"
+
+DEFINE_bool(dataset_cache, true, "Store the parsed JSON datasets in a binary cache file next to the dataset.");
+
+namespace {
+
+void ScreenToProto(const App& app, const Device& device, DatasetScreenProto* screen) {
+  screen->set_width(device.width);
+  screen->set_height(device.height);
+  for (const View& view : app.GetViews()) {
+    if (view.is_content_frame()) continue;
+    screen->add_views(view.xleft);
+    screen->add_views(view.ytop);
+    screen->add_views(view.xright);
+    screen->add_views(view.ybottom);
+  }
+}
+
+// Same views as CuJsonToAppRaw creates from the JSON screen
+App ProtoToApp(const DatasetScreenProto& screen) {
+  App app;
+  app.AddView(View(0, 0, screen.width(), screen.height(), "parent", 0, "parent"));
+  for (int i = 0; i + 3 < screen.views_size(); i += 4) {
+    app.AddView(View(screen.views(i), screen.views(i + 1), screen.views(i + 2), screen.views(i + 3),
+                     "frog", i / 4 + 1, "frog"));
+  }
+  std::vector<bool> resizable(2, true);
+  app.setResizable(resizable);
+  return app;
+}
+
+}  // namespace
+
+JsonDataset::JsonDataset(const std::string& path, const std::string& cache_path) {
+  Timer timer;
+  timer.Start();
+  if (IsLayoutDatasetFile(path)) {
+    layout_.reset(new LayoutDataset(path));
+    LOG(INFO) << "Mapped " << size() << " apps from " << path << " in " << timer.GetMilliSeconds() << "ms";
+    return;
+  }
+  const std::string data_version = DataVersion(path);
+  if (!cache_path.empty() && LoadCache(cache_path, data_version)) {
+    LOG(INFO) << "Loaded " << size() << " apps from " << cache_path << " in " << timer.GetMilliSeconds() << "ms";
+    return;
+  }
+  ParseJson(path);
+  LOG(INFO) << "Parsed " << size() << " apps from " << path << " in " << timer.GetMilliSeconds() << "ms";
+  if (!cache_path.empty()) {
+    SaveCache(cache_path, data_version);
+  }
+}
+
+std::shared_ptr<const JsonDataset> JsonDataset::Load(const std::string& path) {
+  static std::mutex mutex;
+  static std::map<std::string, std::shared_ptr<const JsonDataset>> datasets;
+  std::lock_guard<std::mutex> lock(mutex);
+  auto it = datasets.find(path);
+  if (it == datasets.end() || it->second == nullptr) {
+    it = datasets.emplace(path, std::make_shared<const JsonDataset>(
+        path, FLAGS_dataset_cache ? path + ".cache" : "")).first;
+  }
+  return it->second;
+}
+
+std::string JsonDataset::DataVersion(const std::string& path) {
+  struct stat st;
+  if (stat(path.c_str(), &st) != 0) {
+    return path;
+  }
+  return StringPrintf("%s:%lld:%lld", path.c_str(), static_cast<long long>(st.st_size), static_cast<long long>(st.st_mtime));
+}
+
+void JsonDataset::ParseJson(const std::string& path) {
+  std::string content = ReadFileToStringOrDie(path.c_str());
+  std::vector<std::string> lines;
+  SplitStringUsing(content, '\n', &lines, false);
+  content.clear();
+
+  apps_.resize(lines.size());
+  #pragma omp parallel for schedule(dynamic, 16)
+  for (size_t i = 0; i < lines.size(); i++) {
+    const std::string& line = lines[i];
+    std::unique_ptr<Json::CharReader> reader(Json::CharReaderBuilder().newCharReader());
+    Json::Value root;
+    std::string errors;
+    CHECK(reader->parse(line.data(), line.data() + line.size(), &root, &errors))
+        << "Could not parse line " << i + 1 << " of " << path << ": " << errors;
+
+    DatasetApp& app = apps_[i];
+    app.app_id = JsonAppSerializer::JsonToApps(root, app.app, app.apps, app.ref_device, app.devices);
+    app.filename = root["filename"].asString();
+  }
+}
+
+const DatasetApp& JsonDataset::operator[](size_t i) const {
+  if (layout_ == nullptr) {
+    return apps_[i];
+  }
+  thread_local static DatasetApp app;
+  app = DatasetApp();
+  app.app_id = layout_->ToApps(i, &app.app, &app.apps, &app.ref_device, &app.devices);
+  app.filename = layout_->filename(i);
+  return app;
+}
+
+int JsonDataset::app_id(size_t i) const {
+  return (layout_ != nullptr) ? ParseInt32(layout_->id(i)) : apps_[i].app_id;
+}
+
+std::string JsonDataset::filename(size_t i) const {
+  return (layout_ != nullptr) ? layout_->filename(i) : apps_[i].filename;
+}
+
+size_t JsonDataset::num_views(size_t i) const {
+  return (layout_ != nullptr) ? layout_->num_ref_views(i) : apps_[i].app.GetViews().size();
+}
+
+bool JsonDataset::LoadCache(const std::string& cache_path, const std::string& data_version) {
+  std::ifstream in(cache_path, std::ios::binary);
+  if (!in.is_open()) {
+    return false;
+  }
+  DatasetCacheProto cache;
+  if (!cache.ParseFromIstream(&in) || cache.data_version() != data_version) {
+    LOG(INFO) << "Dataset cache " << cache_path << " is outdated";
+    return false;
+  }
+
+  apps_.resize(cache.apps_size());
+  #pragma omp parallel for schedule(dynamic, 16)
+  for (int i = 0; i < cache.apps_size(); i++) {
+    const DatasetAppProto& proto = cache.apps(i);
+    CHECK_GT(proto.screens_size(), 0);
+    DatasetApp& app = apps_[i];
+    app.app_id = proto.app_id();
+    app.filename = proto.filename();
+    app.app = ProtoToApp(proto.screens(0));
+    app.ref_device = Device(proto.screens(0).width(), proto.screens(0).height());
+    for (int j = 1; j < proto.screens_size(); j++) {
+      app.apps.push_back(ProtoToApp(proto.screens(j)));
+      app.devices.push_back(Device(proto.screens(j).width(), proto.screens(j).height()));
+    }
+  }
+  return true;
+}
+
+void JsonDataset::SaveCache(const std::string& cache_path, const std::string& data_version) const {
+  DatasetCacheProto cache;
+  cache.set_data_version(data_version);
+  for (const DatasetApp& app : apps_) {
+    CHECK_EQ(app.apps.size(), app.devices.size());
+    DatasetAppProto* proto = cache.add_apps();
+    proto->set_app_id(app.app_id);
+    proto->set_filename(app.filename);
+    ScreenToProto(app.app, app.ref_device, proto->add_screens());
+    for (size_t i = 0; i < app.apps.size(); i++) {
+      ScreenToProto(app.apps[i], app.devices[i], proto->add_screens());
+    }
+  }
+
+  // Written to a temporary file first so that an interrupted run does not leave a partial cache
+  const std::string tmp_path = cache_path + ".tmp";
+  {
+    std::ofstream out(tmp_path, std::ios::binary | std::ios::trunc);
+    if (!out.is_open() || !cache.SerializeToOstream(&out)) {
+      LOG(WARNING) << "Could not write dataset cache " << tmp_path;
+      return;
+    }
+  }
+  if (rename(tmp_path.c_str(), cache_path.c_str()) != 0) {
+    LOG(WARNING) << "Could not write dataset cache " << cache_path;
+  }
+}
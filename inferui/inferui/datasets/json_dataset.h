@@ -0,0 +1,81 @@
+/*
+   Copyright 2018 Software Reliability Lab, ETH Zurich
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#ifndef CC_SYNTHESIS_JSON_DATASET_H
+#define CC_SYNTHESIS_JSON_DATASET_H
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "inferui/model/model.h"
+#include "inferui/datasets/json_dataset.pb.h"
+#include "inferui/datasets/layout_dataset.h"
+
+DECLARE_bool(dataset_cache);
+
+// App of a JSON dataset converted as in JsonAppSerializer::JsonToApps.
+struct DatasetApp {
+  DatasetApp() : ref_device(0, 0), app_id(-1) {
+  }
+
+  App app;
+  Device ref_device;
+  std::vector<App> apps;
+  std::vector<Device> devices;
+
+  int app_id;
+  std::string filename;
+};
+
+// Dataset with one JSON app per line (e.g., data/neural_oracle/D_S+/data_post.json) or in the binary
+// LayoutDataset format. Each JSON line is parsed once (in parallel) and the apps are kept in memory. With a cache_path
+// the converted apps of a JSON dataset are stored there and loaded from it as long as the JSON file is not modified.
+// A binary dataset stays memory mapped and each app is converted from it when it is accessed.
+class JsonDataset {
+public:
+  JsonDataset(const std::string& path, const std::string& cache_path);
+
+  // Dataset shared by all the callers in the process, cached next to the JSON file if --dataset_cache is set.
+  static std::shared_ptr<const JsonDataset> Load(const std::string& path);
+
+  // Path, size and modification time of the file.
+  static std::string DataVersion(const std::string& path);
+
+  size_t size() const {
+    return (layout_ != nullptr) ? layout_->size() : apps_.size();
+  }
+
+  // The apps of a binary dataset are not kept in memory: they are converted into a buffer of the calling thread and
+  // the reference is only valid until the next access to a binary dataset on the same thread.
+  const DatasetApp& operator[](size_t i) const;
+
+  // Same as the fields of operator[](i) but without converting the app of a binary dataset.
+  int app_id(size_t i) const;
+  std::string filename(size_t i) const;
+  // Number of views of the reference app.
+  size_t num_views(size_t i) const;
+
+private:
+  void ParseJson(const std::string& path);
+  bool LoadCache(const std::string& cache_path, const std::string& data_version);
+  void SaveCache(const std::string& cache_path, const std::string& data_version) const;
+
+  std::vector<DatasetApp> apps_;
+  std::unique_ptr<LayoutDataset> layout_;
+};
+
+#endif //CC_SYNTHESIS_JSON_DATASET_H
@@ -0,0 +1,125 @@
+/*
+   Copyright 2018 Software Reliability Lab, ETH Zurich
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#include <unistd.h>
+
+#include <fstream>
+
+#include "gtest/gtest.h"
+#include "glog/logging.h"
+
+#include "base/test_tmpfile.h"
+#include "inferui/datasets/json_dataset.h"
+#include "inferui/model/syn_helper.h"
+
+namespace {
+
+const char* const kDataset =
+    R"({"id": "7", "filename": "a.txt", "screens": [)"
+    R"({"resolution": [350, 630], "views": [[0, 0, 350, 630], [15, 168, 335, 413], [18, 177, 334, 240]]},)"
+    R"({"resolution": [360, 640], "views": [[0, 0, 360, 640], [20, 173, 340, 418], [23, 182, 339, 245]]},)"
+    R"({"resolution": [370, 650], "views": [[0, 0, 370, 650], [25, 178, 345, 423], [28, 187, 344, 250]]}]})" "\n"
+    R"({"id": "8", "filename": "b.txt", "screens": [)"
+    R"({"resolution": [1440, 2560], "views": [[0, 0, 100, 100]]},)"
+    R"({"resolution": [1400, 2520], "views": [[0, 0, 90, 90]]}]})" "\n";
+
+void ExpectSameApp(const App& expected, const App& app) {
+  ASSERT_EQ(expected.GetViews().size(), app.GetViews().size());
+  for (size_t i = 0; i < app.GetViews().size(); i++) {
+    const View& a = expected.GetViews()[i];
+    const View& b = app.GetViews()[i];
+    EXPECT_EQ(a.id, b.id);
+    EXPECT_EQ(a.id_string, b.id_string);
+    EXPECT_EQ(a.name, b.name);
+    EXPECT_EQ(a.xleft, b.xleft);
+    EXPECT_EQ(a.ytop, b.ytop);
+    EXPECT_EQ(a.xright, b.xright);
+    EXPECT_EQ(a.ybottom, b.ybottom);
+  }
+}
+
+void ExpectSameDataset(const std::vector<Json::Value>& json_apps, const JsonDataset& dataset) {
+  ASSERT_EQ(json_apps.size(), dataset.size());
+  for (size_t i = 0; i < dataset.size(); i++) {
+    App app;
+    std::vector<App> apps;
+    Device ref_device(0, 0);
+    std::vector<Device> devices;
+    int app_id = JsonAppSerializer::JsonToApps(json_apps[i], app, apps, ref_device, devices);
+
+    EXPECT_EQ(app_id, dataset.app_id(i));
+    EXPECT_EQ(json_apps[i]["filename"].asString(), dataset.filename(i));
+    EXPECT_EQ(app.GetViews().size(), dataset.num_views(i));
+
+    const DatasetApp& sample = dataset[i];
+    EXPECT_EQ(app_id, sample.app_id);
+    EXPECT_EQ(json_apps[i]["filename"].asString(), sample.filename);
+    EXPECT_EQ(ref_device.width, sample.ref_device.width);
+    EXPECT_EQ(ref_device.height, sample.ref_device.height);
+    ASSERT_EQ(devices.size(), sample.devices.size());
+    for (size_t j = 0; j < devices.size(); j++) {
+      EXPECT_EQ(devices[j].width, sample.devices[j].width);
+      EXPECT_EQ(devices[j].height, sample.devices[j].height);
+    }
+    ExpectSameApp(app, sample.app);
+    ASSERT_EQ(apps.size(), sample.apps.size());
+    for (size_t j = 0; j < apps.size(); j++) {
+      ExpectSameApp(apps[j], sample.apps[j]);
+    }
+  }
+}
+
+class JsonDatasetTest : public TempFileTest {
+};
+
+}  // namespace
+
+TEST_F(JsonDatasetTest, SameAppsAsJsonToApps) {
+  const std::string cache_path = path + ".cache";
+  {
+    std::ofstream out(path);
+    out << kDataset;
+  }
+  const std::vector<Json::Value> json_apps = JsonAppSerializer::readFile(path);
+  ASSERT_EQ(2u, json_apps.size());
+
+  // Parsed from the JSON
+  ExpectSameDataset(json_apps, JsonDataset(path, ""));
+  EXPECT_NE(0, access(cache_path.c_str(), F_OK));
+
+  // Parsed from the JSON and written to the cache, then loaded from the cache
+  ExpectSameDataset(json_apps, JsonDataset(path, cache_path));
+  EXPECT_EQ(0, access(cache_path.c_str(), F_OK));
+  ExpectSameDataset(json_apps, JsonDataset(path, cache_path));
+
+  // The cache is not used once the dataset changes
+  {
+    std::ofstream out(path, std::ios::app);
+    out << R"({"id": "9", "screens": [{"resolution": [100, 200], "views": [[1, 2, 3, 4]]}]})" "\n";
+  }
+  JsonDataset changed(path, cache_path);
+  ASSERT_EQ(3u, changed.size());
+  EXPECT_EQ(9, changed[2].app_id);
+  EXPECT_EQ(2u, changed[2].app.GetViews().size());
+
+  unlink(cache_path.c_str());
+}
+
+int main(int argc, char **argv) {
+  google::InstallFailureSignalHandler();
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,54 @@
+/*
+   Copyright 2018 Software Reliability Lab, ETH Zurich
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#include "json_lines.h"
+
+#include <unistd.h>
+
+#include <memory>
+
+#include <glog/logging.h>
+
+#include "base/fileutil.h"
+#include "base/strutil.h"
+
+std::vector<Json::Value> ReadJsonLines(const std::string& filename, bool truncate_incomplete) {
+  std::string content = ReadFileToStringOrDie(filename.c_str());
+  size_t complete = content.rfind('\n');
+  complete = (complete == std::string::npos) ? 0 : complete + 1;
+  if (complete < content.size()) {
+    if (truncate_incomplete) {
+      LOG(INFO) << "Removing incomplete last line of " << filename;
+      CHECK_EQ(truncate(filename.c_str(), complete), 0);
+    } else {
+      LOG(INFO) << "Ignoring incomplete last line of " << filename;
+    }
+    content.resize(complete);
+  }
+
+  std::vector<std::string> lines;
+  SplitStringUsing(content, '\n', &lines, false);
+  std::unique_ptr<Json::CharReader> reader(Json::CharReaderBuilder().newCharReader());
+  std::vector<Json::Value> values;
+  for (const std::string& line : lines) {
+    Json::Value value;
+    std::string errors;
+    CHECK(reader->parse(line.data(), line.data() + line.size(), &value, &errors))
+        << "Could not parse " << filename << ": " << errors;
+    values.push_back(value);
+  }
+  return values;
+}
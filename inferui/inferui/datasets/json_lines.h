@@ -0,0 +1,30 @@
+/*
+   Copyright 2018 Software Reliability Lab, ETH Zurich
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#ifndef CC_SYNTHESIS_JSON_LINES_H
+#define CC_SYNTHESIS_JSON_LINES_H
+
+#include <string>
+#include <vector>
+
+#include "json/json.h"
+
+// Reads a file with one JSON value per line (e.g., a dataset or an evaluation journal that is appended to).
+// A last line cut off by a crash is ignored, with truncate_incomplete it is also removed from the file,
+// so that new lines can be appended.
+std::vector<Json::Value> ReadJsonLines(const std::string& filename, bool truncate_incomplete);
+
+#endif //CC_SYNTHESIS_JSON_LINES_H
@@ -0,0 +1,375 @@
+/*
+   Copyright 2018 Software Reliability Lab, ETH Zurich
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#include "layout_dataset.h"
+
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <fstream>
+#include <memory>
+
+#include <glog/logging.h>
+
+#include "base/fileutil.h"
+#include "base/strutil.h"
+#include "inferui/model/syn_helper.h"
+
+namespace {
+
+const char kMagic[8] = {'L', 'A', 'Y', 'O', 'U', 'T', 'D', '2'};
+
+struct FileHeader {
+  char magic[8];
+  uint64_t num_apps;
+  uint64_t num_columns;
+  uint64_t screen_counts_offset;
+  uint64_t ids_offset;
+  uint64_t filenames_offset;
+  // uint64_t[3] for each column: resolutions, view offsets and coordinates
+  uint64_t columns_offset;
+  // uint8_t[num_apps], 1 if the id was a number in the JSON dataset
+  uint64_t numeric_ids_offset;
+};
+
+class SectionWriter {
+public:
+  explicit SectionWriter(std::ofstream* out) : out_(out), offset_(0) {
+  }
+
+  // Writes the data at the next 8 byte aligned offset (or right after the previous data) and returns the offset.
+  template <class T>
+  uint64_t Write(const std::vector<T>& data, bool align = true) {
+    static const char padding[8] = {0};
+    if (align) {
+      out_->write(padding, (8 - offset_ % 8) % 8);
+      offset_ += (8 - offset_ % 8) % 8;
+    }
+    uint64_t start = offset_;
+    out_->write(reinterpret_cast<const char*>(data.data()), data.size() * sizeof(T));
+    offset_ += data.size() * sizeof(T);
+    return start;
+  }
+
+  uint64_t WriteStrings(const std::vector<std::string>& strings) {
+    std::vector<uint32_t> offsets(1, 0);
+    std::vector<char> chars;
+    for (const std::string& s : strings) {
+      chars.insert(chars.end(), s.begin(), s.end());
+      offsets.push_back(chars.size());
+    }
+    uint64_t start = Write(offsets);
+    // The characters follow the offsets directly
+    Write(chars, false);
+    return start;
+  }
+
+private:
+  std::ofstream* out_;
+  uint64_t offset_;
+};
+
+}  // namespace
+
+bool IsLayoutDatasetFile(const std::string& filename) {
+  std::ifstream in(filename, std::ios::binary);
+  char magic[sizeof(kMagic)];
+  return in.read(magic, sizeof(magic)) && memcmp(magic, kMagic, sizeof(kMagic)) == 0;
+}
+
+LayoutDatasetWriter::LayoutDatasetWriter(const std::string& filename) : filename_(filename), closed_(false) {
+}
+
+LayoutDatasetWriter::~LayoutDatasetWriter() {
+  Close();
+}
+
+void LayoutDatasetWriter::AddJson(const Json::Value& app) {
+  DatasetEntry entry;
+  entry.id = app.get("id", "-1").asString();
+  entry.numeric_id = app.isMember("id") && app["id"].isInt();
+  entry.filename = app.get("filename", "").asString();
+  for (const Json::Value& screen : app["screens"]) {
+    Screen s;
+    s.width = screen["resolution"][0].asInt();
+    s.height = screen["resolution"][1].asInt();
+    for (const Json::Value& view : screen["views"]) {
+      CHECK_EQ(view.size(), 4u);
+      for (int i = 0; i < 4; i++) {
+        s.views.push_back(view[i].asInt());
+      }
+    }
+    entry.screens.push_back(std::move(s));
+  }
+  apps_.push_back(std::move(entry));
+}
+
+void LayoutDatasetWriter::Close() {
+  if (closed_) return;
+  closed_ = true;
+
+  size_t num_columns = 0;
+  for (const DatasetEntry& app : apps_) {
+    num_columns = std::max(num_columns, app.screens.size());
+  }
+
+  const std::string tmp_filename = filename_ + ".tmp";
+  std::ofstream out(tmp_filename, std::ios::binary | std::ios::trunc);
+  CHECK(out.is_open()) << "Could not create " << tmp_filename;
+  SectionWriter writer(&out);
+
+  FileHeader header;
+  memset(&header, 0, sizeof(header));
+  writer.Write(std::vector<FileHeader>(1, header));
+
+  std::vector<uint32_t> screen_counts;
+  std::vector<std::string> ids, filenames;
+  std::vector<uint8_t> numeric_ids;
+  for (const DatasetEntry& app : apps_) {
+    screen_counts.push_back(app.screens.size());
+    ids.push_back(app.id);
+    numeric_ids.push_back(app.numeric_id ? 1 : 0);
+    filenames.push_back(app.filename);
+  }
+  memcpy(header.magic, kMagic, sizeof(kMagic));
+  header.num_apps = apps_.size();
+  header.num_columns = num_columns;
+  header.screen_counts_offset = writer.Write(screen_counts);
+  header.ids_offset = writer.WriteStrings(ids);
+  header.filenames_offset = writer.WriteStrings(filenames);
+  header.numeric_ids_offset = writer.Write(numeric_ids);
+
+  std::vector<uint64_t> column_offsets;
+  for (size_t column = 0; column < num_columns; column++) {
+    std::vector<int32_t> resolutions;
+    std::vector<uint32_t> view_offsets(1, 0);
+    std::vector<int32_t> coordinates;
+    for (const DatasetEntry& app : apps_) {
+      if (column < app.screens.size()) {
+        const Screen& screen = app.screens[column];
+        resolutions.push_back(screen.width);
+        resolutions.push_back(screen.height);
+        coordinates.insert(coordinates.end(), screen.views.begin(), screen.views.end());
+      } else {
+        resolutions.push_back(0);
+        resolutions.push_back(0);
+      }
+      view_offsets.push_back(coordinates.size() / 4);
+    }
+    column_offsets.push_back(writer.Write(resolutions));
+    column_offsets.push_back(writer.Write(view_offsets));
+    column_offsets.push_back(writer.Write(coordinates));
+  }
+  header.columns_offset = writer.Write(column_offsets);
+
+  // The header is written last so that an interrupted write is not recognized as a dataset
+  out.seekp(0);
+  out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  out.close();
+  CHECK(!out.fail()) << "Could not write " << tmp_filename;
+  CHECK_EQ(rename(tmp_filename.c_str(), filename_.c_str()), 0);
+  LOG(INFO) << "Wrote " << apps_.size() << " apps to " << filename_;
+}
+
+void JsonToLayoutDataset(const std::string& json_filename, const std::string& filename) {
+  std::vector<std::string> lines;
+  SplitStringUsing(ReadFileToStringOrDie(json_filename.c_str()), '\n', &lines, false);
+  LayoutDatasetWriter writer(filename);
+  std::unique_ptr<Json::CharReader> reader(Json::CharReaderBuilder().newCharReader());
+  for (size_t i = 0; i < lines.size(); i++) {
+    Json::Value root;
+    std::string errors;
+    CHECK(reader->parse(lines[i].data(), lines[i].data() + lines[i].size(), &root, &errors))
+        << "Could not parse line " << i + 1 << " of " << json_filename << ": " << errors;
+    writer.AddJson(root);
+  }
+  writer.Close();
+}
+
+LayoutDataset::LayoutDataset(const std::string& filename) : filename_(filename), data_(nullptr), data_size_(0) {
+  int fd = open(filename.c_str(), O_RDONLY);
+  CHECK_GE(fd, 0) << "Could not open " << filename;
+  struct stat st;
+  CHECK_EQ(fstat(fd, &st), 0);
+  data_size_ = st.st_size;
+  CHECK_GE(data_size_, sizeof(FileHeader)) << "Invalid layout dataset " << filename;
+  void* data = mmap(nullptr, data_size_, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  CHECK(data != MAP_FAILED) << "Could not map " << filename;
+  data_ = static_cast<const char*>(data);
+
+  const FileHeader* header = reinterpret_cast<const FileHeader*>(data_);
+  CHECK(memcmp(header->magic, kMagic, sizeof(kMagic)) == 0) << "Invalid layout dataset " << filename;
+  num_apps_ = header->num_apps;
+  auto section = [&](uint64_t offset, uint64_t size) {
+    CHECK_EQ(offset % 8, 0u);
+    CHECK_LE(offset + size, data_size_) << "Truncated layout dataset " << filename;
+    return data_ + offset;
+  };
+  screen_counts_ = reinterpret_cast<const uint32_t*>(section(header->screen_counts_offset, num_apps_ * sizeof(uint32_t)));
+  ids_ = reinterpret_cast<const uint32_t*>(section(header->ids_offset, (num_apps_ + 1) * sizeof(uint32_t)));
+  filenames_ = reinterpret_cast<const uint32_t*>(section(header->filenames_offset, (num_apps_ + 1) * sizeof(uint32_t)));
+  section(header->ids_offset, (num_apps_ + 1) * sizeof(uint32_t) + ids_[num_apps_]);
+  section(header->filenames_offset, (num_apps_ + 1) * sizeof(uint32_t) + filenames_[num_apps_]);
+  numeric_ids_ = reinterpret_cast<const uint8_t*>(section(header->numeric_ids_offset, num_apps_));
+
+  const uint64_t* column_offsets = reinterpret_cast<const uint64_t*>(
+      section(header->columns_offset, header->num_columns * 3 * sizeof(uint64_t)));
+  for (size_t column = 0; column < header->num_columns; column++) {
+    Column c;
+    c.resolutions = reinterpret_cast<const int32_t*>(section(column_offsets[3 * column], 2 * num_apps_ * sizeof(int32_t)));
+    c.view_offsets = reinterpret_cast<const uint32_t*>(section(column_offsets[3 * column + 1], (num_apps_ + 1) * sizeof(uint32_t)));
+    c.coordinates = reinterpret_cast<const int32_t*>(
+        section(column_offsets[3 * column + 2], 4 * static_cast<uint64_t>(c.view_offsets[num_apps_]) * sizeof(int32_t)));
+    columns_.push_back(c);
+  }
+}
+
+LayoutDataset::~LayoutDataset() {
+  if (data_ != nullptr) {
+    munmap(const_cast<char*>(data_), data_size_);
+  }
+}
+
+size_t LayoutDataset::num_screens(size_t app) const {
+  CHECK_LT(app, num_apps_);
+  return screen_counts_[app];
+}
+
+std::string LayoutDataset::String(const uint32_t* table, size_t app) const {
+  CHECK_LT(app, num_apps_);
+  const char* chars = reinterpret_cast<const char*>(table + num_apps_ + 1);
+  return std::string(chars + table[app], table[app + 1] - table[app]);
+}
+
+std::string LayoutDataset::id(size_t app) const {
+  return String(ids_, app);
+}
+
+bool LayoutDataset::numeric_id(size_t app) const {
+  CHECK_LT(app, num_apps_);
+  return numeric_ids_[app] != 0;
+}
+
+std::string LayoutDataset::filename(size_t app) const {
+  return String(filenames_, app);
+}
+
+Device LayoutDataset::resolution(size_t app, size_t screen) const {
+  CHECK_LT(screen, num_screens(app));
+  const int32_t* resolution = columns_[screen].resolutions + 2 * app;
+  return Device(resolution[0], resolution[1]);
+}
+
+size_t LayoutDataset::num_views(size_t app, size_t screen) const {
+  CHECK_LT(screen, num_screens(app));
+  return columns_[screen].view_offsets[app + 1] - columns_[screen].view_offsets[app];
+}
+
+const int32_t* LayoutDataset::views(size_t app, size_t screen) const {
+  CHECK_LT(screen, num_screens(app));
+  return columns_[screen].coordinates + 4 * static_cast<size_t>(columns_[screen].view_offsets[app]);
+}
+
+// Same views as CuJsonToAppRaw creates from the JSON screen
+App LayoutDataset::ScreenToApp(size_t app, size_t screen) const {
+  const Device device = resolution(app, screen);
+  App res;
+  res.AddView(View(0, 0, device.width, device.height, "parent", 0, "parent"));
+  const int32_t* view = views(app, screen);
+  int id = 0;
+  for (size_t i = 0; i < num_views(app, screen); i++, view += 4) {
+    if (view[0] == 0 && view[1] == 0 && view[2] == device.width && view[3] == device.height) {
+      continue;
+    }
+    id++;
+    res.AddView(View(view[0], view[1], view[2], view[3], "frog", id, "frog"));
+  }
+  std::vector<bool> resizable(2, true);
+  res.setResizable(resizable);
+  return res;
+}
+
+size_t LayoutDataset::ref_screen(size_t app) const {
+  if (num_screens(app) != 3) {
+    return 0;
+  }
+  CHECK(resolution(app, 0).width < resolution(app, 1).width && resolution(app, 1).width < resolution(app, 2).width)
+      << "device sizes are not ordered as expected";
+  return 1;
+}
+
+// Counts the views the same way as ScreenToApp adds them
+size_t LayoutDataset::num_ref_views(size_t app) const {
+  const size_t screen = ref_screen(app);
+  const Device device = resolution(app, screen);
+  const int32_t* view = views(app, screen);
+  size_t res = 1;
+  for (size_t i = 0; i < num_views(app, screen); i++, view += 4) {
+    if (view[0] == 0 && view[1] == 0 && view[2] == device.width && view[3] == device.height) {
+      continue;
+    }
+    res++;
+  }
+  return res;
+}
+
+int LayoutDataset::ToApps(size_t app, App* ref_app, std::vector<App>* apps, Device* ref_device, std::vector<Device>* devices) const {
+  const size_t ref = ref_screen(app);
+  for (size_t screen = 0; screen < num_screens(app); screen++) {
+    if (screen == ref) {
+      *ref_app = ScreenToApp(app, screen);
+      *ref_device = resolution(app, screen);
+    } else {
+      apps->push_back(ScreenToApp(app, screen));
+      devices->push_back(resolution(app, screen));
+    }
+  }
+  return ParseInt32(id(app));
+}
+
+Json::Value LayoutDataset::ToJson(size_t app) const {
+  Json::Value root(Json::objectValue);
+  if (numeric_id(app)) {
+    root["id"] = ParseInt32(id(app));
+  } else {
+    root["id"] = id(app);
+  }
+  if (!filename(app).empty()) {
+    root["filename"] = filename(app);
+  }
+  Json::Value screens(Json::arrayValue);
+  for (size_t screen = 0; screen < num_screens(app); screen++) {
+    Json::Value value(Json::objectValue);
+    value["resolution"] = DeviceToJson(resolution(app, screen));
+    Json::Value json_views(Json::arrayValue);
+    const int32_t* view = views(app, screen);
+    for (size_t i = 0; i < num_views(app, screen); i++, view += 4) {
+      Json::Value json_view(Json::arrayValue);
+      for (int j = 0; j < 4; j++) {
+        json_view.append(view[j]);
+      }
+      json_views.append(json_view);
+    }
+    value["views"] = json_views;
+    screens.append(value);
+  }
+  root["screens"] = screens;
+  return root;
+}
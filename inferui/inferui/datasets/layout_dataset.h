@@ -0,0 +1,126 @@
+/*
+   Copyright 2018 Software Reliability Lab, ETH Zurich
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#ifndef CC_SYNTHESIS_LAYOUT_DATASET_H
+#define CC_SYNTHESIS_LAYOUT_DATASET_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "inferui/model/model.h"
+#include "json/json.h"
+
+// Binary columnar format of the multi-device datasets (one app per line with screens[].views[][4] in JSON).
+// The file can be memory mapped and read without parsing:
+//   header
+//   number of screens of each app (uint32[num_apps])
+//   ids and filenames as string tables (uint32 offsets[num_apps + 1] followed by the characters)
+//   whether each id was a number in the JSON (uint8[num_apps])
+//   for each screen position s (the s-th screen of the apps, i.e., the same device resolution):
+//     resolution of the screen of each app (int32[2 * num_apps])
+//     offsets of the views of each app (uint32[num_apps + 1])
+//     coordinates xleft, ytop, xright, ybottom of all the views (int32[4 * num_views])
+// All the sections are 8 byte aligned and stored in the byte order of the machine that wrote them.
+
+// True if the file starts with the magic string of the binary layout dataset.
+bool IsLayoutDatasetFile(const std::string& filename);
+
+// Collects the apps in memory and writes the file in Close().
+class LayoutDatasetWriter {
+public:
+  explicit LayoutDatasetWriter(const std::string& filename);
+  ~LayoutDatasetWriter();
+
+  // App in the JSON format of the datasets: {"id": ..., "filename": ..., "screens": [{"resolution": [w, h], "views": [[...], ...]}, ...]}
+  void AddJson(const Json::Value& app);
+
+  void Close();
+
+private:
+  struct Screen {
+    int32_t width, height;
+    std::vector<int32_t> views;
+  };
+  struct DatasetEntry {
+    std::string id, filename;
+    bool numeric_id;
+    std::vector<Screen> screens;
+  };
+
+  const std::string filename_;
+  std::vector<DatasetEntry> apps_;
+  bool closed_;
+};
+
+// Converts a JSON dataset (one app per line) to the binary format.
+void JsonToLayoutDataset(const std::string& json_filename, const std::string& filename);
+
+// Memory mapped binary layout dataset. All the accessors read directly from the mapped file.
+class LayoutDataset {
+public:
+  explicit LayoutDataset(const std::string& filename);
+  ~LayoutDataset();
+
+  LayoutDataset(const LayoutDataset&) = delete;
+  LayoutDataset& operator=(const LayoutDataset&) = delete;
+
+  size_t size() const {
+    return num_apps_;
+  }
+
+  size_t num_screens(size_t app) const;
+  std::string id(size_t app) const;
+  // True if the id was a number (and not a string) in the JSON dataset.
+  bool numeric_id(size_t app) const;
+  std::string filename(size_t app) const;
+  Device resolution(size_t app, size_t screen) const;
+  size_t num_views(size_t app, size_t screen) const;
+  // xleft, ytop, xright, ybottom of each of the num_views views
+  const int32_t* views(size_t app, size_t screen) const;
+
+  // Screen of the reference app of ToApps: the middle one of three screens, otherwise the first one.
+  size_t ref_screen(size_t app) const;
+  // Number of views of the reference app of ToApps (including the content frame) without converting it.
+  size_t num_ref_views(size_t app) const;
+
+  // Converts the app the same way as JsonAppSerializer::JsonToApps and returns its id.
+  int ToApps(size_t app, App* ref_app, std::vector<App>* apps, Device* ref_device, std::vector<Device>* devices) const;
+
+  Json::Value ToJson(size_t app) const;
+
+private:
+  struct Column {
+    const int32_t* resolutions;
+    const uint32_t* view_offsets;
+    const int32_t* coordinates;
+  };
+
+  std::string String(const uint32_t* table, size_t app) const;
+  App ScreenToApp(size_t app, size_t screen) const;
+
+  const std::string filename_;
+  const char* data_;
+  size_t data_size_;
+  size_t num_apps_;
+  const uint32_t* screen_counts_;
+  const uint32_t* ids_;
+  const uint8_t* numeric_ids_;
+  const uint32_t* filenames_;
+  std::vector<Column> columns_;
+};
+
+#endif //CC_SYNTHESIS_LAYOUT_DATASET_H
@@ -0,0 +1,147 @@
+/*
+   Copyright 2018 Software Reliability Lab, ETH Zurich
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#include <unistd.h>
+
+#include "gtest/gtest.h"
+#include "glog/logging.h"
+
+#include "base/test_tmpfile.h"
+#include "inferui/datasets/json_dataset.h"
+#include "inferui/datasets/layout_dataset.h"
+#include "inferui/model/syn_helper.h"
+
+namespace {
+
+std::vector<Json::Value> TestApps() {
+  const char* const lines[] = {
+      R"({"id": "7", "filename": "a.txt", "screens": [)"
+      R"({"resolution": [350, 630], "views": [[0, 0, 350, 630], [15, 168, 335, 413], [18, 177, 334, 240]]},)"
+      R"({"resolution": [360, 640], "views": [[0, 0, 360, 640], [20, 173, 340, 418], [23, 182, 339, 245]]},)"
+      R"({"resolution": [370, 650], "views": [[0, 0, 370, 650], [25, 178, 345, 423], [28, 187, 344, 250]]}]})",
+      R"({"id": 8, "screens": [)"
+      R"({"resolution": [1440, 2560], "views": [[0, 0, 100, 100]]},)"
+      R"({"resolution": [1400, 2520], "views": []}]})",
+  };
+  std::vector<Json::Value> apps;
+  Json::Reader reader;
+  for (const char* line : lines) {
+    Json::Value root;
+    CHECK(reader.parse(line, root));
+    apps.push_back(root);
+  }
+  return apps;
+}
+
+void ExpectSameApp(const App& expected, const App& app) {
+  ASSERT_EQ(expected.GetViews().size(), app.GetViews().size());
+  for (size_t i = 0; i < app.GetViews().size(); i++) {
+    const View& a = expected.GetViews()[i];
+    const View& b = app.GetViews()[i];
+    EXPECT_EQ(a.id, b.id);
+    EXPECT_EQ(a.id_string, b.id_string);
+    EXPECT_EQ(a.xleft, b.xleft);
+    EXPECT_EQ(a.ytop, b.ytop);
+    EXPECT_EQ(a.xright, b.xright);
+    EXPECT_EQ(a.ybottom, b.ybottom);
+  }
+}
+
+class LayoutDatasetTest : public TempFileTest {
+protected:
+  void SetUp() override {
+    TempFileTest::SetUp();
+    LayoutDatasetWriter writer(path);
+    for (const Json::Value& app : TestApps()) {
+      writer.AddJson(app);
+    }
+    writer.Close();
+  }
+};
+
+}  // namespace
+
+TEST_F(LayoutDatasetTest, ColumnsAndJsonRoundTrip) {
+  ASSERT_TRUE(IsLayoutDatasetFile(path));
+  LayoutDataset dataset(path);
+  ASSERT_EQ(2u, dataset.size());
+
+  EXPECT_EQ(3u, dataset.num_screens(0));
+  EXPECT_EQ("7", dataset.id(0));
+  EXPECT_FALSE(dataset.numeric_id(0));
+  EXPECT_TRUE(dataset.numeric_id(1));
+  EXPECT_EQ("a.txt", dataset.filename(0));
+  EXPECT_EQ(360, dataset.resolution(0, 1).width);
+  EXPECT_EQ(640, dataset.resolution(0, 1).height);
+  ASSERT_EQ(3u, dataset.num_views(0, 2));
+  EXPECT_EQ(28, dataset.views(0, 2)[8]);
+
+  EXPECT_EQ(2u, dataset.num_screens(1));
+  EXPECT_EQ("", dataset.filename(1));
+  EXPECT_EQ(0u, dataset.num_views(1, 1));
+
+  std::vector<Json::Value> apps = TestApps();
+  for (size_t i = 0; i < apps.size(); i++) {
+    EXPECT_EQ(apps[i], dataset.ToJson(i));
+  }
+}
+
+TEST_F(LayoutDatasetTest, SameAppsAsJsonToApps) {
+  LayoutDataset dataset(path);
+  std::vector<Json::Value> json_apps = TestApps();
+  for (size_t i = 0; i < json_apps.size(); i++) {
+    App expected;
+    std::vector<App> expected_apps;
+    Device expected_device(0, 0);
+    std::vector<Device> expected_devices;
+    int expected_id = JsonAppSerializer::JsonToApps(json_apps[i], expected, expected_apps, expected_device, expected_devices);
+
+    App app;
+    std::vector<App> apps;
+    Device device(0, 0);
+    std::vector<Device> devices;
+    EXPECT_EQ(expected_id, dataset.ToApps(i, &app, &apps, &device, &devices));
+    ExpectSameApp(expected, app);
+    EXPECT_EQ(expected_device.width, device.width);
+    EXPECT_EQ(expected_device.height, device.height);
+    ASSERT_EQ(expected_apps.size(), apps.size());
+    ASSERT_EQ(expected_devices.size(), devices.size());
+    for (size_t j = 0; j < apps.size(); j++) {
+      ExpectSameApp(expected_apps[j], apps[j]);
+      EXPECT_EQ(expected_devices[j].width, devices[j].width);
+    }
+  }
+
+  // Binary datasets are read by DatasetIterators without a cache
+  JsonDataset json_dataset(path, path + ".cache");
+  ASSERT_EQ(2u, json_dataset.size());
+  EXPECT_EQ(7, json_dataset[0].app_id);
+  EXPECT_EQ(2u, json_dataset[0].apps.size());
+  EXPECT_EQ(8, json_dataset[1].app_id);
+  for (size_t i = 0; i < json_dataset.size(); i++) {
+    const DatasetApp& sample = json_dataset[i];
+    EXPECT_EQ(sample.app_id, json_dataset.app_id(i));
+    EXPECT_EQ(sample.filename, json_dataset.filename(i));
+    EXPECT_EQ(sample.app.GetViews().size(), json_dataset.num_views(i));
+  }
+  EXPECT_NE(0, access((path + ".cache").c_str(), F_OK));
+}
+
+int main(int argc, char **argv) {
+  google::InstallFailureSignalHandler();
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -24,9 +24,13 @@
 #include "inferui/eval/eval_util.h"
 #include "inferui/eval/eval_app_util.h"
 #include "inferui/model/util/util.h"
+#include "inferui/datasets/dataset_sink.h"
 #include "inferui/datasets/dataset_util.h"
+#include "inferui/datasets/layout_dataset.h"
 
 DEFINE_string(out_file, "data/neural_oracle/D_P/data.json", "Generate file containing the processed input specification");
+DEFINE_bool(resume, false, "Keep the apps already in --out_file and only generate the missing ones");
+DEFINE_string(out_binary_file, "", "If set, the processed input specification is also written in the binary layout dataset format");
 
 
 Device GetResizedDevice(const Device& device) {
@@ -74,11 +78,16 @@ int main(int argc, char** argv) {
     screens.push_back(app);
   });
 
-  std::vector<Json::Value> results(screens.size());
+  // Finished apps are written right away in the order of the input
+  OrderedDatasetSink sink(FLAGS_out_file, FLAGS_resume, "filename");
   std::mutex mutex;
 #pragma omp parallel for private(solver) schedule(guided)
   for (size_t app_id = 0; app_id < screens.size(); app_id++) {
     const ProtoScreen &screen = screens[app_id].screens(0);
+    OrderedDatasetSink::Slot result(&sink, app_id);
+    if (sink.Contains(screens[app_id].file_name())) {
+      continue;
+    }
 
     Timer timer;
     timer.Start();
@@ -93,8 +102,7 @@ int main(int argc, char** argv) {
       continue;
     }
 
-    Json::Value layout = solver.sendPost(app.ToJSON());
-    App rendered_app = JsonToApp(layout);
+    App rendered_app = RenderApp(app, solver);
     if (!AppMatch(app, rendered_app)) {
       not_matching++;
       continue;
@@ -111,7 +119,7 @@ int main(int argc, char** argv) {
       LOG(INFO) << "Took " << std::round(timer.GetMilliSeconds()/1000) << "s";
       continue;
     }
-    results[app_id] = data;
+    result.Set(data);
 
     // (Optional) Synthesize layout and compute its generalization
     auto res = synthesizer.Synthesize(App(app), ref_device, devices);
@@ -140,7 +148,7 @@ int main(int argc, char** argv) {
       for (const auto& device : devices) {
         App resized_app = app;
         TryResizeView(resized_app, resized_app.GetViews()[0], ref_device, device);
-        resized_app = JsonToApp(solver.sendPost(resized_app.ToJSON()));
+        resized_app = RenderApp(resized_app, solver);
 
         ComputeGeneralization(resized_app, res.app, ref_device, device, solver, &stats);
       }
@@ -154,14 +162,11 @@ int main(int argc, char** argv) {
 
   }
 
-  Json::FastWriter writer;
-  std::ofstream out_file;
-  out_file.open(FLAGS_out_file);
-  for (auto& value : results) {
-    if (value.empty()) continue;
-    out_file << writer.write(value);
+  sink.Close();
+
+  if (!FLAGS_out_binary_file.empty()) {
+    JsonToLayoutDataset(FLAGS_out_file, FLAGS_out_binary_file);
   }
-  out_file.close();
 
   LOG(INFO) << "Success: " << success << " / " << total;
   LOG(INFO) << "Unsat: " << unsat << " / " << total;
@@ -24,10 +24,14 @@
 #include "inferui/eval/eval_util.h"
 #include "inferui/eval/eval_app_util.h"
 #include "inferui/model/util/util.h"
+#include "inferui/datasets/dataset_sink.h"
 #include "inferui/datasets/dataset_util.h"
+#include "inferui/datasets/layout_dataset.h"
 
 DEFINE_string(path, "data/rendered_rico/2plus_resolutions.json", "Path to directory with json files containing input specification");
 DEFINE_string(out_file, "data/neural_oracle/D_S+/data.json", "Generate file containing the processed input specification");
+DEFINE_bool(resume, false, "Keep the apps already in --out_file and only generate the missing ones");
+DEFINE_string(out_binary_file, "", "If set, the processed input specification is also written in the binary layout dataset format");
 
 bool ValidApps(const App& app, const std::vector<App>& apps) {
   for (const App& temp : apps) {
@@ -82,11 +86,16 @@ int main(int argc, char** argv) {
                          JsonAppSerializer::readDirectory(FLAGS_path) :
                          JsonAppSerializer::readFile(FLAGS_path);
 
-  std::vector<Json::Value> results(json_apps.size());
+  // Finished apps are written right away in the order of the input
+  OrderedDatasetSink sink(FLAGS_out_file, FLAGS_resume);
   std::mutex mutex;
 #pragma omp parallel for private(solver) schedule(guided)
   for (size_t app_id = 0; app_id < json_apps.size(); app_id++) {
     const auto &root = json_apps[app_id];
+    OrderedDatasetSink::Slot result(&sink, app_id);
+    if (sink.Contains(BaseName(root["id"].asString()))) {
+      continue;
+    }
 
     Timer timer;
     timer.Start();
@@ -162,7 +171,7 @@ int main(int argc, char** argv) {
       }
       data["reference_resolutions"] = resolutions;
     }
-    results[app_id] = data;
+    result.Set(data);
 
     success++;
     LOG(INFO) << "Success: " << success << " / " << total;
@@ -170,14 +179,11 @@ int main(int argc, char** argv) {
     LOG(INFO) << "Took " << std::round(timer.GetMilliSeconds()/1000) << "s";
   }
 
-  Json::FastWriter writer;
-  std::ofstream out_file;
-  out_file.open(FLAGS_out_file);
-  for (auto& value : results) {
-    if (value.empty()) continue;
-    out_file << writer.write(value);
+  sink.Close();
+
+  if (!FLAGS_out_binary_file.empty()) {
+    JsonToLayoutDataset(FLAGS_out_file, FLAGS_out_binary_file);
   }
-  out_file.close();
 
 
   LOG(INFO) << "Success: " << success << " / " << total;
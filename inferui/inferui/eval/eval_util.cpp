@@ -23,9 +23,12 @@ DEFINE_string(train_data, "", "Training file with app data.");
 DEFINE_string(test_data, "", "Testing file with app data.");
 
 
-void adjustViewsByUserConstraints(App* syn_app) {
+bool adjustViewsByUserConstraints(App* syn_app) {
   Solver solver;
-  App ref_rendered_app = JsonToApp(solver.sendPost(syn_app->ToJSON()));
+  App ref_rendered_app;
+  if (!TryRenderApp(*syn_app, solver, &ref_rendered_app)) {
+    return false;
+  }
   for (size_t i = 1; i < syn_app->GetViews().size(); i++) {
     View& ref_view = syn_app->GetViews()[i];
     View& ref_rendered_view = ref_rendered_app.GetViews()[i];
@@ -35,7 +38,7 @@ void adjustViewsByUserConstraints(App* syn_app) {
     ref_view.ytop = ref_rendered_view.ytop;
     ref_view.ybottom = ref_rendered_view.ybottom;
   }
-
+  return true;
 }
 
 std::pair<bool, std::vector<App>> applyTransformations(Solver& solver, const App& app, const std::vector<App> apps, std::string model, const Device ref_device, const std::vector<Device>& devices, std::string dataset, int& lowerLimit, int& upperLimit, int& necessaryUserCorrectionsSmaller, int& necessaryUserCorrectionsBigger){
@@ -81,8 +84,9 @@ std::pair<bool, std::vector<App>> applyTransformations(Solver& solver, const App
 	return std::make_pair(result["successful"].asBool(), transformedApps);
 }
 
-std::map<std::string, bool> CheckProperties(App ref_app, const Device& ref_device, const std::vector<Device>& devices) {
-  std::map<std::string, bool> results;
+bool CheckProperties(App ref_app, const Device& ref_device, const std::vector<Device>& devices,
+                     std::map<std::string, bool>* properties) {
+  std::map<std::string, bool>& results = *properties;
 
   LayoutSolver layout_solver;
   Solver solver;
@@ -114,8 +118,10 @@ std::map<std::string, bool> CheckProperties(App ref_app, const Device& ref_devic
     }
 
 //    PrintApp(layout_device_app.second, false);
-    Json::Value layout = solver.sendPost(resized_app.ToJSON());
-    App syn_app = JsonToApp(layout);
+    App syn_app;
+    if (!TryRenderApp(resized_app, solver, &syn_app)) {
+      return false;
+    }
     LOG(INFO) << "Resized App";
     PrintApp(syn_app, false);
 
@@ -164,5 +170,5 @@ std::map<std::string, bool> CheckProperties(App ref_app, const Device& ref_devic
   for (const auto& it : results) {
     LOG(INFO) << "\t\t" << it.first << ": " << it.second;
   }
-  return results;
+  return true;
 };
@@ -27,9 +27,13 @@
 DECLARE_string(train_data);
 DECLARE_string(test_data);
 
-std::map<std::string, bool> CheckProperties(App ref_app, const Device& ref_device, const std::vector<Device>& devices);
+// Checks the properties of the app rendered on the devices.
+// @returns false if the layout solver could not render the app.
+bool CheckProperties(App ref_app, const Device& ref_device, const std::vector<Device>& devices,
+                     std::map<std::string, bool>* results);
 
-void adjustViewsByUserConstraints(App* syn_app);
+// @returns false if the layout solver could not render the app.
+bool adjustViewsByUserConstraints(App* syn_app);
 std::pair<bool, std::vector<App>> applyTransformations(Solver& solver, const App& app, const std::vector<App> apps, std::string model, const Device ref_device, const std::vector<Device>& devices, std::string dataset, int& lowerLimit, int& upperLimit, int& necessaryUserCorrectionsSmaller, int& necessaryUserCorrectionsBigger);
 
 class Synthesizer {
@@ -289,15 +293,18 @@ public:
     models.Dump();
   }
 
-  void SetDevice(const Device& ref, const std::vector<Device>& all) {
-    ref_device = ref;
-    devices = all;
-  }
-
   void SetOpt(bool _opt){
 	  opt = _opt;
   }
 
+  bool IsOpt() const {
+    return opt;
+  }
+
+  const ProbModel* GetModel() const {
+    return &models;
+  }
+
   SynResult Synthesize(const ProtoScreen& screen, bool only_constraint_views) const {
     FullSynthesis syn;
     SynResult result(App(screen, only_constraint_views));
@@ -25,7 +25,19 @@
 #include "inferui/eval/eval_app_util.h"
 #include "inferui/model/util/util.h"
 #include "inferui/datasets/dataset_util.h"
+#include "base/fileutil.h"
 
+DEFINE_string(journal_dir, "", "Directory in which the result of each app is journaled, one file per experiment.");
+DEFINE_bool(resume, false, "Do not evaluate the apps already in the journals of --journal_dir again.");
+
+// With --journal_dir the results of the experiment are journaled in <journal_dir>/<name>[.shard-i-of-n].journal
+DatasetIterators ExperimentIterators(const std::string& name) {
+  DatasetIterators it;
+  if (!FLAGS_journal_dir.empty()) {
+    it.SetJournal(FLAGS_journal_dir + "/" + name + ShardSuffix() + ".journal", FLAGS_resume);
+  }
+  return it;
+}
 
 PropertyStats SingleSyn(const DatasetIterators& it, bool opt) {
   auto synthesizer = GenSmtMultiDeviceProbOpt(opt);
@@ -128,21 +140,24 @@ int main(int argc, char** argv) {
     LOG(INFO) << "Setting --scaling_factor=2 instead of the user supplied value!";
     FLAGS_scaling_factor = 2;
   }
-  
-  auto dataset_iterator = DatasetIterators();
+  CHECK(!FLAGS_resume || !FLAGS_journal_dir.empty()) << "--resume requires --journal_dir";
+  CHECK(FLAGS_num_shards == 1 || !FLAGS_journal_dir.empty()) << "Sharded evaluations are merged from --journal_dir";
+  if (!FLAGS_journal_dir.empty()) {
+    CHECK(CreateDirectoryRecursive(FLAGS_journal_dir.c_str())) << "Could not create " << FLAGS_journal_dir;
+  }
 
   std::map<std::string, PropertyStats> results;
-//  results["SingleSyn+Opt"] = SingleSyn(dataset_iterator, true);
-//  results["SingleSyn"] = SingleSyn(dataset_iterator, false);
+//  results["SingleSyn+Opt"] = SingleSyn(ExperimentIterators("SingleSyn+Opt"), true);
+//  results["SingleSyn"] = SingleSyn(ExperimentIterators("SingleSyn"), false);
 
-  results["SingleSynOneQuery+Opt"] = SingleSynOneQuery(dataset_iterator, true);
-  results["SingleSynOneQuery"] = SingleSynOneQuery(dataset_iterator, false);
+  results["SingleSynOneQuery+Opt"] = SingleSynOneQuery(ExperimentIterators("SingleSynOneQuery+Opt"), true);
+  results["SingleSynOneQuery"] = SingleSynOneQuery(ExperimentIterators("SingleSynOneQuery"), false);
 
-  results["RobustSyn+Opt"] = RobustSyn(dataset_iterator, true);
-//  results["RobustSyn"] = RobustSyn(dataset_iterator, false);
+  results["RobustSyn+Opt"] = RobustSyn(ExperimentIterators("RobustSyn+Opt"), true);
+//  results["RobustSyn"] = RobustSyn(ExperimentIterators("RobustSyn"), false);
 
-//  results["UserFeedbackSingleSyn+Opt"] = UserFeedbackSingleSyn(dataset_iterator, true);
-//  results["UserFeedbackRobustSyn+Opt"] = UserFeedbackRobustSyn(dataset_iterator, true);
+//  results["UserFeedbackSingleSyn+Opt"] = UserFeedbackSingleSyn(ExperimentIterators("UserFeedbackSingleSyn+Opt"), true);
+//  results["UserFeedbackRobustSyn+Opt"] = UserFeedbackRobustSyn(ExperimentIterators("UserFeedbackRobustSyn+Opt"), true);
 
   LOG(INFO) << "Results:";
   for (auto& it : results) {
@@ -0,0 +1,95 @@
+/*
+   Copyright 2018 Software Reliability Lab, ETH Zurich
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#include <stdio.h>
+
+#include <map>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+#include "base/fileutil.h"
+#include "inferui/datasets/dataset_util.h"
+#include "inferui/datasets/eval_journal.h"
+
+DEFINE_string(journal_dir, "", "Directory with the journals written by inferui_baseline (e.g., by each shard).");
+
+struct ExperimentJournals {
+  std::vector<std::string> files;
+  std::set<int> shard_indices;
+};
+
+// Prints the statistics of each experiment of a sharded evaluation, in the same format as inferui_baseline.
+int main(int argc, char** argv) {
+  google::InstallFailureSignalHandler();
+  google::ParseCommandLineFlags(&argc, &argv, true);
+  google::InitGoogleLogging(argv[0]);
+
+  CHECK(!FLAGS_journal_dir.empty()) << "--journal_dir is required";
+
+  // Journals are named <experiment>[.shard-i-of-n].journal. Runs of an experiment with a different number of shards
+  // (e.g., an unsharded run next to a sharded one) are reported separately.
+  std::map<std::pair<std::string, int>, ExperimentJournals> experiments;
+  for (const std::string& file : FindFiles(FLAGS_journal_dir.c_str(), ".journal")) {
+    std::string name = BaseName(file);
+    name = name.substr(0, name.size() - std::string(".journal").size());
+    int shard_index = 0, num_shards = 1;
+    size_t shard = name.find(".shard-");
+    if (shard != std::string::npos) {
+      CHECK_EQ(sscanf(name.c_str() + shard, ".shard-%d-of-%d", &shard_index, &num_shards), 2)
+          << "Invalid journal name " << file;
+      name = name.substr(0, shard);
+    }
+    ExperimentJournals& journals = experiments[std::make_pair(name, num_shards)];
+    journals.files.push_back(file);
+    journals.shard_indices.insert(shard_index);
+  }
+
+  std::map<std::string, PropertyStats> results;
+  for (const auto& it : experiments) {
+    const std::string& experiment = it.first.first;
+    const int num_shards = it.first.second;
+    const std::string name = (num_shards == 1) ? experiment : experiment + " (" + std::to_string(num_shards) + " shards)";
+    if (static_cast<int>(it.second.shard_indices.size()) != num_shards) {
+      LOG(WARNING) << "Found " << it.second.shard_indices.size() << " shards of " << experiment
+                   << " but it was run with " << num_shards << " shards";
+    }
+    std::unordered_map<std::string, Json::Value> records;
+    for (const std::string& file : it.second.files) {
+      for (const Json::Value& record : EvaluationJournal::ReadRecords(file)) {
+        if (!records.emplace(record["key"].asString(), record).second) {
+          LOG(WARNING) << "App " << record["key"].asString() << " of " << name << " evaluated more than once";
+        }
+      }
+    }
+
+    PropertyStats& stats = results[name];
+    for (const auto& record : records) {
+      stats.Merge(PropertyStats::FromJson(record.second["stats"]));
+    }
+  }
+
+  LOG(INFO) << "Results:";
+  for (auto& it : results) {
+    LOG(INFO) << "\t" << it.first;
+    it.second.Dump();
+  }
+
+  return 0;
+}
@@ -0,0 +1,229 @@
+/*
+   Copyright 2018 Software Reliability Lab, ETH Zurich
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#include "endpoint_pool.h"
+
+#include <limits>
+#include <map>
+#include <curl/curl.h>
+#include <glog/logging.h>
+
+#include "base/fileutil.h"
+#include "base/strutil.h"
+
+DEFINE_string(solver_endpoints, "localhost:9100/layout", "Comma separated list of layout solver endpoints.");
+DEFINE_string(oracle_endpoints, "localhost:4446/predict", "Comma separated list of oracle endpoints.");
+DEFINE_string(transformator_endpoints, "localhost:4242/predict", "Comma separated list of transformator endpoints.");
+DEFINE_string(visualizer_endpoints, "localhost:4446/visualize", "Comma separated list of visualizer endpoints.");
+DEFINE_string(solver_endpoints_config, "",
+              "File with endpoints that overrides the --*_endpoints flags. "
+              "Each line contains a service name (layout, oracle, transformator or visualizer) followed by its endpoints.");
+DEFINE_string(solver_balancing, "round_robin", "Load balancing across endpoints: round_robin or least_outstanding.");
+DEFINE_int32(solver_retries, 5, "Number of times a failed request is retried (on a different endpoint if possible).");
+DEFINE_int32(solver_retry_backoff_ms, 200, "Backoff before the first retry, doubled for each subsequent retry.");
+DEFINE_int32(solver_health_check_ms, 2000, "Interval of endpoint health probes. 0 disables health probes.");
+
+namespace {
+
+size_t DiscardBody(void* /*contents*/, size_t size, size_t nmemb, void* /*userp*/) {
+  return size * nmemb;
+}
+
+std::vector<std::string> SplitEndpoints(const std::string& value) {
+  std::vector<std::string> parts, urls;
+  SplitStringUsing(value, ',', &parts, false);
+  for (const std::string& part : parts) {
+    std::string url = TrimLeadingAndTrailingSpaces(part);
+    if (!url.empty()) {
+      urls.push_back(url);
+    }
+  }
+  return urls;
+}
+
+std::map<std::string, std::vector<std::string>> ReadEndpointsConfig(const std::string& path) {
+  std::map<std::string, std::vector<std::string>> res;
+  std::vector<std::string> lines;
+  SplitStringUsing(ReadFileToStringOrDie(path.c_str()), '\n', &lines, false);
+  for (const std::string& line : lines) {
+    std::string trimmed = TrimLeadingAndTrailingSpaces(line);
+    if (trimmed.empty() || trimmed[0] == '#') continue;
+
+    std::vector<std::string> parts;
+    SplitStringUsing(trimmed, ' ', &parts, false);
+    CHECK_GE(parts.size(), 2) << "Invalid line in " << path << ": '" << line << "'";
+    for (size_t i = 1; i < parts.size(); i++) {
+      res[parts[0]].push_back(parts[i]);
+    }
+  }
+  return res;
+}
+
+std::vector<std::string> ConfiguredEndpoints(const std::string& service, const std::string& flag_value) {
+  if (!FLAGS_solver_endpoints_config.empty()) {
+    static const std::map<std::string, std::vector<std::string>> config = ReadEndpointsConfig(FLAGS_solver_endpoints_config);
+    auto it = config.find(service);
+    if (it != config.end()) {
+      return it->second;
+    }
+  }
+  return SplitEndpoints(flag_value);
+}
+
+EndpointPool* CreatePool(const std::string& service, const std::string& flag_value) {
+  return new EndpointPool(service, ConfiguredEndpoints(service, flag_value),
+                          EndpointPool::ParseBalancing(FLAGS_solver_balancing),
+                          FLAGS_solver_health_check_ms);
+}
+
+}  // namespace
+
+bool ParseUnixEndpoint(const std::string& url, std::string* socket_path, std::string* request_url) {
+  static const char kPrefix[] = "unix://";
+  const size_t prefix_len = sizeof(kPrefix) - 1;
+  if (url.compare(0, prefix_len, kPrefix) != 0) {
+    return false;
+  }
+  size_t path_start = url.rfind(":/");
+  if (path_start == std::string::npos || path_start < prefix_len) {
+    *socket_path = url.substr(prefix_len);
+    *request_url = "http://localhost/";
+  } else {
+    *socket_path = url.substr(prefix_len, path_start - prefix_len);
+    *request_url = "http://localhost" + url.substr(path_start + 1);
+  }
+  CHECK(!socket_path->empty()) << "Missing socket path in endpoint " << url;
+  return true;
+}
+
+EndpointPool::EndpointPool(const std::string& name, const std::vector<std::string>& urls, Balancing balancing, int health_check_ms) :
+    pool_name(name), balancing(balancing), next(0), stopped(false) {
+  CHECK(!urls.empty()) << "No endpoints configured for " << name;
+  for (const std::string& url : urls) {
+    endpoints.emplace_back(new Endpoint(url));
+  }
+  if (health_check_ms > 0) {
+    health_thread = std::thread(&EndpointPool::HealthLoop, this, health_check_ms);
+  }
+}
+
+EndpointPool::~EndpointPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopped = true;
+  }
+  stop_cv.notify_all();
+  if (health_thread.joinable()) {
+    health_thread.join();
+  }
+}
+
+int EndpointPool::Acquire() {
+  // Fall back to all the endpoints if none of them is in rotation.
+  bool any_alive = false;
+  for (const auto& endpoint : endpoints) {
+    any_alive |= endpoint->alive;
+  }
+
+  int start = next++ % endpoints.size();
+  int best = -1;
+  for (size_t i = 0; i < endpoints.size(); i++) {
+    int candidate = (start + i) % endpoints.size();
+    if (any_alive && !endpoints[candidate]->alive) continue;
+    if (balancing == Balancing::ROUND_ROBIN) {
+      best = candidate;
+      break;
+    }
+    if (best == -1 || endpoints[candidate]->outstanding < endpoints[best]->outstanding) {
+      best = candidate;
+    }
+  }
+  CHECK_NE(best, -1);
+  endpoints[best]->outstanding++;
+  return best;
+}
+
+void EndpointPool::Release(int endpoint, bool success) {
+  Endpoint& e = *endpoints[endpoint];
+  e.outstanding--;
+  if (!success && e.alive.exchange(false)) {
+    LOG(WARNING) << "Taking " << pool_name << " endpoint " << e.url << " out of rotation";
+  }
+}
+
+bool EndpointPool::Probe(const Endpoint& endpoint) {
+  CURL* curl = curl_easy_init();
+  CHECK(curl);
+  curl_easy_setopt(curl, CURLOPT_URL, endpoint.request_url.c_str());
+  if (!endpoint.socket_path.empty()) {
+    curl_easy_setopt(curl, CURLOPT_UNIX_SOCKET_PATH, endpoint.socket_path.c_str());
+  }
+  curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, DiscardBody);
+  curl_easy_setopt(curl, CURLOPT_TIMEOUT_MS, 1000L);
+  CURLcode res = curl_easy_perform(curl);
+  long status = 0;
+  if (res == CURLE_OK) {
+    curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &status);
+  }
+  curl_easy_cleanup(curl);
+  // The services only handle POST requests, so a client error (e.g., 405) still means that the server is up
+  return status >= 200 && status < 500;
+}
+
+void EndpointPool::CheckHealth() {
+  for (const auto& endpoint : endpoints) {
+    bool alive = Probe(*endpoint);
+    if (endpoint->alive.exchange(alive) != alive) {
+      LOG(INFO) << (alive ? "Adding " : "Taking ") << pool_name << " endpoint " << endpoint->url
+                << (alive ? " back to rotation" : " out of rotation");
+    }
+  }
+}
+
+void EndpointPool::HealthLoop(int health_check_ms) {
+  std::unique_lock<std::mutex> lock(mutex);
+  while (!stop_cv.wait_for(lock, std::chrono::milliseconds(health_check_ms), [this]{ return stopped; })) {
+    lock.unlock();
+    CheckHealth();
+    lock.lock();
+  }
+}
+
+EndpointPool::Balancing EndpointPool::ParseBalancing(const std::string& value) {
+  if (value == "round_robin") return Balancing::ROUND_ROBIN;
+  if (value == "least_outstanding") return Balancing::LEAST_OUTSTANDING;
+  LOG(FATAL) << "Unknown load balancing '" << value << "'";
+}
+
+EndpointPool& EndpointPool::Layout() {
+  static EndpointPool* pool = CreatePool("layout", FLAGS_solver_endpoints);
+  return *pool;
+}
+
+EndpointPool& EndpointPool::Oracle() {
+  static EndpointPool* pool = CreatePool("oracle", FLAGS_oracle_endpoints);
+  return *pool;
+}
+
+EndpointPool& EndpointPool::Transformator() {
+  static EndpointPool* pool = CreatePool("transformator", FLAGS_transformator_endpoints);
+  return *pool;
+}
+
+EndpointPool& EndpointPool::Visualizer() {
+  static EndpointPool* pool = CreatePool("visualizer", FLAGS_visualizer_endpoints);
+  return *pool;
+}
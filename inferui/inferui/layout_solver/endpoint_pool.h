@@ -0,0 +1,128 @@
+/*
+   Copyright 2018 Software Reliability Lab, ETH Zurich
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#ifndef CC_SYNTHESIS_ENDPOINT_POOL_H
+#define CC_SYNTHESIS_ENDPOINT_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <gflags/gflags.h>
+
+DECLARE_string(solver_endpoints);
+DECLARE_string(oracle_endpoints);
+DECLARE_string(transformator_endpoints);
+DECLARE_string(visualizer_endpoints);
+DECLARE_string(solver_endpoints_config);
+DECLARE_string(solver_balancing);
+DECLARE_int32(solver_retries);
+DECLARE_int32(solver_retry_backoff_ms);
+DECLARE_int32(solver_health_check_ms);
+
+// Endpoints of the form "unix://<socket path>[:<request path>]" (e.g., "unix:///tmp/layout.sock:/layout")
+// denote a HTTP server listening on a unix domain socket instead of a TCP port.
+// Returns false for regular (TCP) endpoints.
+bool ParseUnixEndpoint(const std::string& url, std::string* socket_path, std::string* request_url);
+
+// Set of interchangeable server instances (e.g., several layout solver JVMs) used by the Solver.
+// Requests are distributed either round robin or to the instance with least outstanding requests.
+// Instances that fail a request are taken out of rotation until a health probe (a GET request answered with a status
+// below 500) succeeds again.
+class EndpointPool {
+public:
+  enum class Balancing {
+    ROUND_ROBIN = 0,
+    LEAST_OUTSTANDING
+  };
+
+  EndpointPool(const std::string& name, const std::vector<std::string>& urls, Balancing balancing, int health_check_ms);
+  ~EndpointPool();
+
+  // Picks an endpoint for the next request. Has to be followed by Release with the result of the request.
+  int Acquire();
+  void Release(int endpoint, bool success);
+
+  const std::string& url(int endpoint) const {
+    return endpoints[endpoint]->url;
+  }
+
+  // URL passed to curl, same as url() except for unix socket endpoints
+  const std::string& request_url(int endpoint) const {
+    return endpoints[endpoint]->request_url;
+  }
+
+  // Empty for TCP endpoints
+  const std::string& socket_path(int endpoint) const {
+    return endpoints[endpoint]->socket_path;
+  }
+
+  const std::string& name() const {
+    return pool_name;
+  }
+
+  size_t size() const {
+    return endpoints.size();
+  }
+
+  bool IsAlive(int endpoint) const {
+    return endpoints[endpoint]->alive;
+  }
+
+  // Probes all the endpoints once and updates which of them are in rotation.
+  void CheckHealth();
+
+  // Process wide pools configured by --*_endpoints flags or --solver_endpoints_config
+  static EndpointPool& Layout();
+  static EndpointPool& Oracle();
+  static EndpointPool& Transformator();
+  static EndpointPool& Visualizer();
+
+  static Balancing ParseBalancing(const std::string& value);
+
+private:
+  struct Endpoint {
+    explicit Endpoint(const std::string& url) : url(url), alive(true), outstanding(0) {
+      if (!ParseUnixEndpoint(url, &socket_path, &request_url)) {
+        request_url = url;
+      }
+    }
+
+    std::string url;
+    std::string request_url;
+    std::string socket_path;
+    std::atomic<bool> alive;
+    std::atomic<int> outstanding;
+  };
+
+  static bool Probe(const Endpoint& endpoint);
+  void HealthLoop(int health_check_ms);
+
+  std::string pool_name;
+  std::vector<std::unique_ptr<Endpoint>> endpoints;
+  Balancing balancing;
+  std::atomic<unsigned> next;
+
+  std::mutex mutex;
+  std::condition_variable stop_cv;
+  bool stopped;
+  std::thread health_thread;
+};
+
+#endif //CC_SYNTHESIS_ENDPOINT_POOL_H
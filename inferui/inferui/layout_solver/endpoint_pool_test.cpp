@@ -0,0 +1,177 @@
+/*
+   Copyright 2018 Software Reliability Lab, ETH Zurich
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <set>
+#include <thread>
+
+#include "gtest/gtest.h"
+#include "glog/logging.h"
+
+#include "endpoint_pool.h"
+#include "solver.h"
+
+namespace {
+
+// Listens on a free localhost port. With a status each connection is answered with it, otherwise never.
+class TestHttpServer {
+public:
+  explicit TestHttpServer(int status) : status(status) {
+    fd = socket(AF_INET, SOCK_STREAM, 0);
+    CHECK_GE(fd, 0);
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t len = sizeof(addr);
+    CHECK_EQ(bind(fd, reinterpret_cast<sockaddr*>(&addr), len), 0);
+    CHECK_EQ(listen(fd, 4), 0);
+    CHECK_EQ(getsockname(fd, reinterpret_cast<sockaddr*>(&addr), &len), 0);
+    port = ntohs(addr.sin_port);
+    if (status != 0) {
+      thread = std::thread([this] { Serve(); });
+    }
+  }
+
+  ~TestHttpServer() {
+    shutdown(fd, SHUT_RDWR);
+    close(fd);
+    if (thread.joinable()) {
+      thread.join();
+    }
+  }
+
+  std::string url() const {
+    return "localhost:" + std::to_string(port) + "/layout";
+  }
+
+private:
+  void Serve() {
+    int client;
+    while ((client = accept(fd, nullptr, nullptr)) >= 0) {
+      char request[1024];
+      if (read(client, request, sizeof(request)) > 0) {
+        std::string response = "HTTP/1.1 " + std::to_string(status) + " Status\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+        CHECK_EQ(write(client, response.data(), response.size()), static_cast<ssize_t>(response.size()));
+      }
+      close(client);
+    }
+  }
+
+  int status;
+  int fd;
+  int port;
+  std::thread thread;
+};
+
+}  // namespace
+
+TEST(EndpointPoolTest, RoundRobin) {
+  EndpointPool pool("test", {"a", "b", "c"}, EndpointPool::Balancing::ROUND_ROBIN, 0);
+  for (int i = 0; i < 6; i++) {
+    int endpoint = pool.Acquire();
+    EXPECT_EQ(endpoint, i % 3);
+    pool.Release(endpoint, true);
+  }
+}
+
+TEST(EndpointPoolTest, LeastOutstanding) {
+  EndpointPool pool("test", {"a", "b"}, EndpointPool::Balancing::LEAST_OUTSTANDING, 0);
+  int first = pool.Acquire();
+  int second = pool.Acquire();
+  EXPECT_NE(first, second);
+  // The first request is still running, new requests go to the second endpoint.
+  pool.Release(second, true);
+  EXPECT_EQ(pool.Acquire(), second);
+}
+
+TEST(EndpointPoolTest, FailedEndpointOutOfRotation) {
+  EndpointPool pool("test", {"a", "b"}, EndpointPool::Balancing::ROUND_ROBIN, 0);
+  pool.Release(pool.Acquire(), false);
+  EXPECT_FALSE(pool.IsAlive(0));
+  for (int i = 0; i < 4; i++) {
+    int endpoint = pool.Acquire();
+    EXPECT_EQ(endpoint, 1);
+    pool.Release(endpoint, true);
+  }
+
+  // Without endpoints in rotation the requests are still distributed.
+  pool.Release(pool.Acquire(), false);
+  EXPECT_FALSE(pool.IsAlive(1));
+  std::set<int> used;
+  for (int i = 0; i < 2; i++) {
+    int endpoint = pool.Acquire();
+    used.insert(endpoint);
+    pool.Release(endpoint, false);
+  }
+  EXPECT_EQ(used.size(), 2);
+}
+
+TEST(EndpointPoolTest, UnixEndpoints) {
+  std::string socket_path, request_url;
+  EXPECT_FALSE(ParseUnixEndpoint("localhost:9100/layout", &socket_path, &request_url));
+
+  EXPECT_TRUE(ParseUnixEndpoint("unix:///tmp/layout.sock:/layout", &socket_path, &request_url));
+  EXPECT_EQ(socket_path, "/tmp/layout.sock");
+  EXPECT_EQ(request_url, "http://localhost/layout");
+
+  EXPECT_TRUE(ParseUnixEndpoint("unix://oracle.sock", &socket_path, &request_url));
+  EXPECT_EQ(socket_path, "oracle.sock");
+  EXPECT_EQ(request_url, "http://localhost/");
+
+  EndpointPool pool("test", {"unix:///tmp/layout.sock:/layout", "localhost:9100/layout"},
+                    EndpointPool::Balancing::ROUND_ROBIN, 0);
+  EXPECT_EQ(pool.socket_path(0), "/tmp/layout.sock");
+  EXPECT_EQ(pool.request_url(0), "http://localhost/layout");
+  EXPECT_EQ(pool.socket_path(1), "");
+  EXPECT_EQ(pool.request_url(1), "localhost:9100/layout");
+}
+
+TEST(EndpointPoolTest, HealthProbeNeedsHttpResponse) {
+  TestHttpServer method_not_allowed(405), server_error(500), silent(0);
+  EndpointPool pool("test", {method_not_allowed.url(), server_error.url(), silent.url()},
+                    EndpointPool::Balancing::ROUND_ROBIN, 0);
+  pool.CheckHealth();
+  EXPECT_TRUE(pool.IsAlive(0));
+  EXPECT_FALSE(pool.IsAlive(1));
+  // Accepts connections (through the listen backlog) but never answers
+  EXPECT_FALSE(pool.IsAlive(2));
+}
+
+TEST(SolverTest, FailedLayoutRequestReturnsError) {
+  TestHttpServer server_error(500);
+  // Read when the layout pool is first used
+  FLAGS_solver_endpoints = server_error.url();
+  FLAGS_solver_health_check_ms = 0;
+  FLAGS_solver_retries = 1;
+  FLAGS_solver_retry_backoff_ms = 1;
+
+  Solver solver;
+  int num_responses = 0;
+  EXPECT_FALSE(solver.sendLayoutRequest("{}", [&num_responses](const std::string& /*response*/) {
+    num_responses++;
+    return true;
+  }));
+  EXPECT_EQ(0, num_responses);
+}
+
+int main(int argc, char **argv) {
+  google::InstallFailureSignalHandler();
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
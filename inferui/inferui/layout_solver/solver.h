@@ -18,13 +18,19 @@
 #ifndef CC_SYNTHESIS_SOLVER_H
 #define CC_SYNTHESIS_SOLVER_H
 
+#include <algorithm>
+#include <chrono>
 #include <memory>
+#include <thread>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <curl/curl.h>
 #include <glog/logging.h>
+#include <google/protobuf/message_lite.h>
 #include "json/json.h"
+#include "base/metrics.h"
+#include "inferui/layout_solver/endpoint_pool.h"
 
 
 class Solver {
@@ -52,46 +58,138 @@ public:
 
   Json::Value sendPost(const Json::Value& data) {
     Json::FastWriter fastWriter;
-    return sendPost(fastWriter.write(data), "localhost:9100/layout", false);
+    return sendPost(fastWriter.write(data), EndpointPool::Layout(), false);
+  }
+
+  // Sends already serialized layout request (e.g., from LayoutRequestJson)
+  Json::Value sendLayoutRequest(const std::string& data) {
+    return sendPost(data, EndpointPool::Layout(), false);
+  }
+
+  // Same as above but the raw response is passed to parse_response, which returns false if the response is invalid.
+  // @returns false if the request failed on all the endpoints.
+  template <class ParseResponse>
+  bool sendLayoutRequest(const std::string& data, ParseResponse parse_response) {
+    EndpointPool& pool = EndpointPool::Layout();
+    if (!sendPostWithRetries(data, pool, nullptr, parse_response)) {
+      LOG(ERROR) << "Layout request failed on all " << pool.name() << " endpoints after " << FLAGS_solver_retries << " retries";
+      return false;
+    }
+    return true;
+  }
+
+  bool tryParseJson(const std::string& s, Json::Value* json_response) const {
+    std::string errors;
+    return json_reader->parse(s.c_str(), s.c_str() + s.size(), json_response, &errors);
   }
 
   Json::Value sendPostToOracle(const Json::Value& data) {
   	  Json::FastWriter fastWriter;
-  	  return sendPost(fastWriter.write(data), "localhost:4446/predict", true);
+  	  return sendPost(fastWriter.write(data), EndpointPool::Oracle(), true);
   }
 
   Json::Value sendPostToTransformator(const Json::Value& data) {
 	  LOG(INFO) << "sendPostToTransformator";
   	  Json::FastWriter fastWriter;
-  	  return sendPost(fastWriter.write(data), "localhost:4242/predict", true);
+  	  return sendPost(fastWriter.write(data), EndpointPool::Transformator(), true);
   }
 
   Json::Value sendPostToVisualizer(const Json::Value& data) {
   	  Json::FastWriter fastWriter;
-  	  return sendPost(fastWriter.write(data), "localhost:4446/visualize", true);
+  	  return sendPost(fastWriter.write(data), EndpointPool::Visualizer(), true);
+  }
+
+  // Sends LayoutRequest proto (see inferui/model/layout_solver.proto) and parses the LayoutResponse.
+  // @returns false if the request failed on all the endpoints.
+  bool sendPostProto(const google::protobuf::MessageLite& request, google::protobuf::MessageLite* response) {
+    std::string data;
+    CHECK(request.SerializeToString(&data));
+    EndpointPool& pool = EndpointPool::Layout();
+    if (!sendPostWithRetries(data, pool, "Content-Type: application/x-protobuf", [response](const std::string& raw_response) {
+      return response->ParseFromString(raw_response);
+    })) {
+      LOG(ERROR) << "Layout request failed on all " << pool.name() << " endpoints after " << FLAGS_solver_retries << " retries";
+      return false;
+    }
+    return true;
+  }
+
+  Json::Value sendPost(const std::string& data, EndpointPool& pool, bool json_header) {
+    Json::Value json_response;
+    if (!sendPostWithRetries(data, pool, json_header ? "Content-Type: application/json" : nullptr, [this, &json_response](const std::string& response) {
+      return tryParseJson(response, &json_response);
+    })) {
+      LOG(FATAL) << "Request failed on all " << pool.name() << " endpoints after " << FLAGS_solver_retries << " retries";
+    }
+    return json_response;
+  }
+
+  // Sends the request to one of the pool endpoints. Failed requests (or responses not accepted by accept_response)
+  // are retried with exponential backoff at most --solver_retries times.
+  // The number of requests, failures and latencies are recorded in the "render.<pool name>" metrics.
+  template <class AcceptResponse>
+  bool sendPostWithRetries(const std::string& data, EndpointPool& pool, const char* content_type, AcceptResponse accept_response) {
+    const std::string metric = "render." + pool.name();
+    for (int attempt = 0; ; attempt++) {
+      int endpoint = pool.Acquire();
+      auto start = std::chrono::steady_clock::now();
+      bool success = sendPost(data, pool.request_url(endpoint), pool.socket_path(endpoint), content_type, &response_buffer) &&
+          accept_response(response_buffer);
+      pool.Release(endpoint, success);
+      Metrics().Increment(metric + ".requests");
+      Metrics().Record(metric + ".latency_ms",
+                       std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+      if (success) {
+        return true;
+      }
+      Metrics().Increment(metric + ".failures");
+      if (attempt >= FLAGS_solver_retries) {
+        return false;
+      }
+      LOG(WARNING) << "Request to " << pool.url(endpoint) << " failed, retrying (" << (attempt + 1) << "/" << FLAGS_solver_retries << ")";
+      // exponential backoff capped at 30s
+      std::this_thread::sleep_for(std::chrono::milliseconds(
+          std::min(FLAGS_solver_retry_backoff_ms << std::min(attempt, 10), 30000)));
+    }
   }
 
-  // Adapted code from https://curl.haxx.se/libcurl/c/postinmemory.html
   Json::Value sendPost(const std::string& data, const std::string& server, bool json_header) {
+    std::string response;
+    sendPost(data, server, json_header ? "Content-Type: application/json" : nullptr, &response);
+    return parseJson(response);
+  }
+
+  // The server can be either a URL or a unix socket endpoint (see ParseUnixEndpoint)
+  bool sendPost(const std::string& data, const std::string& server, const char* content_type, std::string* response) {
+    std::string socket_path, request_url;
+    if (ParseUnixEndpoint(server, &socket_path, &request_url)) {
+      return sendPost(data, request_url, socket_path, content_type, response);
+    }
+    return sendPost(data, server, std::string(), content_type, response);
+  }
+
+  // Adapted code from https://curl.haxx.se/libcurl/c/postinmemory.html
+  bool sendPost(const std::string& data, const std::string& server, const std::string& socket_path,
+                const char* content_type, std::string* response) {
     CHECK(curl);
     CURLcode res;
-    struct MemoryStruct chunk;
+    /* the response is appended directly to the (reused) response string */
+    response->clear();
 
-    chunk.memory = (char *) malloc(1);  /* will be grown as needed by realloc above */
-    chunk.size = 0;    /* no data at this point */
-
-	struct curl_slist *hs=NULL;
-	hs = curl_slist_append(hs, "Content-Type: application/json");
-	if(json_header){
-    	curl_easy_setopt(curl, CURLOPT_HTTPHEADER, hs);
+    struct curl_slist *hs = NULL;
+    if (content_type != nullptr) {
+      hs = curl_slist_append(hs, content_type);
     }
-	curl_easy_setopt(curl, CURLOPT_URL, server.c_str());
+    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, hs);
+    curl_easy_setopt(curl, CURLOPT_URL, server.c_str());
+    /* the handle is reused so the socket has to be reset for TCP endpoints */
+    curl_easy_setopt(curl, CURLOPT_UNIX_SOCKET_PATH, socket_path.empty() ? NULL : socket_path.c_str());
 
     /* send all data to this function  */
     curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteMemoryCallback);
 
-    /* we pass our 'chunk' struct to the callback function */
-    curl_easy_setopt(curl, CURLOPT_WRITEDATA, (void *)&chunk);
+    /* we pass the response string to the callback function */
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, (void *)response);
 
     /* some servers don't like requests that are made without a user-agent
        field, so we provide one */
@@ -105,50 +203,34 @@ public:
 
     /* Perform the request, res will get the return code */
     res = curl_easy_perform(curl);
+    long http_code = 0;
+    curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &http_code);
     /* Check for errors */
-    std::string response;
     if(res != CURLE_OK) {
-      fprintf(stderr, "curl_easy_perform() failed: %s\n",
-              curl_easy_strerror(res));
-      response = "";
+      LOG(WARNING) << "curl_easy_perform() failed for " << server << ": " << curl_easy_strerror(res);
+      response->clear();
     }
-    else {
-      /*
-       * Now, our chunk.memory points to a memory block that is chunk.size
-       * bytes big and contains the response.
-       */
-      response = std::string(chunk.memory);
+    else if (http_code >= 400) {
+      LOG(WARNING) << "Request to " << server << " failed with HTTP status " << http_code;
+      response->clear();
     }
 
-    free(chunk.memory);
-    return parseJson(response);
+    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, NULL);
+    curl_slist_free_all(hs);
+    return res == CURLE_OK && http_code < 400;
   }
 
 private:
-  struct MemoryStruct {
-    char *memory;
-    size_t size;
-  };
-
   CURL *curl;
 
   std::unique_ptr<Json::CharReader> json_reader;
 
+  // Reused between requests to avoid reallocating the response
+  std::string response_buffer;
+
   static size_t WriteMemoryCallback(void *contents, size_t size, size_t nmemb, void *userp) {
     size_t realsize = size * nmemb;
-    struct MemoryStruct *mem = (struct MemoryStruct *)userp;
-
-    mem->memory = (char *) realloc(mem->memory, mem->size + realsize + 1);
-    if(mem->memory == NULL) {
-      /* out of memory! */
-      printf("not enough memory (realloc returned NULL)\n");
-      return 0;
-    }
-
-    memcpy(&(mem->memory[mem->size]), contents, realsize);
-    mem->size += realsize;
-    mem->memory[mem->size] = 0;
-
+    static_cast<std::string*>(userp)->append(static_cast<const char*>(contents), realsize);
     return realsize;
   }
 };
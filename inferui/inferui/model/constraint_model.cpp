@@ -18,6 +18,7 @@
 #include "util/recordio/recordio.h"
 #include "base/fileutil.h"
 #include "inferui/layout_solver/solver.h"
+#include "util/thread/cost_scheduler.h"
 #include "syn_helper.h"
 
 DEFINE_double(scaling_factor, 1.0, "Scaling factor with which to resize applications.");
@@ -462,8 +463,6 @@ void ConstraintModelWrapper::Train(const std::string& data_path) {
       "za.co.dvt.android.showcase",
   };
 
-  Solver solver;
-
   std::vector<ProtoScreen> screens;
   ForEachValidApp(data_path.c_str(), [&](const ProtoApp& app) {
     if (Contains(blacklisted_apps, app.package_name())) return;
@@ -472,18 +471,24 @@ void ConstraintModelWrapper::Train(const std::string& data_path) {
 
   LOG(INFO) << "Collecting Training Apps...";
   std::vector<App> apps(screens.size());
-#pragma omp parallel for private(solver)
-  for (size_t i = 0; i < screens.size(); i++) {
+  // Screens with the most views are rendered first
+  std::vector<double> costs;
+  for (const ProtoScreen& screen : screens) {
+    costs.push_back(screen.views_size());
+  }
+  CostScheduler scheduler;
+  std::vector<Solver> solvers(scheduler.num_threads());
+  std::vector<ThreadUtilization> utilization = scheduler.Run(costs, [&](size_t i, int thread) {
+    Solver& solver = solvers[thread];
     const ProtoScreen& screen = screens[i];
 
     App ref_app(screen, true);
-    if (ref_app.GetViews().size() == 1) continue;
+    if (ref_app.GetViews().size() == 1) return;
     ref_app.InitializeAttributes(screen);
 
-    Json::Value layout = solver.sendPost(ref_app.ToJSON());
-    App rendered_app = JsonToApp(layout);
+    App rendered_app = RenderApp(ref_app, solver);
     if (!AppMatch(ref_app, rendered_app)) {
-      continue;
+      return;
     }
 
     if (FLAGS_scaling_factor != 1) {
@@ -495,7 +500,8 @@ void ConstraintModelWrapper::Train(const std::string& data_path) {
       ScaleAttributes(rendered_app, FLAGS_scaling_factor);
     }
     apps[i] = rendered_app;
-  }
+  });
+  CostScheduler::LogUtilization(utilization);
 
   LOG(INFO) << "Training...";
   int app_id = 0;
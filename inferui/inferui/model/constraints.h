@@ -33,13 +33,17 @@ public:
   ConstraintGenerator() {
   }
 
+  // The generators take optional anchors (indexed by the pos of the views), if set only the constraints anchored to
+  // at least one of the marked views are generated.
+
   template <class Callback>
-  void GenFixedSizeCenteringConstraints(const Orientation& orientation, View& src, std::vector<View>& views, const Callback& cb) const {
+  void GenFixedSizeCenteringConstraints(const Orientation& orientation, View& src, std::vector<View>& views, const Callback& cb,
+                                        const std::vector<bool>* anchors = nullptr) const {
     std::vector<ConstraintType> types = (orientation == Orientation::HORIZONTAL)
                                         ? std::vector<ConstraintType>{ ConstraintType::L2LxR2L, ConstraintType::L2LxR2R, ConstraintType::L2RxR2L, ConstraintType::L2RxR2R }
                                         : std::vector<ConstraintType>{ ConstraintType::T2TxB2T, ConstraintType::T2TxB2B, ConstraintType::T2BxB2T, ConstraintType::T2BxB2B };
 
-    Product(views, [&types, &views, &cb, &src, this](View& l, View& r) {
+    AnchorPairs(views, anchors, [&types, &views, &cb, &src, this](View& l, View& r) {
       if (l == src || r == src) return;
 
       for (const ConstraintType& type : types) {
@@ -59,12 +63,14 @@ public:
   }
 
   template <class Callback>
-  void GenFixedSizeRelationalConstraints(const Orientation& orientation, View& src, std::vector<View>& views, const Callback& cb) const {
+  void GenFixedSizeRelationalConstraints(const Orientation& orientation, View& src, std::vector<View>& views, const Callback& cb,
+                                         const std::vector<bool>* anchors = nullptr) const {
     std::vector<ConstraintType> types = (orientation == Orientation::HORIZONTAL)
                                         ? std::vector<ConstraintType>{ ConstraintType::L2L, ConstraintType::L2R, ConstraintType::R2L, ConstraintType::R2R }
                                         : std::vector<ConstraintType>{ ConstraintType::T2T, ConstraintType::T2B, ConstraintType::B2T, ConstraintType::B2B };
     for (View& view : views) {
       if (view == src) continue;
+      if (anchors != nullptr && !(*anchors)[view.pos]) continue;
 
       for (const ConstraintType& type : types) {
         if (view.is_content_frame() && (
@@ -103,14 +109,15 @@ public:
   }
 
   template <class Callback>
-  void GenMatchConstraintCenteringConstraints(const Orientation& orientation, View& src, std::vector<View>& views, const Callback& cb) const {
+  void GenMatchConstraintCenteringConstraints(const Orientation& orientation, View& src, std::vector<View>& views, const Callback& cb,
+                                              const std::vector<bool>* anchors = nullptr) const {
     // match_constraint needs two constraints to specify the view dimensions
 
     std::vector<ConstraintType> types = (orientation == Orientation::HORIZONTAL)
                                         ? std::vector<ConstraintType>{ ConstraintType::L2LxR2L, ConstraintType::L2LxR2R, ConstraintType::L2RxR2L, ConstraintType::L2RxR2R }
                                         : std::vector<ConstraintType>{ ConstraintType::T2TxB2T, ConstraintType::T2TxB2B, ConstraintType::T2BxB2T, ConstraintType::T2BxB2B };
 
-    Product(views, [&types, &views, &cb, &src, this](View& l, View& r) {
+    AnchorPairs(views, anchors, [&types, &views, &cb, &src, this](View& l, View& r) {
       if (l == src || r == src) return;
 
       for (const ConstraintType& type : types) {
@@ -128,6 +135,32 @@ public:
   }
 
 private:
+  // All the pairs of views, or with anchors only the pairs with at least one marked view
+  template <class Callback>
+  static void AnchorPairs(std::vector<View>& views, const std::vector<bool>* anchors, const Callback& cb) {
+    if (anchors == nullptr) {
+      Product(views, cb);
+      return;
+    }
+    std::vector<View*> anchor_views;
+    for (View& view : views) {
+      if ((*anchors)[view.pos]) {
+        anchor_views.push_back(&view);
+      }
+    }
+    for (View& l : views) {
+      if ((*anchors)[l.pos]) {
+        for (View& r : views) {
+          cb(l, r);
+        }
+      } else {
+        for (View* r : anchor_views) {
+          cb(l, *r);
+        }
+      }
+    }
+  }
+
 //  const Model* model_;
 };
 
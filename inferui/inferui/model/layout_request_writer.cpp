@@ -0,0 +1,275 @@
+/*
+   Copyright 2018 Software Reliability Lab, ETH Zurich
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#include "layout_request_writer.h"
+
+#include <algorithm>
+#include <array>
+#include <stdio.h>
+
+namespace {
+
+const std::string kParent = "parent";
+
+struct Property {
+  enum class Kind {
+    STRING = 0,
+    PX,
+    BIAS
+  };
+
+  const std::string* key;
+  Kind kind;
+  const std::string* str;
+  int value;
+  float bias;
+};
+
+// Properties of a single view, mirrors the std::unordered_map built by View::ToProperties
+class PropertyList {
+public:
+  PropertyList() : size(0) {
+  }
+
+  void AddString(const std::string& key, const std::string& value) {
+    Property& p = Add(key, Property::Kind::STRING);
+    p.str = &value;
+  }
+
+  void AddPx(const std::string& key, int value) {
+    Property& p = Add(key, Property::Kind::PX);
+    p.value = value;
+  }
+
+  void AddBias(const std::string& key, float bias) {
+    Property& p = Add(key, Property::Kind::BIAS);
+    p.bias = bias;
+  }
+
+  // Json::Value objects are ordered by key (memcmp, then length) which is the same as std::string::compare
+  void Sort() {
+    std::sort(properties.begin(), properties.begin() + size, [](const Property& a, const Property& b) {
+      return a.key->compare(*b.key) < 0;
+    });
+    for (int i = 1; i < size; i++) {
+      DCHECK_NE(*properties[i - 1].key, *properties[i].key);
+    }
+  }
+
+  const Property* begin() const {
+    return properties.data();
+  }
+
+  const Property* end() const {
+    return properties.data() + size;
+  }
+
+private:
+  Property& Add(const std::string& key, Property::Kind kind) {
+    CHECK_LT(size, static_cast<int>(properties.size()));
+    Property& p = properties[size++];
+    p.key = &key;
+    p.kind = kind;
+    return p;
+  }
+
+  std::array<Property, 32> properties;
+  int size;
+};
+
+Constants::Name ConstraintTypeToName(const ConstraintType& type) {
+  switch (type) {
+    case ConstraintType::L2L: return Constants::layout_constraintLeft_toLeftOf;
+    case ConstraintType::L2R: return Constants::layout_constraintLeft_toRightOf;
+    case ConstraintType::R2L: return Constants::layout_constraintRight_toLeftOf;
+    case ConstraintType::R2R: return Constants::layout_constraintRight_toRightOf;
+    case ConstraintType::T2T: return Constants::layout_constraintTop_toTopOf;
+    case ConstraintType::T2B: return Constants::layout_constraintTop_toBottomOf;
+    case ConstraintType::B2T: return Constants::layout_constraintBottom_toTopOf;
+    case ConstraintType::B2B: return Constants::layout_constraintBottom_toBottomOf;
+    default:
+      LOG(FATAL) << "Unknown constraint type";
+  }
+  LOG(FATAL) << "Unknown constraint type";
+}
+
+// Same as Attribute::AlignToProperties
+void AddAlignProperties(const ConstraintType& type, const View* tgt, int value_primary, int value_secondary,
+                        const Constants::Type& output_type, PropertyList* properties) {
+  Constants::Name name = ConstraintTypeToName(type);
+  properties->AddString(Constants::nameRef(name, output_type), (tgt->id == 0) ? kParent : tgt->id_string);
+
+  CHECK(value_primary == 0 || value_secondary == 0);
+  if (value_primary != 0 || value_secondary != 0) {
+    properties->AddPx(Constants::nameRef(ConstraintTypeToMargin(name), output_type), value_primary + value_secondary);
+  }
+}
+
+// Same as Attribute::ToProperties
+void AddAttributeProperties(const Attribute& attr, const Constants::Type& output_type, PropertyList* properties) {
+  if (!IsCenterAnchor(attr.type)) {
+    AddAlignProperties(attr.type, attr.tgt_primary, attr.value_primary, attr.value_secondary, output_type, properties);
+    return;
+  }
+
+  auto types = SplitCenterAnchor(attr.type);
+  AddAlignProperties(types.first, attr.tgt_primary, attr.value_primary, 0, output_type, properties);
+  AddAlignProperties(types.second, attr.tgt_secondary, attr.value_secondary, 0, output_type, properties);
+  if (attr.bias != 0.5) {
+    properties->AddBias(Constants::nameRef(
+        (ConstraintTypeToOrientation(attr.type) == Orientation::HORIZONTAL) ?
+        Constants::layout_constraintHorizontal_bias : Constants::layout_constraintVertical_bias, output_type), attr.bias);
+  }
+}
+
+void AddViewSize(const Constants::Name& name, const ViewSize& size, int value,
+                 const Constants::Type& output_type, PropertyList* properties) {
+  const std::string& key = Constants::nameRef(name, output_type);
+  if (size == ViewSize::MATCH_CONSTRAINT) {
+    properties->AddString(key, Constants::nameRef(Constants::MATCH_CONSTRAINT, Constants::OUTPUT_XML));
+  } else if (size == ViewSize::MATCH_PARENT) {
+    properties->AddString(key, Constants::nameRef(Constants::MATCH_PARENT, Constants::OUTPUT_XML));
+  } else {
+    CHECK_EQ(size, ViewSize::FIXED);
+    properties->AddPx(key, value);
+  }
+}
+
+// Same as View::ToProperties
+void AddViewProperties(const View& view, bool is_root, const Constants::Type& output_type, PropertyList* properties) {
+  // App::ToJSON renames the root view to parent
+  properties->AddString(Constants::nameRef(Constants::ID, output_type), is_root ? kParent : view.id_string);
+
+  const Padding& padding = view.padding;
+  if (padding.paddingLeft != 0) {
+    properties->AddPx(Constants::nameRef(Constants::paddingLeft, output_type), padding.paddingLeft);
+  }
+  if (padding.paddingRight != 0) {
+    properties->AddPx(Constants::nameRef(Constants::paddingRight, output_type), padding.paddingRight);
+  }
+  if (padding.paddingTop != 0) {
+    properties->AddPx(Constants::nameRef(Constants::paddingTop, output_type), padding.paddingTop);
+  }
+  if (padding.paddingBottom != 0) {
+    properties->AddPx(Constants::nameRef(Constants::paddingBottom, output_type), padding.paddingBottom);
+  }
+
+  if (!view.is_content_frame()) {
+    CHECK_EQ(view.attributes.size(), 2);
+    for (const auto& it : view.attributes) {
+      if (it.first == Orientation::HORIZONTAL) {
+        AddViewSize(Constants::layout_width, it.second.view_size, view.xright - view.xleft, output_type, properties);
+      } else if (it.first == Orientation::VERTICAL) {
+        AddViewSize(Constants::layout_height, it.second.view_size, view.ybottom - view.ytop, output_type, properties);
+      }
+    }
+  } else {
+    properties->AddPx(Constants::nameRef(Constants::layout_width, output_type), view.xright - view.xleft);
+    properties->AddPx(Constants::nameRef(Constants::layout_height, output_type), view.ybottom - view.ytop);
+  }
+
+  for (const auto& it : view.attributes) {
+    AddAttributeProperties(it.second, output_type, properties);
+  }
+}
+
+void AppendInt(int value, std::string* out) {
+  char buffer[16];
+  int len = snprintf(buffer, sizeof(buffer), "%d", value);
+  out->append(buffer, len);
+}
+
+// Same escaping as valueToQuotedStringN in jsoncpp
+void AppendQuoted(const std::string& value, std::string* out) {
+  out->push_back('"');
+  for (char c : value) {
+    switch (c) {
+      case '"': out->append("\\\""); break;
+      case '\\': out->append("\\\\"); break;
+      case '\b': out->append("\\b"); break;
+      case '\f': out->append("\\f"); break;
+      case '\n': out->append("\\n"); break;
+      case '\r': out->append("\\r"); break;
+      case '\t': out->append("\\t"); break;
+      default:
+        if (c > 0 && c <= 0x1F) {
+          char buffer[8];
+          int len = snprintf(buffer, sizeof(buffer), "\\u%04X", static_cast<int>(c));
+          out->append(buffer, len);
+        } else {
+          out->push_back(c);
+        }
+    }
+  }
+  out->push_back('"');
+}
+
+void AppendValue(const Property& property, std::string* out) {
+  switch (property.kind) {
+    case Property::Kind::STRING:
+      AppendQuoted(*property.str, out);
+      break;
+    case Property::Kind::PX:
+      out->push_back('"');
+      AppendInt(property.value, out);
+      out->append("px\"");
+      break;
+    case Property::Kind::BIAS: {
+      // same format as std::to_string(float)
+      char buffer[64];
+      int len = snprintf(buffer, sizeof(buffer), "\"%f\"", property.bias);
+      out->append(buffer, len);
+      break;
+    }
+  }
+}
+
+}  // namespace
+
+void WriteLayoutRequest(const App& app, std::string* out, const Constants::Type& output_type) {
+  const std::vector<View>& views = app.GetViews();
+  CHECK(!views.empty());
+
+  out->clear();
+  out->append("{\"layout\":[");
+  for (size_t i = 0; i < views.size(); i++) {
+    if (i > 0) out->push_back(',');
+
+    PropertyList properties;
+    AddViewProperties(views[i], i == 0, output_type, &properties);
+    properties.Sort();
+
+    out->push_back('{');
+    for (const Property& property : properties) {
+      if (&property != properties.begin()) out->push_back(',');
+      AppendQuoted(*property.key, out);
+      out->push_back(':');
+      AppendValue(property, out);
+    }
+    out->push_back('}');
+  }
+  out->append("],\"x_offset\":");
+  AppendInt(views[0].xleft, out);
+  out->append(",\"y_offset\":");
+  AppendInt(views[0].ytop, out);
+  out->append("}\n");
+}
+
+const std::string& LayoutRequestJson(const App& app, const Constants::Type& output_type) {
+  static thread_local std::string buffer;
+  WriteLayoutRequest(app, &buffer, output_type);
+  return buffer;
+}
@@ -0,0 +1,34 @@
+/*
+   Copyright 2018 Software Reliability Lab, ETH Zurich
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#ifndef CC_SYNTHESIS_LAYOUT_REQUEST_WRITER_H
+#define CC_SYNTHESIS_LAYOUT_REQUEST_WRITER_H
+
+#include <string>
+#include "inferui/model/model.h"
+
+// Serializes the app into the JSON layout solver request in a single pass.
+// The output is byte-identical to Json::FastWriter().write(app.ToJSON(output_type))
+// but no intermediate property maps or Json::Value trees are built.
+void WriteLayoutRequest(const App& app, std::string* out,
+                        const Constants::Type& output_type = Constants::Type::OUTPUT_XML);
+
+// Same as WriteLayoutRequest but reuses a per thread buffer.
+// The returned string is valid until the next call from the same thread.
+const std::string& LayoutRequestJson(const App& app,
+                                     const Constants::Type& output_type = Constants::Type::OUTPUT_XML);
+
+#endif //CC_SYNTHESIS_LAYOUT_REQUEST_WRITER_H
@@ -0,0 +1,246 @@
+/*
+   Copyright 2018 Software Reliability Lab, ETH Zurich
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#include "layout_response_parser.h"
+
+#include <string.h>
+#include "inferui/model/util/util.h"
+
+namespace {
+
+struct ParsedView {
+  bool has_location;
+  int location[4];
+  bool has_id;
+  std::string id;
+};
+
+// Recursive descent parser of the layout solver response:
+//   {"content_frame": {"name": ..., "location": [x, y, w, h]},
+//    "components": [{"id": ..., "location": [x, y, w, h]}, ...]}
+// Keys can come in any order and unknown keys are skipped.
+class ResponseReader {
+public:
+  ResponseReader(const char* begin, const char* end) : p(begin), end(end) {
+  }
+
+  bool ParseResponse(ParsedView* content_frame, std::vector<ParsedView>* components, size_t* num_components) {
+    bool has_content_frame = false;
+    *num_components = 0;
+    if (!Consume('{')) return false;
+    if (Consume('}')) return false;
+    do {
+      if (!ParseString(&key) || !Consume(':')) return false;
+      if (key == "content_frame") {
+        if (!ParseView(content_frame)) return false;
+        has_content_frame = true;
+      } else if (key == "components") {
+        if (!Consume('[')) return false;
+        if (!Consume(']')) {
+          do {
+            if (*num_components == components->size()) {
+              components->emplace_back();
+            }
+            if (!ParseView(&(*components)[(*num_components)++])) return false;
+          } while (Consume(','));
+          if (!Consume(']')) return false;
+        }
+      } else {
+        if (!SkipValue()) return false;
+      }
+    } while (Consume(','));
+    if (!Consume('}')) return false;
+    SkipWhitespace();
+    return has_content_frame && p == end;
+  }
+
+private:
+  bool ParseView(ParsedView* view) {
+    view->has_location = false;
+    view->has_id = false;
+    if (!Consume('{')) return false;
+    if (Consume('}')) return false;
+    do {
+      if (!ParseString(&key) || !Consume(':')) return false;
+      if (key == "location") {
+        if (!Consume('[')) return false;
+        for (int i = 0; i < 4; i++) {
+          if (i > 0 && !Consume(',')) return false;
+          if (!ParseInt(&view->location[i])) return false;
+        }
+        if (!Consume(']')) return false;
+        view->has_location = true;
+      } else if (key == "id") {
+        if (!ParseString(&view->id)) return false;
+        view->has_id = true;
+      } else {
+        if (!SkipValue()) return false;
+      }
+    } while (Consume(','));
+    return Consume('}') && view->has_location;
+  }
+
+  void SkipWhitespace() {
+    while (p != end && (*p == ' ' || *p == '\n' || *p == '\r' || *p == '\t')) p++;
+  }
+
+  bool Consume(char c) {
+    SkipWhitespace();
+    if (p != end && *p == c) {
+      p++;
+      return true;
+    }
+    return false;
+  }
+
+  bool ParseString(std::string* out) {
+    if (!Consume('"')) return false;
+    out->clear();
+    while (p != end && *p != '"') {
+      if (*p != '\\') {
+        out->push_back(*p++);
+        continue;
+      }
+      if (++p == end) return false;
+      switch (*p++) {
+        case '"': out->push_back('"'); break;
+        case '\\': out->push_back('\\'); break;
+        case '/': out->push_back('/'); break;
+        case 'b': out->push_back('\b'); break;
+        case 'f': out->push_back('\f'); break;
+        case 'n': out->push_back('\n'); break;
+        case 'r': out->push_back('\r'); break;
+        case 't': out->push_back('\t'); break;
+        default:
+          // unicode escapes are left to the jsoncpp parser
+          return false;
+      }
+    }
+    if (p == end) return false;
+    p++;
+    return true;
+  }
+
+  bool ParseInt(int* value) {
+    SkipWhitespace();
+    bool negative = false;
+    if (p != end && *p == '-') {
+      negative = true;
+      p++;
+    }
+    if (p == end || *p < '0' || *p > '9') return false;
+    long long res = 0;
+    while (p != end && *p >= '0' && *p <= '9') {
+      res = res * 10 + (*p++ - '0');
+      if (res > (negative ? 2147483648LL : 2147483647LL)) return false;
+    }
+    // fractions and exponents are left to the jsoncpp parser
+    if (p != end && (*p == '.' || *p == 'e' || *p == 'E')) return false;
+    *value = static_cast<int>(negative ? -res : res);
+    return true;
+  }
+
+  bool SkipLiteral(const char* literal) {
+    size_t len = strlen(literal);
+    if (static_cast<size_t>(end - p) < len || strncmp(p, literal, len) != 0) return false;
+    p += len;
+    return true;
+  }
+
+  bool SkipValue() {
+    SkipWhitespace();
+    if (p == end) return false;
+    switch (*p) {
+      case '"':
+        return ParseString(&skipped);
+      case '{':
+        p++;
+        if (Consume('}')) return true;
+        do {
+          if (!ParseString(&skipped) || !Consume(':') || !SkipValue()) return false;
+        } while (Consume(','));
+        return Consume('}');
+      case '[':
+        p++;
+        if (Consume(']')) return true;
+        do {
+          if (!SkipValue()) return false;
+        } while (Consume(','));
+        return Consume(']');
+      case 't':
+        return SkipLiteral("true");
+      case 'f':
+        return SkipLiteral("false");
+      case 'n':
+        return SkipLiteral("null");
+      default: {
+        const char* start = p;
+        while (p != end && (strchr("+-.eE", *p) != nullptr || (*p >= '0' && *p <= '9'))) p++;
+        return p != start;
+      }
+    }
+  }
+
+  const char* p;
+  const char* end;
+  std::string key;
+  std::string skipped;
+};
+
+int ParseViewId(const std::string& id) {
+  static const char kPrefix[] = "@+id/view";
+  const size_t prefix_len = sizeof(kPrefix) - 1;
+  if (id.size() > prefix_len && id.size() < prefix_len + 10 && id.compare(0, prefix_len, kPrefix) == 0) {
+    int res = 0;
+    size_t i = prefix_len;
+    for (; i < id.size() && id[i] >= '0' && id[i] <= '9'; i++) {
+      res = res * 10 + (id[i] - '0');
+    }
+    if (i == id.size()) {
+      return res;
+    }
+  }
+  return ValueParser::parseViewSeqID(id);
+}
+
+// Same as JsonToView
+View ParsedViewToView(const ParsedView& view) {
+  return View(view.location[0], view.location[1],
+              view.location[2] + view.location[0],
+              view.location[3] + view.location[1],
+              view.has_id ? view.id : "", view.has_id ? ParseViewId(view.id) : 0);
+}
+
+}  // namespace
+
+bool ParseLayoutResponse(const char* begin, const char* end, App* app) {
+  CHECK(app->GetViews().empty());
+  static thread_local ParsedView content_frame;
+  static thread_local std::vector<ParsedView> components;
+  size_t num_components = 0;
+
+  ResponseReader reader(begin, end);
+  if (!reader.ParseResponse(&content_frame, &components, &num_components)) {
+    return false;
+  }
+
+  app->GetViews().reserve(num_components + 1);
+  app->AddView(ParsedViewToView(content_frame));
+  for (size_t i = 0; i < num_components; i++) {
+    app->AddView(ParsedViewToView(components[i]));
+  }
+  return true;
+}
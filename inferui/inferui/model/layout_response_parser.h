@@ -0,0 +1,33 @@
+/*
+   Copyright 2018 Software Reliability Lab, ETH Zurich
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#ifndef CC_SYNTHESIS_LAYOUT_RESPONSE_PARSER_H
+#define CC_SYNTHESIS_LAYOUT_RESPONSE_PARSER_H
+
+#include <string>
+#include "inferui/model/model.h"
+
+// Parses the JSON layout solver response directly into views of the (empty) app
+// without building a Json::Value tree. The result is the same as JsonToApp(response).
+// @returns false if the response does not have the expected schema, in which case
+// the app is left empty and the response should be parsed using JsonToApp.
+bool ParseLayoutResponse(const char* begin, const char* end, App* app);
+
+inline bool ParseLayoutResponse(const std::string& response, App* app) {
+  return ParseLayoutResponse(response.data(), response.data() + response.size(), app);
+}
+
+#endif //CC_SYNTHESIS_LAYOUT_RESPONSE_PARSER_H
@@ -550,3 +550,40 @@ void WriteAppToFile(const App& app, std::string name, bool with_attributes) {
   }
   out.close();
 }
+
+bool ValidSynthesisApp(const ProtoApp& app, ValueCounter<std::string>* stats) {
+  CHECK_GT(app.screens_size(), 0);
+
+  const ProtoScreen &screen = app.screens(0);
+  if (!ValidApp(screen, stats)) {
+    return false;
+  }
+
+  App syn_app(screen, true);
+  if (syn_app.GetViews().size() == 1) {
+    stats->Add("empty layout");
+    return false;
+  }
+  syn_app.InitializeAttributes(screen);
+
+  for (auto& orientation : {Orientation::HORIZONTAL, Orientation::VERTICAL}) {
+    for (auto &view : syn_app.GetViews()) {
+      if (view.is_content_frame()) continue;
+      const Attribute& attr = view.attributes.at(orientation);
+      if (view.IsCircularRelation(orientation, attr)) {
+        stats->Add("Circular relation");
+        return false;
+      }
+    }
+  }
+
+  for (auto& view : syn_app.GetViews()) {
+    if (view.is_content_frame()) continue;
+    if (view.attributes.at(Orientation::HORIZONTAL).view_size == ViewSize::MATCH_PARENT ||
+        view.attributes.at(Orientation::VERTICAL).view_size == ViewSize::MATCH_PARENT) {
+      stats->Add("depreceated match_parent constraints");
+      return false;
+    }
+  }
+  return true;
+}
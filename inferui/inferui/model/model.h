@@ -36,6 +36,7 @@
 #include "inferui/model/uidump.pb.h"
 #include "json/json.h"
 #include "inferui/model/util/util.h"
+#include "util/recordio/parallel_reader.h"
 
 
 enum class ConstraintType {
@@ -1236,47 +1237,27 @@ public:
 
 
 
-template <class Cb>
-void ForEachValidApp(const std::string& data_path, const Cb& cb) {
-  ValueCounter<std::string> stats;
-  ForEachRecord<ProtoApp>(data_path.c_str(), [&](const ProtoApp &app) {
-    CHECK_GT(app.screens_size(), 0);
-
-    const ProtoScreen &screen = app.screens(0);
-    if (!ValidApp(screen, &stats)) {
-      return true;
-    }
-
-    App syn_app(screen, true);
-    if (syn_app.GetViews().size() == 1) {
-      stats.Add("empty layout");
-      return true;
-    }
-    syn_app.InitializeAttributes(screen);
-
-    for (auto& orientation : {Orientation::HORIZONTAL, Orientation::VERTICAL}) {
-      for (auto &view : syn_app.GetViews()) {
-        if (view.is_content_frame()) continue;
-        const Attribute& attr = view.attributes.at(orientation);
-        if (view.IsCircularRelation(orientation, attr)) {
-          stats.Add("Circular relation");
-          return true;
-        }
-      }
-    }
-
-    for (auto& view : syn_app.GetViews()) {
-      if (view.is_content_frame()) continue;
-      if (view.attributes.at(Orientation::HORIZONTAL).view_size == ViewSize::MATCH_PARENT ||
-          view.attributes.at(Orientation::VERTICAL).view_size == ViewSize::MATCH_PARENT) {
-        stats.Add("depreceated match_parent constraints");
-        return true;
-      }
-    }
+// Checks that the first screen of the app is a valid synthesis input, the reason of rejected apps is added to stats.
+bool ValidSynthesisApp(const ProtoApp& app, ValueCounter<std::string>* stats);
 
+// Apps are read, parsed and validated in parallel and cb is called on the calling thread.
+template <class Cb>
+void ForEachValidApp(const std::string& data_path, const Cb& cb,
+                     ParallelReaderOptions options = ParallelReaderOptions()) {
+  if (options.num_threads <= 0) {
+    options.num_threads = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+  }
+  std::vector<ValueCounter<std::string>> thread_stats(options.num_threads);
+  ForEachRecordParallel<ProtoApp>(data_path, options, [&](int thread, const ProtoApp& app) {
+    return ValidSynthesisApp(app, &thread_stats[thread]);
+  }, [&](const ProtoApp& app) {
     cb(app);
     return true;
   });
+  ValueCounter<std::string> stats;
+  for (const auto& counter : thread_stats) {
+    stats = stats + counter;
+  }
   LOG(INFO) << stats;
 }
 
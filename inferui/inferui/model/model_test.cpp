@@ -18,6 +18,10 @@
 #include "glog/logging.h"
 
 #include "model.h"
+#include "syn_helper.h"
+#include "layout_request_writer.h"
+#include "layout_response_parser.h"
+#include "synthesis.h"
 
 TEST(ModelTest, AttrSize) {
   AttrSizeModel model;
@@ -199,6 +203,252 @@ TEST(ModelTest, AnchorTest2) {
 
 }
 
+TEST(ModelTest, LayoutRequestProto) {
+  App app;
+  app.AddView(View(0, 50, 720, 1250, "Root", 0));
+  app.AddView(View(10, 60, 110, 160, "Button", 1));
+  app.AddView(View(200, 60, 300, 160, "Button", 2));
+
+  std::vector<View>& views = app.GetViews();
+  views[1].attributes.emplace(Orientation::HORIZONTAL, Attribute(ConstraintType::L2L, ViewSize::FIXED, 10, &views[1], &views[0]));
+  views[1].attributes.emplace(Orientation::VERTICAL, Attribute(ConstraintType::T2T, ViewSize::FIXED, 10, &views[1], &views[0]));
+  views[2].attributes.emplace(Orientation::HORIZONTAL, Attribute(ConstraintType::L2RxR2R, ViewSize::MATCH_CONSTRAINT, 5, 0, &views[2], &views[1], &views[0], 0.25));
+  views[2].attributes.emplace(Orientation::VERTICAL, Attribute(ConstraintType::T2T, ViewSize::FIXED, 0, &views[2], &views[1]));
+
+  LayoutRequest request;
+  AppToLayoutRequest(app, &request);
+  ASSERT_EQ(request.views_size(), 3);
+  EXPECT_EQ(request.x_offset(), 0);
+  EXPECT_EQ(request.y_offset(), 50);
+  EXPECT_EQ(request.views(0).width().value(), 720);
+  EXPECT_EQ(request.views(0).height().value(), 1200);
+  EXPECT_EQ(request.views(1).width().behaviour(), LayoutDimension::FIXED);
+  EXPECT_EQ(request.views(1).width().value(), 100);
+  EXPECT_EQ(request.views(1).constraints_size(), 2);
+
+  const LayoutRequestView& view = request.views(2);
+  EXPECT_EQ(view.width().behaviour(), LayoutDimension::MATCH_CONSTRAINT);
+  EXPECT_EQ(view.horizontal_bias(), 0.25);
+  EXPECT_EQ(view.vertical_bias(), 0.5);
+  ASSERT_EQ(view.constraints_size(), 3);
+  int num_horizontal = 0;
+  for (const LayoutConstraint& constraint : view.constraints()) {
+    if (constraint.anchor() == LayoutConstraint::LEFT) {
+      EXPECT_EQ(constraint.target_anchor(), LayoutConstraint::RIGHT);
+      EXPECT_EQ(constraint.target(), 1);
+      EXPECT_EQ(constraint.margin(), 5);
+      num_horizontal++;
+    } else if (constraint.anchor() == LayoutConstraint::RIGHT) {
+      EXPECT_EQ(constraint.target_anchor(), LayoutConstraint::RIGHT);
+      EXPECT_EQ(constraint.target(), 0);
+      EXPECT_EQ(constraint.margin(), 0);
+      num_horizontal++;
+    } else {
+      EXPECT_EQ(constraint.anchor(), LayoutConstraint::TOP);
+      EXPECT_EQ(constraint.target(), 1);
+    }
+  }
+  EXPECT_EQ(num_horizontal, 2);
+
+  LayoutResponse response;
+  LayoutLocation* content_frame = response.mutable_content_frame();
+  content_frame->set_y(50);
+  content_frame->set_width(720);
+  content_frame->set_height(1200);
+  for (size_t i = 1; i < views.size(); i++) {
+    LayoutLocation* location = response.add_components();
+    location->set_x(views[i].xleft);
+    location->set_y(views[i].ytop);
+    location->set_width(views[i].width());
+    location->set_height(views[i].height());
+  }
+  App rendered_app = LayoutResponseToApp(app, response);
+  EXPECT_TRUE(AppMatch(app, rendered_app));
+  EXPECT_EQ(rendered_app.GetViews()[2].id, 2);
+}
+
+TEST(ModelTest, LayoutRequestJson) {
+  App app;
+  app.AddView(View(0, 50, 720, 1250, "Root", 0));
+  app.AddView(View(10, 60, 110, 160, "Button", 1));
+  app.AddView(View(200, 60, 300, 160, "Button", 2));
+  app.AddView(View(0, 200, 720, 400, "Text", 3, "@+id/\"quoted\"\tid"));
+
+  std::vector<View>& views = app.GetViews();
+  views[0].padding.paddingLeft = 4;
+  views[0].padding.paddingBottom = 8;
+  views[1].attributes.emplace(Orientation::HORIZONTAL, Attribute(ConstraintType::L2L, ViewSize::FIXED, 10, &views[1], &views[0]));
+  views[1].attributes.emplace(Orientation::VERTICAL, Attribute(ConstraintType::T2T, ViewSize::FIXED, 10, &views[1], &views[0]));
+  views[2].attributes.emplace(Orientation::HORIZONTAL, Attribute(ConstraintType::L2RxR2R, ViewSize::MATCH_CONSTRAINT, 5, 0, &views[2], &views[1], &views[0], 0.25));
+  views[2].attributes.emplace(Orientation::VERTICAL, Attribute(ConstraintType::B2B, ViewSize::FIXED, 0, 7, &views[2], &views[1]));
+  views[3].attributes.emplace(Orientation::HORIZONTAL, Attribute(ConstraintType::L2LxR2R, ViewSize::MATCH_PARENT, 0, 3, &views[3], &views[0], &views[0]));
+  views[3].attributes.emplace(Orientation::VERTICAL, Attribute(ConstraintType::T2BxB2B, ViewSize::FIXED, 1, 2, &views[3], &views[2], &views[0], 0.7));
+
+  const std::string golden =
+      "{\"layout\":["
+      "{\"android:id\":\"parent\",\"android:layout_height\":\"1200px\",\"android:layout_width\":\"720px\","
+      "\"android:paddingBottom\":\"8px\",\"android:paddingLeft\":\"4px\"},"
+      "{\"android:id\":\"@+id/view1\",\"android:layout_height\":\"100px\",\"android:layout_marginLeft\":\"10px\","
+      "\"android:layout_marginTop\":\"10px\",\"android:layout_width\":\"100px\","
+      "\"app:layout_constraintLeft_toLeftOf\":\"parent\",\"app:layout_constraintTop_toTopOf\":\"parent\"},"
+      "{\"android:id\":\"@+id/view2\",\"android:layout_height\":\"100px\",\"android:layout_marginBottom\":\"7px\","
+      "\"android:layout_marginLeft\":\"5px\",\"android:layout_width\":\"0dp\","
+      "\"app:layout_constraintBottom_toBottomOf\":\"@+id/view1\",\"app:layout_constraintHorizontal_bias\":\"0.250000\","
+      "\"app:layout_constraintLeft_toRightOf\":\"@+id/view1\",\"app:layout_constraintRight_toRightOf\":\"parent\"},"
+      "{\"android:id\":\"@+id/\\\"quoted\\\"\\tid\",\"android:layout_height\":\"200px\",\"android:layout_marginBottom\":\"2px\","
+      "\"android:layout_marginRight\":\"3px\",\"android:layout_marginTop\":\"1px\",\"android:layout_width\":\"match_parent\","
+      "\"app:layout_constraintBottom_toBottomOf\":\"parent\",\"app:layout_constraintLeft_toLeftOf\":\"parent\","
+      "\"app:layout_constraintRight_toRightOf\":\"parent\",\"app:layout_constraintTop_toBottomOf\":\"@+id/view2\","
+      "\"app:layout_constraintVertical_bias\":\"0.700000\"}"
+      "],\"x_offset\":0,\"y_offset\":50}\n";
+
+  Json::FastWriter fastWriter;
+  EXPECT_EQ(fastWriter.write(app.ToJSON()), golden);
+  EXPECT_EQ(LayoutRequestJson(app), golden);
+
+  std::string out;
+  WriteLayoutRequest(app, &out, Constants::Type::INPUT_XML);
+  EXPECT_EQ(out, fastWriter.write(app.ToJSON(Constants::Type::INPUT_XML)));
+}
+
+TEST(ModelTest, LayoutResponseParser) {
+  const std::vector<std::string> responses = {
+      "{\"content_frame\":{\"name\":\"android.support.v7.widget.ContentFrameLayout\",\"location\":[0,50,720,1200]},"
+      "\"components\":[{\"location\":[10,60,100,100],\"id\":\"@+id/view1\"},{\"id\":\"@+id/view12\",\"location\":[-5,60,0,100]}]}",
+      " { \"components\" : [ ] ,\n \"content_frame\" : { \"location\" : [ 0 , 0 , 10 , 20 ] , \"extra\" : [ { \"a\" : null } , true , 1.5e3 ] } } \n",
+  };
+
+  Solver solver;
+  for (const std::string& response : responses) {
+    App app;
+    ASSERT_TRUE(ParseLayoutResponse(response, &app)) << response;
+    App expected = JsonToApp(solver.parseJson(response));
+    ASSERT_EQ(app.GetViews().size(), expected.GetViews().size());
+    EXPECT_TRUE(AppMatch(app, expected));
+    for (size_t i = 0; i < app.GetViews().size(); i++) {
+      EXPECT_EQ(app.GetViews()[i].id, expected.GetViews()[i].id);
+      EXPECT_EQ(app.GetViews()[i].name, expected.GetViews()[i].name);
+    }
+  }
+
+  // Responses that have to be handled by jsoncpp
+  for (const char* response : {
+      "{\"error\": \"ParseException\"}",
+      "{\"content_frame\":{\"location\":[0.5,0,720,1200]},\"components\":[]}",
+      "{\"content_frame\":{\"location\":[0,0,720,1200]},\"components\":[{\"id\":\"\\u0040+id/view1\",\"location\":[0,0,1,1]}]}",
+      "{\"content_frame\":{\"location\":[0,0,720,1200]}"}) {
+    App app;
+    EXPECT_FALSE(ParseLayoutResponse(response, &app)) << response;
+    EXPECT_TRUE(app.GetViews().empty());
+  }
+}
+
+
+// Depends on the other views through the number of intersections, like the trained models
+class IntersectionTestModel : public ProbModel {
+public:
+  IntersectionTestModel() : ProbModel("intersections") {
+  }
+
+  std::string DebugProb(const Attribute& /*attr*/, const std::vector<View>& /*views*/) const override {
+    return "";
+  }
+
+  double AttrProb(const Attribute& attr, const std::vector<View>& views) const override {
+    num_scored++;
+    double res = -attr.value_primary - attr.value_secondary - static_cast<int>(attr.type) * 0.001;
+    std::vector<std::pair<ConstraintType, const View*>> lines;
+    if (IsRelationalAnchor(attr.type)) {
+      lines.emplace_back(attr.type, attr.tgt_primary);
+    } else {
+      const auto types = SplitCenterAnchor(attr.type);
+      lines.emplace_back(types.first, attr.tgt_primary);
+      lines.emplace_back(types.second, attr.tgt_secondary);
+    }
+    for (const auto& line : lines) {
+      const LineSegment& segment = LineTo(attr.src, line.second, line.first);
+      for (const View& view : views) {
+        if (view == *attr.src || view == *line.second) continue;
+        if (segment.Intersects(view)) {
+          res -= 1000;
+        }
+      }
+    }
+    return res;
+  }
+
+  mutable int num_scored = 0;
+};
+
+std::vector<std::string> CandidateStrings(const ConstraintCache& cache, int view_id) {
+  std::vector<std::string> res;
+  for (int rank = 0; rank < cache.NumConstraints(view_id); rank++) {
+    const Attribute* attr = cache.GetAttr(view_id, rank);
+    res.push_back(StringPrintf("%d %d %d %d %d %d %f", static_cast<int>(attr->type), static_cast<int>(attr->view_size),
+                               attr->value_primary, attr->value_secondary, attr->tgt_primary->id,
+                               (attr->tgt_secondary == nullptr) ? -1 : attr->tgt_secondary->id, attr->prob));
+  }
+  std::sort(res.begin(), res.end());
+  return res;
+}
+
+TEST(ModelTest, ConstraintCacheUpdateViews) {
+  IntersectionTestModel model;
+  std::vector<View> views = {
+      View(0, 0, 400, 600, "Root", 0),
+      View(10, 10, 110, 60, "Button", 1),
+      View(150, 10, 250, 60, "Button", 2),
+      View(10, 100, 110, 150, "TextView", 3),
+      View(150, 100, 390, 150, "TextView", 4),
+      View(100, 300, 300, 350, "Button", 5),
+  };
+  for (size_t i = 0; i < views.size(); i++) {
+    views[i].pos = i;
+  }
+
+  for (const Orientation& orientation : {Orientation::HORIZONTAL, Orientation::VERTICAL}) {
+    for (const std::vector<int>& moved : std::vector<std::vector<int>>{{3}, {1, 5}, {0}}) {
+      std::vector<View> updated_views = views;
+      ConstraintCache cache(&model, updated_views, orientation);
+
+      std::vector<View> old_views;
+      for (int pos : moved) {
+        old_views.push_back(updated_views[pos]);
+        // Moves the view across the others
+        updated_views[pos].xleft += 120;
+        updated_views[pos].xright += 120;
+        updated_views[pos].ytop += 80;
+        updated_views[pos].ybottom += 80;
+      }
+      model.num_scored = 0;
+      std::vector<int> regenerated;
+      int num_updated = cache.UpdateViews(updated_views, old_views, &regenerated);
+      int update_scored = model.num_scored;
+
+      model.num_scored = 0;
+      ConstraintCache expected(&model, updated_views, orientation);
+      if (moved[0] == 0) {
+        // Moving the content frame changes the margins of all the views
+        EXPECT_EQ(std::vector<int>({1, 2, 3, 4, 5}), regenerated);
+        EXPECT_EQ(static_cast<int>(views.size()) - 1, num_updated);
+        EXPECT_EQ(model.num_scored, update_scored);
+      } else {
+        EXPECT_EQ(moved, regenerated);
+        EXPECT_GE(num_updated, static_cast<int>(moved.size()));
+        EXPECT_LT(update_scored, model.num_scored);
+      }
+      ASSERT_EQ(expected.size(), cache.size());
+      for (size_t id = 1; id < views.size(); id++) {
+        EXPECT_EQ(CandidateStrings(expected, id), CandidateStrings(cache, id)) << "view " << id;
+        EXPECT_EQ(expected.GetAttr(id, 0)->prob, cache.GetAttr(id, 0)->prob);
+      }
+      for (auto it = expected.begin(); it != expected.end(); it++) {
+        EXPECT_EQ(expected.IsAllowed(&(*it)), cache.IsAllowed(&(*it)));
+      }
+    }
+  }
+}
+
 
 int main(int argc, char **argv) {
   google::InstallFailureSignalHandler();
@@ -15,11 +15,15 @@
  */
 
 #include "syn_helper.h"
+#include "layout_request_writer.h"
+#include "layout_response_parser.h"
 #include "base/fileutil.h"
 #include "base/range.h"
 
 #include <unordered_set>
 
+DEFINE_bool(solver_proto, false, "Send layout solver requests encoded as protobuf instead of JSON.");
+
 /*
  *
  */
@@ -264,7 +268,7 @@ void NormalizeMargins(App* ref_app, Solver& solver) {
   if (!HasUnnormalizedAttributes(*ref_app)) return;
 
   App app = *ref_app;
-  App rendered_app = JsonToApp(solver.sendPost(app.ToJSON()));
+  App rendered_app = RenderApp(app, solver);
   if (!AppMatch(app, rendered_app)) {
     return;
   }
@@ -294,7 +298,7 @@ void NormalizeMargins(App* ref_app, Solver& solver) {
         break;
       }
 
-      rendered_app = JsonToApp(solver.sendPost(app.ToJSON()));
+      rendered_app = RenderApp(app, solver);
       if (!AppMatch(app, rendered_app)) {
         LOG(INFO) << "Failed, Apps do not match";
         app = *ref_app;
@@ -311,7 +315,7 @@ void NormalizeMargins(App* ref_app, Solver& solver) {
 
 bool TryFixInconsistencies(App* ref_app, Solver& solver) {
   App app = *ref_app;
-  App rendered_app = JsonToApp(solver.sendPost(app.ToJSON()));
+  App rendered_app = RenderApp(app, solver);
   if (AppMatch(app, rendered_app)) return true;
 
   for (const auto& orientation : {Orientation::HORIZONTAL, Orientation::VERTICAL}) {
@@ -333,7 +337,7 @@ bool TryFixInconsistencies(App* ref_app, Solver& solver) {
         }
       }
 
-      rendered_app = JsonToApp(solver.sendPost(app.ToJSON()));
+      rendered_app = RenderApp(app, solver);
       auto cview_ids = FindNonMatchingViews(app, rendered_app, orientation);
       if (cview_ids.size() == view_ids.size()) {
         // fixing view did not help
@@ -425,6 +429,145 @@ App JsonToApp(const Json::Value& layout) {
   return app;
 }
 
+LayoutConstraint::Anchor ConstraintTypeToAnchor(const ConstraintType& type, bool target) {
+  switch (type) {
+    case ConstraintType::L2L: return LayoutConstraint::LEFT;
+    case ConstraintType::L2R: return target ? LayoutConstraint::RIGHT : LayoutConstraint::LEFT;
+    case ConstraintType::R2L: return target ? LayoutConstraint::LEFT : LayoutConstraint::RIGHT;
+    case ConstraintType::R2R: return LayoutConstraint::RIGHT;
+    case ConstraintType::T2T: return LayoutConstraint::TOP;
+    case ConstraintType::T2B: return target ? LayoutConstraint::BOTTOM : LayoutConstraint::TOP;
+    case ConstraintType::B2T: return target ? LayoutConstraint::TOP : LayoutConstraint::BOTTOM;
+    case ConstraintType::B2B: return LayoutConstraint::BOTTOM;
+    default:
+      LOG(FATAL) << "Unknown constraint type";
+  }
+  LOG(FATAL) << "Unknown constraint type";
+}
+
+void AddLayoutConstraint(const App& app, const ConstraintType& type, const View* tgt, int margin, LayoutRequestView* view) {
+  LayoutConstraint* constraint = view->add_constraints();
+  constraint->set_anchor(ConstraintTypeToAnchor(type, false));
+  constraint->set_target_anchor(ConstraintTypeToAnchor(type, true));
+  if (!tgt->is_content_frame()) {
+    CHECK_EQ(app.GetViews()[tgt->pos].id, tgt->id);
+    constraint->set_target(tgt->pos);
+  }
+  constraint->set_margin(margin);
+}
+
+void SetLayoutDimension(const ViewSize& size, int value, LayoutDimension* dimension) {
+  switch (size) {
+    case ViewSize::MATCH_CONSTRAINT: dimension->set_behaviour(LayoutDimension::MATCH_CONSTRAINT); break;
+    case ViewSize::MATCH_PARENT: dimension->set_behaviour(LayoutDimension::MATCH_PARENT); break;
+    case ViewSize::FIXED:
+      dimension->set_behaviour(LayoutDimension::FIXED);
+      dimension->set_value(value);
+      break;
+  }
+}
+
+void AppToLayoutRequest(const App& app, LayoutRequest* request) {
+  request->Clear();
+  for (const View& view : app.GetViews()) {
+    LayoutRequestView* proto_view = request->add_views();
+    proto_view->set_padding_left(view.padding.paddingLeft);
+    proto_view->set_padding_top(view.padding.paddingTop);
+    proto_view->set_padding_right(view.padding.paddingRight);
+    proto_view->set_padding_bottom(view.padding.paddingBottom);
+    proto_view->set_horizontal_bias(0.5);
+    proto_view->set_vertical_bias(0.5);
+
+    if (view.is_content_frame()) {
+      SetLayoutDimension(ViewSize::FIXED, view.width(), proto_view->mutable_width());
+      SetLayoutDimension(ViewSize::FIXED, view.height(), proto_view->mutable_height());
+      continue;
+    }
+
+    CHECK_EQ(view.attributes.size(), 2);
+    for (const auto& it : view.attributes) {
+      const Attribute& attr = it.second;
+      if (it.first == Orientation::HORIZONTAL) {
+        SetLayoutDimension(attr.view_size, view.width(), proto_view->mutable_width());
+      } else {
+        SetLayoutDimension(attr.view_size, view.height(), proto_view->mutable_height());
+      }
+
+      if (IsCenterAnchor(attr.type)) {
+        auto types = SplitCenterAnchor(attr.type);
+        AddLayoutConstraint(app, types.first, attr.tgt_primary, attr.value_primary, proto_view);
+        AddLayoutConstraint(app, types.second, attr.tgt_secondary, attr.value_secondary, proto_view);
+        if (it.first == Orientation::HORIZONTAL) {
+          proto_view->set_horizontal_bias(attr.bias);
+        } else {
+          proto_view->set_vertical_bias(attr.bias);
+        }
+      } else {
+        CHECK(attr.value_primary == 0 || attr.value_secondary == 0);
+        AddLayoutConstraint(app, attr.type, attr.tgt_primary, attr.value_primary + attr.value_secondary, proto_view);
+      }
+    }
+  }
+
+  request->set_x_offset(app.GetViews()[0].xleft);
+  request->set_y_offset(app.GetViews()[0].ytop);
+}
+
+View LayoutLocationToView(const LayoutLocation& location, std::string name, int id) {
+  return View(location.x(), location.y(),
+              location.x() + location.width(),
+              location.y() + location.height(),
+              name, id);
+}
+
+App LayoutResponseToApp(const App& app, const LayoutResponse& response) {
+  CHECK_EQ(response.components_size() + 1, app.GetViews().size());
+  App rendered_app;
+  rendered_app.AddView(LayoutLocationToView(response.content_frame(), "android.support.v7.widget.ContentFrameLayout", 0));
+  for (int i = 0; i < response.components_size(); i++) {
+    const View& view = app.GetViews()[i + 1];
+    rendered_app.AddView(LayoutLocationToView(response.components(i), view.id_string, view.id));
+  }
+  return rendered_app;
+}
+
+bool TryRenderApp(const App& app, Solver& solver, App* rendered_app) {
+  if (!FLAGS_solver_proto) {
+    return solver.sendLayoutRequest(LayoutRequestJson(app), [&solver, rendered_app](const std::string& response) {
+      rendered_app->GetViews().clear();
+      if (ParseLayoutResponse(response, rendered_app)) {
+        return true;
+      }
+      LOG(WARNING) << "Unexpected layout solver response, falling back to jsoncpp";
+      Json::Value layout;
+      if (!solver.tryParseJson(response, &layout)) {
+        return false;
+      }
+      *rendered_app = JsonToApp(layout);
+      return true;
+    });
+  }
+
+  LayoutRequest request;
+  AppToLayoutRequest(app, &request);
+  LayoutResponse response;
+  if (!solver.sendPostProto(request, &response)) {
+    return false;
+  }
+  if (!response.error().empty()) {
+    LOG(ERROR) << "Layout solver error: " << response.error();
+    return false;
+  }
+  *rendered_app = LayoutResponseToApp(app, response);
+  return true;
+}
+
+App RenderApp(const App& app, Solver& solver) {
+  App rendered_app;
+  CHECK(TryRenderApp(app, solver, &rendered_app)) << "Could not render the app";
+  return rendered_app;
+}
+
 void ScaleAppInner(Json::Value& value, double factor) {
   if (value.isArray()) {
     for (auto& elem : value) {
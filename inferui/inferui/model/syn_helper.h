@@ -18,8 +18,11 @@
 #define CC_SYNTHESIS_SYN_HELPER_H
 
 #include "inferui/model/model.h"
+#include "inferui/model/layout_solver.pb.h"
 #include "inferui/layout_solver/solver.h"
 
+DECLARE_bool(solver_proto);
+
 // Try to fix inconsistencies of z3 solver and the Android layout solver by adjusting margins
 // @returns true if rendering synthesized layout (in ref_app) using solver leads to same positions
 bool TryFixInconsistencies(App* ref_app, Solver& solver);
@@ -57,6 +60,15 @@ View JsonToView(const Json::Value& value);
 
 App JsonToApp(const Json::Value& layout);
 
+void AppToLayoutRequest(const App& app, LayoutRequest* request);
+App LayoutResponseToApp(const App& app, const LayoutResponse& response);
+
+// Renders the app using the layout solver, the wire format is selected by --solver_proto.
+// @returns false if the layout solver could not render the app.
+bool TryRenderApp(const App& app, Solver& solver, App* rendered_app);
+// Same as TryRenderApp but fails if the app could not be rendered
+App RenderApp(const App& app, Solver& solver);
+
 Json::Value ScaleApp(Json::Value value, double factor);
 
 void ScaleAttributes(App& app, double scaling_factor);
@@ -46,6 +46,62 @@ public:
     InitializePrune();
   }
 
+  // Updates the candidates after the location of some views changed (the views keep their positions).
+  // old_views contains the previous version of each changed view.
+  // Only the candidates of the changed views, candidates anchored to them and candidates whose anchor line
+  // crosses their old or new location (which changes the number of intersections) are recomputed.
+  // The positions of the views whose candidates were generated again from scratch are added to regenerated.
+  // @returns the number of views whose candidates were recomputed or rescored.
+  int UpdateViews(std::vector<View>& views, const std::vector<View>& old_views, std::vector<int>* regenerated = nullptr) {
+    std::vector<bool> changed(views.size(), false);
+    for (const View& old_view : old_views) {
+      CHECK_GE(old_view.pos, 0);
+      CHECK_LT(old_view.pos, views.size());
+      changed[old_view.pos] = true;
+    }
+
+    int num_updated = 0;
+    if (changed[0]) {
+      // Margins to the content frame change for all the views
+      InitializeBaseConstraints(views);
+      num_updated = candidate_attrs_.size();
+      if (regenerated != nullptr) {
+        for (const View& view : views) {
+          if (!view.is_content_frame()) regenerated->push_back(view.pos);
+        }
+      }
+    } else {
+      size_t i = 0;
+      for (auto& view : views) {
+        if (view.is_content_frame()) continue;
+        std::vector<Attribute>& attrs = candidate_attrs_[i++];
+        if (changed[view.pos]) {
+          attrs = GenAttributesForApp(view, views);
+          for (Attribute& attr : attrs) {
+            attr.prob = model_->AttrProb(attr, views);
+          }
+          num_updated++;
+          if (regenerated != nullptr) {
+            regenerated->push_back(view.pos);
+          }
+        } else if (UpdateAttributes(view, views, old_views, changed, &attrs)) {
+          num_updated++;
+        } else {
+          continue;
+        }
+
+        std::sort(attrs.begin(), attrs.end(), [this](const Attribute &a, const Attribute &b) {
+          return a.prob > b.prob;
+        });
+        CHECK(!attrs.empty());
+      }
+    }
+
+    allowed_targets.assign(views.size(), std::vector<bool>(views.size(), false));
+    InitializePrune();
+    return num_updated;
+  }
+
   void InitializePrune() {
     for (auto it = begin(); it != end(); it++) {
       const Attribute& attr = *it;
@@ -190,23 +246,69 @@ public:
 
 private:
 
-  std::vector<Attribute> GenAttributesForApp(View& view, std::vector<View>& views) {
+  // With anchors only the candidates anchored to the marked views (see ConstraintGenerator)
+  std::vector<Attribute> GenAttributesForApp(View& view, std::vector<View>& views,
+                                             const std::vector<bool>* anchors = nullptr) {
     ConstraintGenerator gen;
     std::vector<Attribute> attrs;
     gen.GenFixedSizeRelationalConstraints(orientation_, view, views, [&attrs](Attribute&& attr) {
       attrs.emplace_back(attr);
-    });
+    }, anchors);
 
     gen.GenFixedSizeCenteringConstraints(orientation_, view, views, [&attrs](Attribute&& attr) {
       attrs.emplace_back(attr);
-    });
+    }, anchors);
 
     gen.GenMatchConstraintCenteringConstraints(orientation_, view, views, [&attrs](Attribute&& attr) {
       attrs.emplace_back(attr);
-    });
+    }, anchors);
     return attrs;
   }
 
+  static bool IsAnchoredTo(const Attribute& attr, const std::vector<bool>& changed) {
+    return changed[attr.tgt_primary->pos] || (attr.tgt_secondary != nullptr && changed[attr.tgt_secondary->pos]);
+  }
+
+  static bool Crosses(const Attribute& attr, const View& view) {
+    if (IsRelationalAnchor(attr.type)) {
+      return LineTo(attr.src, attr.tgt_primary, attr.type).Intersects(view);
+    }
+    const auto types = SplitCenterAnchor(attr.type);
+    return LineTo(attr.src, attr.tgt_primary, types.first).Intersects(view) ||
+        LineTo(attr.src, attr.tgt_secondary, types.second).Intersects(view);
+  }
+
+  // Updates candidates of an unchanged view, returns false if none of them is affected by the change
+  bool UpdateAttributes(View& view, std::vector<View>& views, const std::vector<View>& old_views,
+                        const std::vector<bool>& changed, std::vector<Attribute>* attrs) {
+    bool updated = false;
+    std::vector<Attribute> res;
+    for (Attribute& attr : *attrs) {
+      if (IsAnchoredTo(attr, changed)) {
+        updated = true;
+        continue;
+      }
+      for (const View& old_view : old_views) {
+        if (Crosses(attr, old_view) || Crosses(attr, views[old_view.pos])) {
+          attr.prob = model_->AttrProb(attr, views);
+          updated = true;
+          break;
+        }
+      }
+      res.push_back(attr);
+    }
+
+    // Candidates anchored to the changed views are regenerated as their margins changed
+    for (Attribute& attr : GenAttributesForApp(view, views, &changed)) {
+      attr.prob = model_->AttrProb(attr, views);
+      res.push_back(attr);
+      updated = true;
+    }
+    if (updated) {
+      *attrs = std::move(res);
+    }
+    return updated;
+  }
 
   void InitializeBaseConstraints(std::vector<View>& views) {
     candidate_attrs_.clear();
@@ -130,6 +130,11 @@ public:
   }
 
   static const std::string name(Name name, Type type) {
+    return nameRef(name, type);
+  }
+
+  // Same as name(name, type) but returns reference to the interned value instead of a copy
+  static const std::string& nameRef(Name name, Type type) {
     switch (type) {
       case INPUT_XML:
         return values_xml[static_cast<int>(name)];
@@ -0,0 +1,120 @@
+/*
+   Copyright 2018 Software Reliability Lab, ETH Zurich
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#include "cancellation.h"
+
+#include <algorithm>
+
+namespace {
+
+thread_local ScopedCancellation* current_scope = nullptr;
+
+}  // namespace
+
+void CancellationToken::Cancel() {
+  std::lock_guard<std::mutex> lock(mutex);
+  cancelled = true;
+  for (z3::context* c : contexts) {
+    c->interrupt();
+  }
+}
+
+void CancellationToken::InterruptIfExpired() {
+  if (!IsExpired()) {
+    return;
+  }
+  std::lock_guard<std::mutex> lock(mutex);
+  if (contexts.empty()) {
+    return;
+  }
+  deadline_interrupted = true;
+  for (z3::context* c : contexts) {
+    c->interrupt();
+  }
+}
+
+unsigned CancellationToken::TimeoutMs(unsigned timeout_ms) const {
+  if (cancelled) {
+    return 1;
+  }
+  if (deadline == Clock::time_point::max()) {
+    return timeout_ms;
+  }
+  auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - Clock::now()).count();
+  return static_cast<unsigned>(std::max<long long>(1, std::min<long long>(remaining, timeout_ms)));
+}
+
+void CancellationToken::Register(z3::context* c) {
+  std::lock_guard<std::mutex> lock(mutex);
+  contexts.insert(c);
+}
+
+void CancellationToken::Unregister(z3::context* c) {
+  std::lock_guard<std::mutex> lock(mutex);
+  contexts.erase(c);
+}
+
+ScopedCancellation::ScopedCancellation(CancellationToken* token)
+    : token(token), previous(current_scope), was_interrupted(false), deadline_capped(false) {
+  current_scope = this;
+}
+
+ScopedCancellation::~ScopedCancellation() {
+  current_scope = previous;
+}
+
+CancellationToken* ScopedCancellation::Current() {
+  return (current_scope == nullptr) ? nullptr : current_scope->token;
+}
+
+bool ScopedCancellation::IsStopped() {
+  CancellationToken* token = Current();
+  return token != nullptr && (token->IsCancelled() || token->IsExpired());
+}
+
+void ScopedCancellation::MarkInterrupted() {
+  if (current_scope != nullptr) {
+    current_scope->was_interrupted = true;
+  }
+}
+
+ScopedInterruptible::ScopedInterruptible(z3::context& c) : c(c), token(ScopedCancellation::Current()) {
+  if (token != nullptr) {
+    token->Register(&c);
+  }
+}
+
+ScopedInterruptible::~ScopedInterruptible() {
+  if (token != nullptr) {
+    token->Unregister(&c);
+    // Solves of the context were interrupted or ran into the shortened timeout
+    if (token->IsCancelled() || token->IsDeadlineInterrupted() ||
+        (current_scope != nullptr && current_scope->deadline_capped && token->IsExpired())) {
+      ScopedCancellation::MarkInterrupted();
+    }
+  }
+}
+
+unsigned SolverTimeoutMs(unsigned timeout_ms) {
+  if (current_scope == nullptr || current_scope->token == nullptr) {
+    return timeout_ms;
+  }
+  unsigned res = current_scope->token->TimeoutMs(timeout_ms);
+  if (res < timeout_ms) {
+    current_scope->deadline_capped = true;
+  }
+  return res;
+}
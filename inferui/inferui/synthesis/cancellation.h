@@ -0,0 +1,120 @@
+/*
+   Copyright 2018 Software Reliability Lab, ETH Zurich
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#ifndef CC_SYNTHESIS_CANCELLATION_H
+#define CC_SYNTHESIS_CANCELLATION_H
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <set>
+#include "z3++.h"
+
+// Deadline and cancellation state of a single synthesis request.
+// Z3 contexts created on a thread where the token is active (see ScopedCancellation)
+// are interrupted when the token is cancelled and their solver timeouts are capped by the deadline.
+class CancellationToken {
+public:
+  typedef std::chrono::steady_clock Clock;
+
+  CancellationToken() : deadline(Clock::time_point::max()), cancelled(false), deadline_interrupted(false) {
+  }
+
+  explicit CancellationToken(Clock::time_point deadline)
+      : deadline(deadline), cancelled(false), deadline_interrupted(false) {
+  }
+
+  // Interrupts all the running solves. Solves started afterwards time out immediately.
+  void Cancel();
+
+  bool IsCancelled() const {
+    return cancelled;
+  }
+
+  bool IsExpired() const {
+    return Clock::now() >= deadline;
+  }
+
+  // Interrupts the running solves if the deadline passed, without cancelling the token.
+  void InterruptIfExpired();
+
+  // True if running solves were interrupted by InterruptIfExpired.
+  bool IsDeadlineInterrupted() const {
+    return deadline_interrupted;
+  }
+
+  // Returns timeout_ms capped by the time left until the deadline (at least 1ms).
+  unsigned TimeoutMs(unsigned timeout_ms) const;
+
+  void Register(z3::context* c);
+  void Unregister(z3::context* c);
+
+private:
+  const Clock::time_point deadline;
+  std::atomic<bool> cancelled;
+  std::atomic<bool> deadline_interrupted;
+
+  std::mutex mutex;
+  std::set<z3::context*> contexts;
+};
+
+// Makes the token current for the calling thread during the lifetime of the object.
+class ScopedCancellation {
+public:
+  explicit ScopedCancellation(CancellationToken* token);
+  ~ScopedCancellation();
+
+  // True if work done in the scope was cut off by the cancellation or the deadline of the token.
+  bool interrupted() const {
+    return was_interrupted;
+  }
+
+  // nullptr if no request is active on the calling thread
+  static CancellationToken* Current();
+
+  // True if the token of the calling thread is cancelled or its deadline passed.
+  static bool IsStopped();
+
+  // Records that the work on the calling thread was cut off by its token (e.g., an interrupted solve).
+  static void MarkInterrupted();
+
+private:
+  friend class ScopedInterruptible;
+  friend unsigned SolverTimeoutMs(unsigned timeout_ms);
+
+  CancellationToken* token;
+  ScopedCancellation* previous;
+  bool was_interrupted;
+  // A solver timeout was shortened to end at the deadline
+  bool deadline_capped;
+};
+
+// Registers Z3 context with the current token (if any), so that it can be interrupted.
+// Has to be destroyed before the context.
+class ScopedInterruptible {
+public:
+  explicit ScopedInterruptible(z3::context& c);
+  ~ScopedInterruptible();
+
+private:
+  z3::context& c;
+  CancellationToken* token;
+};
+
+// Solver timeout capped by the deadline of the request running on the calling thread.
+unsigned SolverTimeoutMs(unsigned timeout_ms);
+
+#endif //CC_SYNTHESIS_CANCELLATION_H
@@ -0,0 +1,133 @@
+/*
+   Copyright 2018 Software Reliability Lab, ETH Zurich
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#include "layout_session.h"
+
+#include <algorithm>
+
+namespace {
+
+// Unlike the App copy constructor keeps the view sizes and id strings
+void CopyViews(const App& from, App* to) {
+  to->GetViews().clear();
+  for (const View& view : from.GetViews()) {
+    View copy(view);
+    copy.attributes.clear();
+    to->AddView(std::move(copy));
+  }
+}
+
+bool SameLocation(const View& a, const View& b) {
+  return a.xleft == b.xleft && a.xright == b.xright && a.ytop == b.ytop && a.ybottom == b.ybottom;
+}
+
+}  // namespace
+
+LayoutSession::LayoutSession(const ProbModel* model, App&& input, const Device& ref_device, const std::vector<Device>& devices, bool opt)
+    : model(model), ref_device(ref_device), devices(devices), opt(opt), has_result(false), num_updated_candidates(0) {
+  CopyViews(input, &app);
+  app.SetResizable(ref_device, devices);
+  InitializeDeviceApps();
+
+  Timer timer;
+  timer.StartScope("prob_model");
+  scorer_vertical.reset(new AttrScorer(model, app, Orientation::VERTICAL));
+  scorer_horizontal.reset(new AttrScorer(model, app, Orientation::HORIZONTAL));
+  timer.EndScope();
+  timer.Dump();
+}
+
+void LayoutSession::InitializeDeviceApps() {
+  device_apps.clear();
+  for (const Device& device : devices) {
+    device_apps.emplace_back(ResizeApp(app, ref_device, device));
+  }
+}
+
+bool LayoutSession::UpdateViews(const std::vector<View>& updates) {
+  std::vector<int> positions;
+  for (const View& update : updates) {
+    const std::vector<View>& views = app.GetViews();
+    auto it = std::find_if(views.begin(), views.end(), [&update](const View& view) {
+      return view.id == update.id;
+    });
+    if (it == views.end()) {
+      return false;
+    }
+    positions.push_back(it - views.begin());
+  }
+
+  std::vector<View> old_views;
+  for (size_t i = 0; i < updates.size(); i++) {
+    const View& update = updates[i];
+    View& view = app.GetViews()[positions[i]];
+    if (view.view_size != update.view_size) {
+      // Only restricts which candidates are allowed
+      view.view_size = update.view_size;
+      has_result = false;
+    }
+    if (SameLocation(view, update)) continue;
+
+    old_views.push_back(view);
+    view.xleft = update.xleft;
+    view.xright = update.xright;
+    view.ytop = update.ytop;
+    view.ybottom = update.ybottom;
+  }
+
+  num_updated_candidates = 0;
+  if (old_views.empty()) {
+    return true;
+  }
+  has_result = false;
+
+  Timer timer;
+  timer.StartScope("prob_model_update");
+  if (std::any_of(old_views.begin(), old_views.end(), [](const View& view) { return view.is_content_frame(); })) {
+    InitializeDeviceApps();
+  }
+  num_updated_candidates = std::max(
+      scorer_vertical->UpdateViews(app, old_views),
+      scorer_horizontal->UpdateViews(app, old_views));
+  timer.EndScope();
+  timer.Dump();
+  LOG(INFO) << "Updated candidates of " << num_updated_candidates << " views";
+  return true;
+}
+
+const SynResult& LayoutSession::Synthesize() {
+  if (has_result) {
+    return result;
+  }
+
+  CopyViews(app, &result.app);
+  result.app.SetResizable(ref_device, devices);
+  // Device apps are modified by the synthesis
+  std::vector<App> apps = device_apps;
+
+  Timer timer;
+  FullSynthesis syn;
+  result.status = syn.SynthesizeMultiDeviceProb(result.app, Orientation::VERTICAL, scorer_vertical.get(), ref_device, apps, timer, false, !devices.empty(), opt);
+  if (result.status == Status::SUCCESS) {
+    result.status = syn.SynthesizeMultiDeviceProb(result.app, Orientation::HORIZONTAL, scorer_horizontal.get(), ref_device, apps, timer, false, !devices.empty(), opt);
+  }
+  timer.Dump();
+
+  // Interrupted results are not reused
+  CancellationToken* token = ScopedCancellation::Current();
+  has_result = (token == nullptr || (!token->IsCancelled() && !token->IsExpired()));
+  return result;
+}
@@ -0,0 +1,74 @@
+/*
+   Copyright 2018 Software Reliability Lab, ETH Zurich
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#ifndef CC_SYNTHESIS_LAYOUT_SESSION_H
+#define CC_SYNTHESIS_LAYOUT_SESSION_H
+
+#include <memory>
+#include <vector>
+#include "inferui/synthesis/z3inference.h"
+
+// Layout edited interactively (e.g., in the studio plugin).
+// Keeps the candidate constraints of both orientations and the resized device apps between synthesis calls.
+// After an edit only the candidates affected by the moved views are recomputed (see ConstraintCache::UpdateViews)
+// and the synthesized layout is reused until the next edit.
+// Not thread safe, the object must not be moved as the candidates point to its views.
+class LayoutSession {
+public:
+  LayoutSession(const ProbModel* model, App&& app, const Device& ref_device, const std::vector<Device>& devices, bool opt);
+
+  LayoutSession(const LayoutSession&) = delete;
+  LayoutSession& operator=(const LayoutSession&) = delete;
+
+  // Updates location and size of the views with the same id.
+  // Returns false and leaves the session unchanged if some of the ids are not in the layout.
+  bool UpdateViews(const std::vector<View>& updates);
+
+  // Synthesizes constraints for the current layout. The result is cached until the next update.
+  const SynResult& Synthesize();
+
+  bool HasResult() const {
+    return has_result;
+  }
+
+  const App& GetApp() const {
+    return app;
+  }
+
+  // Number of views whose candidates were recomputed by the last update.
+  int NumUpdatedCandidates() const {
+    return num_updated_candidates;
+  }
+
+private:
+  void InitializeDeviceApps();
+
+  const ProbModel* model;
+  App app;
+  const Device ref_device;
+  const std::vector<Device> devices;
+  const bool opt;
+
+  std::vector<App> device_apps;
+  std::unique_ptr<AttrScorer> scorer_vertical;
+  std::unique_ptr<AttrScorer> scorer_horizontal;
+
+  SynResult result;
+  bool has_result;
+  int num_updated_candidates;
+};
+
+#endif //CC_SYNTHESIS_LAYOUT_SESSION_H
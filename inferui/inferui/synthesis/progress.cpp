@@ -0,0 +1,41 @@
+/*
+   Copyright 2018 Software Reliability Lab, ETH Zurich
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#include "progress.h"
+
+namespace {
+
+thread_local ProgressListener* current_listener = nullptr;
+
+}  // namespace
+
+ScopedProgressListener::ScopedProgressListener(ProgressListener* listener) : previous(current_listener) {
+  current_listener = listener;
+}
+
+ScopedProgressListener::~ScopedProgressListener() {
+  current_listener = previous;
+}
+
+bool HasProgressListener() {
+  return current_listener != nullptr;
+}
+
+void ReportProgress(const std::string& stage, const App& app) {
+  if (current_listener != nullptr) {
+    current_listener->OnProgress(stage, app);
+  }
+}
@@ -0,0 +1,51 @@
+/*
+   Copyright 2018 Software Reliability Lab, ETH Zurich
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#ifndef CC_SYNTHESIS_PROGRESS_H
+#define CC_SYNTHESIS_PROGRESS_H
+
+#include <string>
+
+class App;
+
+// Receives intermediate results of the synthesis running on the current thread
+// (e.g., the feasible layout of one orientation before it is optimized).
+class ProgressListener {
+public:
+  virtual ~ProgressListener() {
+  }
+
+  // Called on the synthesis thread. The app is only valid during the call.
+  virtual void OnProgress(const std::string& stage, const App& app) = 0;
+};
+
+// Installs the listener for the calling thread during the lifetime of the object.
+class ScopedProgressListener {
+public:
+  explicit ScopedProgressListener(ProgressListener* listener);
+  ~ScopedProgressListener();
+
+private:
+  ProgressListener* previous;
+};
+
+// Whether intermediate results are requested on the calling thread.
+// Used to skip work done only to report progress.
+bool HasProgressListener();
+
+void ReportProgress(const std::string& stage, const App& app);
+
+#endif //CC_SYNTHESIS_PROGRESS_H
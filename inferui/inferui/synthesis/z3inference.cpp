@@ -18,6 +18,8 @@
 #include "inferui/layout_solver/solver.h"
 #include "inferui/eval/eval_app_util.h"
 #include "base/range.h"
+#include "inferui/synthesis/progress.h"
+#include <algorithm>
 #include <cstdlib>
 #include <ctime>
 #include <set>
@@ -27,6 +29,42 @@
 const std::regex ConstraintData::constraint_name_regex = std::regex("([^_]*)_(\\d+)_(\\d+)_(\\d+)_(\\d+)_?(\\d+)?");
 DEFINE_uint64(cand_num, 4, "Square root of the number of candidates to be generated");
 
+namespace {
+
+const char* OrientationStageName(const Orientation& orientation) {
+  return (orientation == Orientation::HORIZONTAL) ? "horizontal" : "vertical";
+}
+
+// Records statistics of the last check in the "z3.<statistic>" histograms
+template <class Solver>
+void RecordZ3Statistics(Solver& s) {
+  stats statistics = s.statistics();
+  for (unsigned i = 0; i < statistics.size(); i++) {
+    std::string key = statistics.key(i);
+    if (key != "conflicts" && key != "decisions" && key != "memory" && key != "max memory") continue;
+    std::replace(key.begin(), key.end(), ' ', '_');
+    RecordLabeled("z3." + key, statistics.is_uint(i) ? statistics.uint_value(i) : statistics.double_value(i));
+  }
+}
+
+// Sets the solver timeout to what is left of timeout_ms since check_timer started, capped by the deadline of the
+// current request. Returns false if no time is left, so that no further check is started.
+bool SetRemainingTimeout(solver& s, params& p, Timer& check_timer, unsigned timeout_ms) {
+  double elapsed_ms = check_timer.GetMilliSeconds();
+  if (ScopedCancellation::IsStopped()) {
+    ScopedCancellation::MarkInterrupted();
+    return false;
+  }
+  if (elapsed_ms >= timeout_ms) {
+    return false;
+  }
+  p.set(":timeout", SolverTimeoutMs(timeout_ms - static_cast<unsigned>(elapsed_ms)));
+  s.set(p);
+  return true;
+}
+
+}  // namespace
+
 expr round_real2int(const expr &x) {
   Z3_ast r = Z3_mk_real2int(x.ctx(), x + x.ctx().real_val(1,2));
   return expr(x.ctx(), r);
@@ -839,6 +877,7 @@ Status FullSynthesis::SynthesizeMultiDevice(
   LOG(INFO) << "Syn: " << orientation;
   LOG(INFO) << "Initialize Constraints...";
   context c;
+  ScopedInterruptible interruptible(c);
   solver s(c);
 
   CHECK(scorer == nullptr);
@@ -942,7 +981,7 @@ Status FullSynthesis::SynthesizeMultiDevice(
 
   unsigned timeout = 60000u;
   params p(c);
-  p.set(":timeout", timeout);
+  p.set(":timeout", SolverTimeoutMs(timeout));
   p.set(":unsat-core", true);
 //  p.set("priority",c.str_symbol("pareto"));
   s.set(p);
@@ -1042,6 +1081,8 @@ Status FullSynthesis::GetSatConstraintsSingleQuery(
   timer.StartScope("add_constraints");
 
   context c;
+
+  ScopedInterruptible interruptible(c);
   solver s(c);
 
   std::vector<OrientationContainer<std::vector<Z3View>>> z3_views_devices_all;
@@ -1069,7 +1110,7 @@ Status FullSynthesis::GetSatConstraintsSingleQuery(
 
   unsigned timeout = 60000u;
   params p(c);
-  p.set(":timeout", timeout);
+  p.set(":timeout", SolverTimeoutMs(timeout));
   p.set(":unsat-core", true);
   s.set(p);
 
@@ -1086,10 +1127,6 @@ Status FullSynthesis::GetSatConstraintsSingleQuery(
 
     num_tries++;
     if (num_tries > 100) break;
-    if (check_timer.GetMilliSeconds() > timeout) {
-      return Status::TIMEOUT;
-//      break;
-    }
 //    LOG(INFO) << "Adding More Constraints: " << num_tries;
 //    LOG(INFO) << "Solving...";
     timer.EndScope();
@@ -1124,6 +1161,9 @@ Status FullSynthesis::GetSatConstraintsSingleQuery(
 
     timer.EndScope();
     timer.StartScope("solving");
+    if (!SetRemainingTimeout(s, p, check_timer, timeout)) {
+      return Status::TIMEOUT;
+    }
     res = s.check(GetAssumptions(c, z3_views_all));
 //    LOG(INFO) << "check_sat: " << res;
   }
@@ -1157,11 +1197,13 @@ std::pair<Status, CandidateConstraints> FullSynthesis::GetSatConstraints(
     std::vector<App>& device_apps,
     Timer& timer,
     bool user_input,
-    bool robust) const {
+    bool robust,
+    bool report_feasible) const {
   timer.StartScope("add_constraints");
   LOG(INFO) << "Syn: " << orientation;
 //  LOG(INFO) << "Initialize Constraints...";
   context c;
+  ScopedInterruptible interruptible(c);
   solver s(c);
 
   std::vector<std::vector<Z3View>> z3_views_devices;
@@ -1239,7 +1281,7 @@ std::pair<Status, CandidateConstraints> FullSynthesis::GetSatConstraints(
 
   unsigned timeout = 60000u;
   params p(c);
-  p.set(":timeout", timeout);
+  p.set(":timeout", SolverTimeoutMs(timeout));
   p.set(":unsat-core", true);
   s.set(p);
 
@@ -1256,10 +1298,6 @@ std::pair<Status, CandidateConstraints> FullSynthesis::GetSatConstraints(
 
     num_tries++;
     if (num_tries > 50) break;
-    if (check_timer.GetMilliSeconds() > timeout) {
-      return std::make_pair(Status::TIMEOUT, candidates);
-//      break;
-    }
     LOG(INFO) << "Adding More Constraints: " << num_tries;
     LOG(INFO) << "Solving...";
     timer.EndScope();
@@ -1281,11 +1319,16 @@ std::pair<Status, CandidateConstraints> FullSynthesis::GetSatConstraints(
     FinishedAddingConstraints(s, z3_views);
     timer.EndScope();
     timer.StartScope("solving");
+    if (!SetRemainingTimeout(s, p, check_timer, timeout)) {
+      return std::make_pair(Status::TIMEOUT, candidates);
+    }
     res = s.check(GetAssumptions(c, z3_views));
     LOG(INFO) << "check_sat: " << res;
   }
 
   timer.EndScope();
+  RecordZ3Statistics(s);
+  RecordLabeled("candidate_rounds", num_tries);
 
   LOG(INFO) << "Num tries: " << num_tries << ": res:" << res;
   if (res != check_result::sat) {
@@ -1301,12 +1344,24 @@ std::pair<Status, CandidateConstraints> FullSynthesis::GetSatConstraints(
 
   LOG(INFO) << "Satisfiable with candidates: " << JoinInts(candidates.constraints_max_rank, ',');
 
+  if (report_feasible) {
+    // Layout of the model found for the candidates, reported before the optimization
+    model feasible = s.get_model();
+    App feasible_app(app);
+    for (Z3View& view : z3_views) {
+      if (view.pos == 0) continue;
+      view.AssignModel(feasible, orientation, feasible_app.GetViews());
+    }
+    ReportProgress(std::string("feasible_") + OrientationStageName(orientation), feasible_app);
+  }
+
   return std::make_pair(Status::SUCCESS, candidates);
 }
 
 
 std::pair<check_result, std::vector<Z3View*> > FullSynthesis::checkSatIntermediate(solver& s, std::vector<Z3View>& z3_views) const{
 	  context c1;
+	  ScopedInterruptible interruptible(c1);
 
 	  std::stringstream buffer;
 	  buffer << s;
@@ -1314,7 +1369,7 @@ std::pair<check_result, std::vector<Z3View*> > FullSynthesis::checkSatIntermedia
 	  solver s1(c1);
 	  unsigned timeout = 60000u;
 	  params p(c1);
-	  p.set(":timeout", timeout);
+	  p.set(":timeout", SolverTimeoutMs(timeout));
 	  p.set(":unsat-core", true);
 	  s1.set(p);
 	  s1.from_string(old.c_str());
@@ -1362,6 +1417,8 @@ std::pair<Status, CandidateConstraints> FullSynthesis::GetSatConstraintsOracle(
 //  LOG(INFO) << "Initialize Constraints...";
 
   context c;
+
+  ScopedInterruptible interruptible(c);
   solver s(c);
 
   std::vector<std::vector<Z3View>> z3_views_devices;
@@ -1439,7 +1496,7 @@ std::pair<Status, CandidateConstraints> FullSynthesis::GetSatConstraintsOracle(
 
   unsigned timeout = 60000u;
   params p(c);
-  p.set(":timeout", timeout);
+  p.set(":timeout", SolverTimeoutMs(timeout));
   p.set(":unsat-core", true);
   s.set(p);
 
@@ -1458,9 +1515,6 @@ std::pair<Status, CandidateConstraints> FullSynthesis::GetSatConstraintsOracle(
 
     num_tries++;
     if (num_tries > 50) break;
-    if (check_timer.GetMilliSeconds() > timeout) {
-      return std::make_pair(Status::TIMEOUT, candidates);
-    }
     timer.EndScope();
     timer.StartScope("additional_constraints");
 
@@ -1491,7 +1545,9 @@ std::pair<Status, CandidateConstraints> FullSynthesis::GetSatConstraintsOracle(
     FinishedAddingConstraints(s, z3_views);
     timer.EndScope();
     timer.StartScope("solving");
-
+    if (!SetRemainingTimeout(s, p, check_timer, timeout)) {
+      return std::make_pair(Status::TIMEOUT, candidates);
+    }
     res = s.check(GetAssumptions(c, z3_views));
     LOG(INFO) << "check_sat: " << res;
   }
@@ -1527,6 +1583,7 @@ Status FullSynthesis::SynthesizeMultiDeviceProbSingleQuery(
 
   timer.StartScope("init");
   context c;
+  ScopedInterruptible interruptible(c);
 
   OrientationContainer<std::vector<Z3View>> z3_views_all(
       Z3View::ConvertViews(app.GetViews(), Orientation::HORIZONTAL, c),
@@ -1600,7 +1657,7 @@ Status FullSynthesis::SynthesizeMultiDeviceProbSingleQueryInner(
   timer.StartScope("solving");
   unsigned timeout = (opt) ? 20000u : 60000u;
   params p(c);
-  p.set(":timeout", timeout);
+  p.set(":timeout", SolverTimeoutMs(timeout));
   s.set(p);
 
   expr_vector assumptions = GetAssumptions(c, z3_views_all);
@@ -1693,6 +1750,7 @@ Status FullSynthesis::SynthesizeMultiDeviceProb(
   LOG(INFO) << "Syn: " << orientation;
 //  LOG(INFO) << "Initialize Constraints...";
   context c;
+  ScopedInterruptible interruptible(c);
   optimize s(c);
 
   std::vector<std::vector<Z3View>> z3_views_devices;
@@ -1700,7 +1758,9 @@ Status FullSynthesis::SynthesizeMultiDeviceProb(
 
   std::vector<Z3View> z3_views = Z3View::ConvertViews(app.GetViews(), orientation, c);
 
-  std::pair<Status, CandidateConstraints> r = GetSatConstraints(app, orientation, scorer, ref_device, device_apps, timer, user_input, robust);
+  // The feasible layout is reported from the model of the candidates instead of solving the query again
+  std::pair<Status, CandidateConstraints> r = GetSatConstraints(app, orientation, scorer, ref_device, device_apps, timer,
+                                                                user_input, robust, opt && HasProgressListener());
   if (r.first != Status::SUCCESS) {
     return r.first;
   }
@@ -1771,7 +1831,7 @@ Status FullSynthesis::SynthesizeMultiDeviceProb(
 
   unsigned timeout = 60000u;
   params p(c);
-  p.set(":timeout", timeout);
+  p.set(":timeout", SolverTimeoutMs(timeout));
 //  p.set(":model", true);
 //  p.set(":unsat-core", true);
   s.set(p);
@@ -1796,6 +1856,7 @@ Status FullSynthesis::SynthesizeMultiDeviceProb(
   }
 
   check_result res = s.check();
+  RecordZ3Statistics(s);
 
 
   timer.EndScope();
@@ -1852,6 +1913,7 @@ Status FullSynthesis::SynthesizeMultiDeviceProb(
     }
   }
   timer.EndScope();
+  ReportProgress(OrientationStageName(orientation), app);
   return Status::SUCCESS;
 }
 
@@ -1879,6 +1941,7 @@ std::pair<Status, ConstraintMap> FullSynthesis::SynthesizeDeviceProbOracle(
   LOG(INFO) << "Syn: " << orientation;
 //  LOG(INFO) << "Initialize Constraints...";
   context c;
+  ScopedInterruptible interruptible(c);
   optimize s(c);
 
   std::vector<std::vector<Z3View>> z3_views_devices;
@@ -1967,7 +2030,7 @@ std::pair<Status, ConstraintMap> FullSynthesis::SynthesizeDeviceProbOracle(
 
   unsigned timeout = 60000u;
   params p(c);
-  p.set(":timeout", timeout);
+  p.set(":timeout", SolverTimeoutMs(timeout));
 //  p.set(":model", true);
 //  p.set(":unsat-core", true);
   s.set(p);
@@ -2054,6 +2117,7 @@ Status FullSynthesis::Synthesize(App& app, const Orientation& orientation) const
   timer.Start();
   VLOG(2) << "Initialize Constraints...";
   context c;
+  ScopedInterruptible interruptible(c);
   solver s(c);
 
   std::vector<Z3View> z3_views = Z3View::ConvertViews(app.GetViews(), orientation, c);
@@ -2085,7 +2149,7 @@ Status FullSynthesis::Synthesize(App& app, const Orientation& orientation) const
 
   unsigned timeout = 60000u;
   params p(c);
-  p.set(":timeout", timeout);
+  p.set(":timeout", SolverTimeoutMs(timeout));
   s.set(p);
 
   check_result res = s.check(GetAssumptions(c, z3_views));
@@ -28,6 +28,7 @@
 #include "inferui/model/model.h"
 #include "inferui/model/constraint_model.h"
 #include "inferui/model/synthesis.h"
+#include "inferui/synthesis/cancellation.h"
 
 
 using namespace z3;
@@ -118,6 +119,11 @@ public:
 
   }
 
+  // See ConstraintCache::UpdateViews
+  int UpdateViews(App& app, const std::vector<View>& old_views) {
+    return cache.UpdateViews(app.GetViews(), old_views);
+  }
+
   int NumConstraints(int view_id) const {
     return cache.NumConstraints(view_id);
   }
@@ -1367,6 +1373,7 @@ public:
       OrientationContainer<CandidateConstraints>& candidates_all,
       BlockingConstraintsHelper* blocking_constraints = nullptr) const;
 
+  // With report_feasible the layout of the satisfying candidates is reported as progress.
   std::pair<Status, CandidateConstraints> GetSatConstraints(
       App& app,
       const Orientation& orientation,
@@ -1374,7 +1381,7 @@ public:
       const Device& ref_device,
       std::vector<App>& device_apps,
       Timer& timer,
-      bool user_input, bool robust) const;
+      bool user_input, bool robust, bool report_feasible = false) const;
 
   std::pair<Status, CandidateConstraints> GetSatConstraintsOracle(
       App& app,
@@ -1541,6 +1548,7 @@ public:
 
   Status Layout(App& app, const App& ref, const Orientation& orientation) const {
     context c;
+    ScopedInterruptible interruptible(c);
     solver s(c);
 
     std::vector<Z3View> z3_views = Z3View::ConvertViews(app.GetViews(), orientation, c);
@@ -1573,7 +1581,7 @@ public:
 
     //solve
     params p(c);
-    p.set(":timeout", 120000u);
+    p.set(":timeout", SolverTimeoutMs(120000u));
 //    p.set(":unsat-core", true);
     s.set(p);
     check_result res = s.check();
@@ -1650,6 +1658,7 @@ public:
 
   static bool CheckBounds(const App& app, const Orientation& orientation) {
     context c;
+    ScopedInterruptible interruptible(c);
     solver s(c);
 
     std::vector<Z3View> z3_views = Z3View::ConvertViews(app.GetViews(), orientation, c);
@@ -1662,7 +1671,7 @@ public:
 
     //solve
     params p(c);
-    p.set(":timeout", 120000u);
+    p.set(":timeout", SolverTimeoutMs(120000u));
     s.set(p);
     check_result res = s.check();
 //    LOG(INFO) << "\tBounds " << orientation << ": \t" << res;
@@ -1676,6 +1685,7 @@ public:
 
   static bool CheckIntersection(const App& ref, const App& app, const Orientation& orientation) {
     context c;
+    ScopedInterruptible interruptible(c);
     solver s(c);
 
     std::vector<Z3View> z3_ref_views = Z3View::ConvertViews(ref.GetViews(), orientation, c);
@@ -1689,7 +1699,7 @@ public:
 //    LOG(INFO) << s;
 
     params p(c);
-    p.set(":timeout", 120000u);
+    p.set(":timeout", SolverTimeoutMs(120000u));
     s.set(p);
     check_result res = s.check();
 
@@ -1702,6 +1712,7 @@ public:
 
   static bool CheckCentering(const App& ref, const App& app, const Orientation& orientation) {
     context c;
+    ScopedInterruptible interruptible(c);
     solver s(c);
 
     std::vector<Z3View> z3_ref_views = Z3View::ConvertViews(ref.GetViews(), orientation, c);
@@ -1713,7 +1724,7 @@ public:
     FullSynthesis::AssertKeepsCentering(s, ref, z3_ref_views, z3_app_views);
 
     params p(c);
-    p.set(":timeout", 120000u);
+    p.set(":timeout", SolverTimeoutMs(120000u));
     s.set(p);
     check_result res = s.check();
 
@@ -1726,6 +1737,7 @@ public:
 
   static bool CheckMargins(const App& ref, const App& app, const Orientation& orientation) {
     context c;
+    ScopedInterruptible interruptible(c);
     solver s(c);
 
 
@@ -1738,7 +1750,7 @@ public:
     FullSynthesis::AssertKeepsMargins(s, ref, z3_ref_views, z3_app_views);
 
     params p(c);
-    p.set(":timeout", 120000u);
+    p.set(":timeout", SolverTimeoutMs(120000u));
     s.set(p);
     check_result res = s.check();
 
@@ -1751,6 +1763,7 @@ public:
 
   static bool CheckSizeRatio(const App& ref, const App& app) {
     context c;
+    ScopedInterruptible interruptible(c);
     solver s(c);
 
     std::vector<Z3View> z3_ref_views = Z3View::ConvertViews(ref.GetViews(), Orientation::HORIZONTAL, c);
@@ -1762,7 +1775,7 @@ public:
     FullSynthesis::AssertKeepsSizeRatio(s, ref, z3_ref_views, z3_app_views, app);
 
     params p(c);
-    p.set(":timeout", 120000u);
+    p.set(":timeout", SolverTimeoutMs(120000u));
     s.set(p);
     check_result res = s.check();
 
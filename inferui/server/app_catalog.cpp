@@ -0,0 +1,111 @@
+/*
+   Copyright 2018 Software Reliability Lab, ETH Zurich
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#include "app_catalog.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <fstream>
+#include "glog/logging.h"
+#include "base/stringprintf.h"
+
+std::string DataVersion(const std::string& filename) {
+  struct stat st;
+  if (stat(filename.c_str(), &st) != 0) {
+    return filename;
+  }
+  return StringPrintf("%s:%lld:%lld", filename.c_str(), static_cast<long long>(st.st_size), static_cast<long long>(st.st_mtime));
+}
+
+AppCatalog::AppCatalog(const std::string& path, const std::string& data_version, const AppSource& source)
+    : path(path), fd(-1) {
+  if (!LoadIndex(data_version)) {
+    Build(data_version, source);
+  }
+  fd = open(path.c_str(), O_RDONLY);
+  CHECK_GE(fd, 0) << "Could not open " << path;
+}
+
+AppCatalog::~AppCatalog() {
+  if (fd >= 0) {
+    close(fd);
+  }
+}
+
+bool AppCatalog::Get(int id, ProtoApp* app) const {
+  if (id < 0 || id >= static_cast<int>(size())) {
+    return false;
+  }
+  const AppCatalogEntry& e = entry(id);
+  std::string data(e.size(), '\0');
+  size_t done = 0;
+  while (done < data.size()) {
+    ssize_t res = pread(fd, &data[done], data.size() - done, e.offset() + done);
+    CHECK_GT(res, 0) << "Could not read app " << id << " from " << path;
+    done += res;
+  }
+  CHECK(app->ParseFromString(data));
+  return true;
+}
+
+bool AppCatalog::LoadIndex(const std::string& data_version) {
+  std::ifstream in(path + ".index", std::ios::binary);
+  if (!in.is_open()) {
+    return false;
+  }
+  if (!index.ParseFromIstream(&in) || index.data_version() != data_version) {
+    LOG(INFO) << "App catalog " << path << " is outdated";
+    index.Clear();
+    return false;
+  }
+  LOG(INFO) << "Loaded index of " << size() << " apps from " << path;
+  return true;
+}
+
+void AppCatalog::Build(const std::string& data_version, const AppSource& source) {
+  LOG(INFO) << "Building app catalog " << path << "...";
+  index.Clear();
+  index.set_data_version(data_version);
+  std::ofstream out(path, std::ios::binary | std::ios::trunc);
+  CHECK(out.is_open()) << "Could not create " << path;
+  uint64_t offset = 0;
+  std::string data;
+  source([&](const ProtoApp& app) {
+    CHECK(app.SerializeToString(&data));
+    out.write(data.data(), data.size());
+    AppCatalogEntry* e = index.add_apps();
+    e->set_offset(offset);
+    e->set_size(data.size());
+    e->set_package_name(app.package_name());
+    if (app.screens_size() > 0) {
+      e->set_window_path(app.screens(0).window_path());
+    }
+    offset += data.size();
+  });
+  out.close();
+  CHECK(!out.fail()) << "Could not write " << path;
+
+  // The index is written last so that an interrupted build is not used
+  std::string tmp_index = path + ".index.tmp";
+  {
+    std::ofstream index_out(tmp_index, std::ios::binary | std::ios::trunc);
+    CHECK(index.SerializeToOstream(&index_out)) << "Could not write " << tmp_index;
+  }
+  CHECK_EQ(rename(tmp_index.c_str(), (path + ".index").c_str()), 0);
+  LOG(INFO) << "Done. App catalog contains " << size() << " apps.";
+}
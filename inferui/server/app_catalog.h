@@ -0,0 +1,60 @@
+/*
+   Copyright 2018 Software Reliability Lab, ETH Zurich
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#ifndef CC_SYNTHESIS_APP_CATALOG_H
+#define CC_SYNTHESIS_APP_CATALOG_H
+
+#include <functional>
+#include <string>
+#include "inferui/model/uidump.pb.h"
+#include "server/app_catalog.pb.h"
+
+// Identifies the content of a file by its path, size and modification time.
+std::string DataVersion(const std::string& filename);
+
+// Apps stored uncompressed one after another in a file (path) together with an index of their offsets (path.index).
+// Only the index is kept in memory and the apps are decoded on demand.
+// The catalog is built once from the apps produced by the source and is reused as long as data_version does not change.
+// Get is thread safe.
+class AppCatalog {
+public:
+  typedef std::function<void(const std::function<void(const ProtoApp&)>&)> AppSource;
+
+  AppCatalog(const std::string& path, const std::string& data_version, const AppSource& source);
+  ~AppCatalog();
+
+  size_t size() const {
+    return index.apps_size();
+  }
+
+  // Package name and window path of the app, available without decoding it
+  const AppCatalogEntry& entry(int id) const {
+    return index.apps(id);
+  }
+
+  // @returns false if the id is out of range.
+  bool Get(int id, ProtoApp* app) const;
+
+private:
+  bool LoadIndex(const std::string& data_version);
+  void Build(const std::string& data_version, const AppSource& source);
+
+  const std::string path;
+  AppCatalogIndex index;
+  int fd;
+};
+
+#endif //CC_SYNTHESIS_APP_CATALOG_H
@@ -0,0 +1,100 @@
+/*
+   Copyright 2018 Software Reliability Lab, ETH Zurich
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#include <unistd.h>
+
+#include "gtest/gtest.h"
+#include "glog/logging.h"
+
+#include "base/test_tmpfile.h"
+#include "server/app_catalog.h"
+
+namespace {
+
+ProtoApp MakeApp(int i) {
+  ProtoApp app;
+  app.set_package_name("app" + std::to_string(i));
+  ProtoScreen* screen = app.add_screens();
+  screen->set_window_path("/data/screen" + std::to_string(i) + ".png");
+  for (int j = 0; j < i; j++) {
+    screen->add_views();
+  }
+  return app;
+}
+
+class AppCatalogTest : public TempFileTest {
+protected:
+  void TearDown() override {
+    unlink((path + ".index").c_str());
+    TempFileTest::TearDown();
+  }
+
+  AppCatalog::AppSource Source(int num_apps, int* num_scans) {
+    return [num_apps, num_scans](const std::function<void(const ProtoApp&)>& cb) {
+      (*num_scans)++;
+      for (int i = 0; i < num_apps; i++) {
+        cb(MakeApp(i));
+      }
+    };
+  }
+};
+
+}  // namespace
+
+TEST_F(AppCatalogTest, DecodesAppsOnDemand) {
+  int num_scans = 0;
+  AppCatalog catalog(path, "v1", Source(5, &num_scans));
+  EXPECT_EQ(1, num_scans);
+  ASSERT_EQ(5u, catalog.size());
+  EXPECT_EQ("app3", catalog.entry(3).package_name());
+  EXPECT_EQ("/data/screen3.png", catalog.entry(3).window_path());
+
+  // In reverse order to check that the reads do not depend on the position
+  for (int i = 4; i >= 0; i--) {
+    ProtoApp app;
+    ASSERT_TRUE(catalog.Get(i, &app));
+    EXPECT_EQ(MakeApp(i).SerializeAsString(), app.SerializeAsString());
+  }
+  ProtoApp app;
+  EXPECT_FALSE(catalog.Get(5, &app));
+  EXPECT_FALSE(catalog.Get(-1, &app));
+}
+
+TEST_F(AppCatalogTest, ReusedUntilDataChanges) {
+  int num_scans = 0;
+  {
+    AppCatalog catalog(path, "v1", Source(3, &num_scans));
+    EXPECT_EQ(3u, catalog.size());
+  }
+  {
+    AppCatalog catalog(path, "v1", Source(3, &num_scans));
+    EXPECT_EQ(1, num_scans);
+    ProtoApp app;
+    ASSERT_TRUE(catalog.Get(2, &app));
+    EXPECT_EQ("app2", app.package_name());
+  }
+  {
+    AppCatalog catalog(path, "v2", Source(4, &num_scans));
+    EXPECT_EQ(2, num_scans);
+    EXPECT_EQ(4u, catalog.size());
+  }
+}
+
+int main(int argc, char **argv) {
+  google::InstallFailureSignalHandler();
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,63 @@
+/*
+   Copyright 2018 Software Reliability Lab, ETH Zurich
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#include "readiness.h"
+
+#include <glog/logging.h>
+
+Readiness::Readiness() : start(Clock::now()), ready(false), init_ms(-1) {
+}
+
+Readiness::~Readiness() {
+  if (thread.joinable()) {
+    thread.join();
+  }
+}
+
+void Readiness::Start(const std::function<void()>& init) {
+  CHECK(!thread.joinable()) << "Initialization already started";
+  thread = std::thread([this, init]() {
+    init();
+    std::lock_guard<std::mutex> lock(mutex);
+    ready = true;
+    init_ms = UptimeMs();
+    LOG(INFO) << "Server ready after " << init_ms << "ms";
+    ready_cv.notify_all();
+  });
+}
+
+bool Readiness::IsReady() const {
+  std::lock_guard<std::mutex> lock(mutex);
+  return ready;
+}
+
+bool Readiness::WaitUntilReady(const CancellationToken& token) const {
+  std::unique_lock<std::mutex> lock(mutex);
+  // Wake up periodically since cancelling the token does not notify ready_cv
+  while (!ready && !token.IsCancelled() && !token.IsExpired()) {
+    ready_cv.wait_for(lock, std::chrono::milliseconds(100));
+  }
+  return ready;
+}
+
+int64_t Readiness::UptimeMs() const {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - start).count();
+}
+
+int64_t Readiness::InitMs() const {
+  std::lock_guard<std::mutex> lock(mutex);
+  return init_ms;
+}
@@ -0,0 +1,61 @@
+/*
+   Copyright 2018 Software Reliability Lab, ETH Zurich
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#ifndef CC_SYNTHESIS_READINESS_H
+#define CC_SYNTHESIS_READINESS_H
+
+#include <stdint.h>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include "inferui/synthesis/cancellation.h"
+
+// Runs the expensive initialization of a server (model training, loading data, warm-up) on a background thread,
+// so that the server accepts connections and answers health checks right away.
+// Requests that need the initialized state wait in WaitUntilReady.
+class Readiness {
+public:
+  Readiness();
+  // Waits until the initialization finishes
+  ~Readiness();
+
+  // Starts init on a background thread, can be called only once.
+  void Start(const std::function<void()>& init);
+
+  bool IsReady() const;
+
+  // Waits until the initialization finishes or the token is cancelled or expires.
+  // @returns IsReady()
+  bool WaitUntilReady(const CancellationToken& token) const;
+
+  int64_t UptimeMs() const;
+  // Duration of the initialization, -1 if it did not finish yet
+  int64_t InitMs() const;
+
+private:
+  typedef std::chrono::steady_clock Clock;
+
+  const Clock::time_point start;
+  mutable std::mutex mutex;
+  mutable std::condition_variable ready_cv;
+  bool ready;
+  int64_t init_ms;
+  std::thread thread;
+};
+
+#endif //CC_SYNTHESIS_READINESS_H
@@ -0,0 +1,66 @@
+/*
+   Copyright 2018 Software Reliability Lab, ETH Zurich
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#include <atomic>
+
+#include "gtest/gtest.h"
+#include "glog/logging.h"
+
+#include "server/readiness.h"
+
+TEST(ReadinessTest, WaitsForInitialization) {
+  std::mutex mutex;
+  std::condition_variable cv;
+  bool release = false;
+
+  Readiness readiness;
+  EXPECT_FALSE(readiness.IsReady());
+  EXPECT_EQ(-1, readiness.InitMs());
+  readiness.Start([&]() {
+    std::unique_lock<std::mutex> lock(mutex);
+    cv.wait(lock, [&]{ return release; });
+  });
+
+  // Expires while the initialization is blocked
+  CancellationToken expiring(CancellationToken::Clock::now() + std::chrono::milliseconds(50));
+  EXPECT_FALSE(readiness.WaitUntilReady(expiring));
+  CancellationToken cancelled;
+  cancelled.Cancel();
+  EXPECT_FALSE(readiness.WaitUntilReady(cancelled));
+  EXPECT_FALSE(readiness.IsReady());
+
+  std::atomic<bool> waiter_ready(false);
+  std::thread waiter([&]() {
+    CancellationToken token;
+    waiter_ready = readiness.WaitUntilReady(token);
+  });
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    release = true;
+  }
+  cv.notify_all();
+  waiter.join();
+  EXPECT_TRUE(waiter_ready);
+  EXPECT_TRUE(readiness.IsReady());
+  EXPECT_GE(readiness.InitMs(), 0);
+  EXPECT_GE(readiness.UptimeMs(), readiness.InitMs());
+}
+
+int main(int argc, char **argv) {
+  google::InstallFailureSignalHandler();
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,281 @@
+/*
+   Copyright 2018 Software Reliability Lab, ETH Zurich
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#include "request_scheduler.h"
+
+#include <algorithm>
+#include <glog/logging.h>
+#include "base/metrics.h"
+
+namespace {
+
+double ElapsedMs(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+}  // namespace
+
+RequestScheduler::RequestScheduler(int num_workers, int max_queue_size) : max_queue_size(max_queue_size), stopped(false) {
+  CHECK_GT(num_workers, 0);
+  for (int i = 0; i < num_workers; i++) {
+    workers.emplace_back(&RequestScheduler::WorkerLoop, this);
+  }
+  expiry_thread = std::thread(&RequestScheduler::ExpiryLoop, this);
+}
+
+RequestScheduler::~RequestScheduler() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopped = true;
+  }
+  queue_cv.notify_all();
+  expiry_cv.notify_all();
+  for (std::thread& worker : workers) {
+    worker.join();
+  }
+  expiry_thread.join();
+
+  // Asynchronous requests that did not start are cancelled
+  for (Task* task : queue) {
+    if (task->async_done) {
+      task->async_done(Status::CANCELLED);
+      delete task;
+    }
+  }
+}
+
+RequestScheduler::Status RequestScheduler::Run(const std::function<void()>& fn, CancellationToken* token,
+                                               const std::string& request_id) {
+  return RunAll({fn}, token, request_id)[0];
+}
+
+std::vector<RequestScheduler::Status> RequestScheduler::RunAll(const std::vector<std::function<void()>>& fns,
+                                                               CancellationToken* token,
+                                                               const std::string& request_id) {
+  // Value initialized, the tasks are not done and have status OK
+  std::vector<Task> tasks(fns.size());
+  std::vector<Status> statuses(fns.size(), Status::OK);
+  std::unique_lock<std::mutex> lock(mutex);
+  size_t pending = 0;
+  auto now = std::chrono::steady_clock::now();
+  // Queued requests taken by the idle workers do not wait
+  size_t idle_workers = workers.size() - stats.running;
+  for (size_t i = 0; i < fns.size(); i++) {
+    tasks[i].fn = &fns[i];
+    tasks[i].token = token;
+    tasks[i].enqueued = now;
+    if (queue.size() >= max_queue_size + idle_workers) {
+      stats.rejected++;
+      statuses[i] = Status::REJECTED;
+      continue;
+    }
+    queue.push_back(&tasks[i]);
+    pending++;
+  }
+  if (pending < fns.size()) {
+    LOG(WARNING) << "Rejected " << (fns.size() - pending) << " requests, " << queue.size() << " requests are already queued";
+  }
+  if (pending == 0) {
+    return statuses;
+  }
+  if (!request_id.empty()) {
+    requests[request_id] = token;
+  }
+  Metrics().SetGauge("scheduler.queued", queue.size());
+  queue_cv.notify_all();
+
+  while (pending > 0) {
+    // Wake up periodically to drop the queued requests once their deadline passes
+    done_cv.wait_for(lock, std::chrono::milliseconds(100));
+    bool dropped = token->IsCancelled() || token->IsExpired();
+    Status dropped_status = token->IsCancelled() ? Status::CANCELLED : Status::DEADLINE_EXCEEDED;
+    pending = 0;
+    for (size_t i = 0; i < tasks.size(); i++) {
+      Task& task = tasks[i];
+      if (statuses[i] != Status::OK) continue;
+      if (task.done) {
+        statuses[i] = task.status;
+        continue;
+      }
+      auto it = std::find(queue.begin(), queue.end(), &task);
+      if (it != queue.end() && dropped) {
+        queue.erase(it);
+        task.done = true;
+        statuses[i] = dropped_status;
+        continue;
+      }
+      pending++;
+    }
+    if (dropped) {
+      Metrics().SetGauge("scheduler.queued", queue.size());
+    }
+  }
+
+  for (Status status : statuses) {
+    if (status == Status::CANCELLED) {
+      stats.cancelled++;
+    } else if (status == Status::DEADLINE_EXCEEDED) {
+      stats.expired++;
+    }
+  }
+  if (!request_id.empty()) {
+    requests.erase(request_id);
+  }
+  return statuses;
+}
+
+void RequestScheduler::RunAsync(const std::function<void()>& fn, CancellationToken* token,
+                                const std::function<void(Status)>& done, const std::string& request_id) {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    size_t idle_workers = workers.size() - stats.running;
+    if (queue.size() < max_queue_size + idle_workers) {
+      Task* task = new Task();
+      task->token = token;
+      task->enqueued = std::chrono::steady_clock::now();
+      task->async_fn = fn;
+      task->async_done = done;
+      task->request_id = request_id;
+      task->fn = &task->async_fn;
+      queue.push_back(task);
+      Metrics().SetGauge("scheduler.queued", queue.size());
+      if (!request_id.empty()) {
+        requests[request_id] = token;
+      }
+      queue_cv.notify_one();
+      return;
+    }
+    stats.rejected++;
+    LOG(WARNING) << "Rejected asynchronous request, " << queue.size() << " requests are already queued";
+  }
+  done(Status::REJECTED);
+}
+
+void RequestScheduler::FinishAsync(Task* task) {
+  if (task->status == Status::CANCELLED) {
+    stats.cancelled++;
+  } else if (task->status == Status::DEADLINE_EXCEEDED) {
+    stats.expired++;
+  }
+  if (!task->request_id.empty()) {
+    requests.erase(task->request_id);
+  }
+}
+
+void RequestScheduler::ExpiryLoop() {
+  std::unique_lock<std::mutex> lock(mutex);
+  while (!stopped) {
+    expiry_cv.wait_for(lock, std::chrono::milliseconds(100));
+    std::vector<Task*> dropped;
+    for (auto it = queue.begin(); it != queue.end();) {
+      Task* task = *it;
+      if (task->async_done && (task->token->IsCancelled() || task->token->IsExpired())) {
+        task->status = task->token->IsCancelled() ? Status::CANCELLED : Status::DEADLINE_EXCEEDED;
+        FinishAsync(task);
+        dropped.push_back(task);
+        it = queue.erase(it);
+      } else {
+        ++it;
+      }
+    }
+    for (Task* task : running_tasks) {
+      task->token->InterruptIfExpired();
+    }
+    if (dropped.empty()) continue;
+    Metrics().SetGauge("scheduler.queued", queue.size());
+    lock.unlock();
+    for (Task* task : dropped) {
+      task->async_done(task->status);
+      delete task;
+    }
+    lock.lock();
+  }
+}
+
+bool RequestScheduler::Cancel(const std::string& request_id) {
+  std::lock_guard<std::mutex> lock(mutex);
+  auto it = requests.find(request_id);
+  if (it == requests.end()) {
+    return false;
+  }
+  LOG(INFO) << "Cancelling request " << request_id;
+  it->second->Cancel();
+  done_cv.notify_all();
+  return true;
+}
+
+RequestScheduler::Stats RequestScheduler::GetStats() const {
+  std::lock_guard<std::mutex> lock(mutex);
+  Stats res = stats;
+  res.queued = queue.size();
+  return res;
+}
+
+const char* RequestScheduler::StatusStr(Status status) {
+  switch (status) {
+    case Status::OK: return "OK";
+    case Status::REJECTED: return "REJECTED";
+    case Status::DEADLINE_EXCEEDED: return "DEADLINE_EXCEEDED";
+    case Status::CANCELLED: return "CANCELLED";
+  }
+  return "UNKNOWN";
+}
+
+void RequestScheduler::WorkerLoop() {
+  std::unique_lock<std::mutex> lock(mutex);
+  for (;;) {
+    queue_cv.wait(lock, [this]{ return stopped || !queue.empty(); });
+    if (stopped) {
+      return;
+    }
+    Task* task = queue.front();
+    queue.pop_front();
+    running_tasks.insert(task);
+    stats.running++;
+    Metrics().SetGauge("scheduler.queued", queue.size());
+    lock.unlock();
+
+    Metrics().Record("scheduler.queue_wait_ms", ElapsedMs(task->enqueued));
+    // Requests are skipped if the token was cancelled or expired while they were queued
+    bool interrupted = true;
+    if (!task->token->IsCancelled() && !task->token->IsExpired()) {
+      ScopedCancellation scoped_cancellation(task->token);
+      auto start = std::chrono::steady_clock::now();
+      (*task->fn)();
+      Metrics().Record("scheduler.run_ms", ElapsedMs(start));
+      // Requests that completed before the token was cancelled or expired keep their result
+      interrupted = scoped_cancellation.interrupted();
+    }
+    if (interrupted) {
+      task->status = task->token->IsCancelled() ? Status::CANCELLED : Status::DEADLINE_EXCEEDED;
+    }
+
+    lock.lock();
+    running_tasks.erase(task);
+    stats.running--;
+    stats.completed++;
+    if (task->async_done) {
+      FinishAsync(task);
+      lock.unlock();
+      task->async_done(task->status);
+      delete task;
+      lock.lock();
+      continue;
+    }
+    task->done = true;
+    done_cv.notify_all();
+  }
+}
@@ -0,0 +1,114 @@
+/*
+   Copyright 2018 Software Reliability Lab, ETH Zurich
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#ifndef CC_SYNTHESIS_REQUEST_SCHEDULER_H
+#define CC_SYNTHESIS_REQUEST_SCHEDULER_H
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+#include "inferui/synthesis/cancellation.h"
+
+// Runs synthesis requests on a fixed number of workers.
+// At most max_queue_size requests wait for a worker, further requests are rejected right away.
+// Queued requests are dropped once their deadline passes or they are cancelled,
+// running requests are interrupted through their CancellationToken once they are cancelled or their deadline passes.
+class RequestScheduler {
+public:
+  enum class Status {
+    OK = 0,
+    REJECTED,
+    DEADLINE_EXCEEDED,
+    CANCELLED
+  };
+
+  struct Stats {
+    int queued = 0;
+    int running = 0;
+    int64_t completed = 0;
+    int64_t rejected = 0;
+    int64_t expired = 0;
+    int64_t cancelled = 0;
+  };
+
+  RequestScheduler(int num_workers, int max_queue_size);
+  ~RequestScheduler();
+
+  // Runs fn on a worker with the token active (see ScopedCancellation) and waits until it finishes.
+  // If request_id is not empty, the request can be cancelled by Cancel(request_id).
+  // fn must not throw.
+  Status Run(const std::function<void()>& fn, CancellationToken* token, const std::string& request_id = "");
+
+  // Same as Run but enqueues all the functions at once so that they run in parallel.
+  // Returns status of each function, the ones that neither get an idle worker nor fit in the queue are rejected.
+  std::vector<Status> RunAll(const std::vector<std::function<void()>>& fns, CancellationToken* token,
+                             const std::string& request_id = "");
+
+  // Enqueues fn without waiting for it. done is called with the status once fn finished or was dropped
+  // (on the calling thread if the request is rejected). The token has to stay valid until done is called.
+  void RunAsync(const std::function<void()>& fn, CancellationToken* token, const std::function<void(Status)>& done,
+                const std::string& request_id = "");
+
+  // Cancels queued or running request. Returns false if there is no such request.
+  bool Cancel(const std::string& request_id);
+
+  Stats GetStats() const;
+
+  static const char* StatusStr(Status status);
+
+private:
+  struct Task {
+    const std::function<void()>* fn;
+    CancellationToken* token;
+    bool done;
+    Status status;
+    std::chrono::steady_clock::time_point enqueued;
+    // Set for the tasks of RunAsync, which are owned by the scheduler
+    std::function<void()> async_fn;
+    std::function<void(Status)> async_done;
+    std::string request_id;
+  };
+
+  void WorkerLoop();
+  // Drops queued tasks of RunAsync once their token is cancelled or expired
+  // and interrupts the solves of running tasks once their deadline passes
+  void ExpiryLoop();
+  // Removes the request and updates the stats. Requires mutex.
+  void FinishAsync(Task* task);
+
+  const size_t max_queue_size;
+
+  mutable std::mutex mutex;
+  std::condition_variable queue_cv;
+  std::condition_variable done_cv;
+  std::deque<Task*> queue;
+  std::set<Task*> running_tasks;
+  std::map<std::string, CancellationToken*> requests;
+  Stats stats;
+  bool stopped;
+  std::vector<std::thread> workers;
+  std::condition_variable expiry_cv;
+  std::thread expiry_thread;
+};
+
+#endif //CC_SYNTHESIS_REQUEST_SCHEDULER_H
@@ -0,0 +1,282 @@
+/*
+   Copyright 2018 Software Reliability Lab, ETH Zurich
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#include "gtest/gtest.h"
+#include "glog/logging.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include "base/metrics.h"
+#include "request_scheduler.h"
+
+namespace {
+
+CancellationToken::Clock::time_point InMs(int ms) {
+  return CancellationToken::Clock::now() + std::chrono::milliseconds(ms);
+}
+
+double QueuedGauge() {
+  return Metrics().GetSnapshot().gauges["scheduler.queued"];
+}
+
+}  // namespace
+
+TEST(RequestSchedulerTest, RunsOnWorker) {
+  RequestScheduler scheduler(2, 4);
+  CancellationToken token;
+  std::thread::id worker_id;
+  bool has_token = false;
+  EXPECT_EQ(scheduler.Run([&]() {
+    worker_id = std::this_thread::get_id();
+    has_token = ScopedCancellation::Current() == &token;
+  }, &token), RequestScheduler::Status::OK);
+  EXPECT_NE(worker_id, std::this_thread::get_id());
+  EXPECT_TRUE(has_token);
+  EXPECT_EQ(ScopedCancellation::Current(), nullptr);
+  EXPECT_EQ(scheduler.GetStats().completed, 1);
+}
+
+TEST(RequestSchedulerTest, RejectsWhenQueueIsFull) {
+  RequestScheduler scheduler(1, 1);
+  std::atomic<bool> release(false);
+  auto block = [&release]() {
+    while (!release) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  };
+
+  CancellationToken running_token, queued_token;
+  std::thread running([&]() { scheduler.Run(block, &running_token); });
+  while (scheduler.GetStats().running == 0) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  std::thread queued([&]() { scheduler.Run(block, &queued_token); });
+  while (scheduler.GetStats().queued == 0) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+  CancellationToken token;
+  EXPECT_EQ(scheduler.Run(block, &token), RequestScheduler::Status::REJECTED);
+  EXPECT_EQ(scheduler.GetStats().rejected, 1);
+
+  release = true;
+  running.join();
+  queued.join();
+  EXPECT_EQ(scheduler.GetStats().completed, 2);
+}
+
+TEST(RequestSchedulerTest, RunAllInParallel) {
+  RequestScheduler scheduler(4, 3);
+  std::atomic<int> running(0), max_running(0);
+  std::vector<int> results(4, -1);
+  std::vector<std::function<void()>> fns;
+  for (int i = 0; i < 4; i++) {
+    fns.push_back([&, i]() {
+      int now = ++running;
+      int prev = max_running;
+      while (now > prev && !max_running.compare_exchange_weak(prev, now)) {}
+      std::this_thread::sleep_for(std::chrono::milliseconds(20));
+      results[i] = i;
+      running--;
+    });
+  }
+  CancellationToken token;
+  std::vector<RequestScheduler::Status> statuses = scheduler.RunAll(fns, &token);
+  ASSERT_EQ(statuses.size(), 4);
+  // The batch is larger than the queue but all the workers are idle
+  for (int i = 0; i < 4; i++) {
+    EXPECT_EQ(statuses[i], RequestScheduler::Status::OK);
+    EXPECT_EQ(results[i], i);
+  }
+  EXPECT_GT(max_running, 1);
+  EXPECT_EQ(scheduler.GetStats().rejected, 0);
+}
+
+TEST(RequestSchedulerTest, RunAllRejectsBeyondWorkersAndQueue) {
+  RequestScheduler scheduler(2, 1);
+  std::vector<int> results(4, -1);
+  std::vector<std::function<void()>> fns;
+  for (int i = 0; i < 4; i++) {
+    fns.push_back([&, i]() { results[i] = i; });
+  }
+  CancellationToken token;
+  std::vector<RequestScheduler::Status> statuses = scheduler.RunAll(fns, &token);
+  ASSERT_EQ(statuses.size(), 4);
+  // Two requests for the idle workers and one waiting in the queue
+  for (int i = 0; i < 3; i++) {
+    EXPECT_EQ(statuses[i], RequestScheduler::Status::OK);
+    EXPECT_EQ(results[i], i);
+  }
+  EXPECT_EQ(statuses[3], RequestScheduler::Status::REJECTED);
+  EXPECT_EQ(results[3], -1);
+  EXPECT_EQ(scheduler.GetStats().rejected, 1);
+}
+
+TEST(RequestSchedulerTest, QueuedRequestExpires) {
+  RequestScheduler scheduler(1, 4);
+  std::atomic<bool> release(false);
+  CancellationToken running_token;
+  std::thread running([&]() {
+    scheduler.Run([&release]() {
+      while (!release) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }, &running_token);
+  });
+  while (scheduler.GetStats().running == 0) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+  bool executed = false;
+  CancellationToken token(InMs(50));
+  EXPECT_EQ(scheduler.Run([&executed]() { executed = true; }, &token), RequestScheduler::Status::DEADLINE_EXCEEDED);
+  EXPECT_FALSE(executed);
+  EXPECT_EQ(scheduler.GetStats().expired, 1);
+  EXPECT_EQ(scheduler.GetStats().queued, 0);
+
+  release = true;
+  running.join();
+}
+
+TEST(RequestSchedulerTest, CancelInterruptsSolver) {
+  RequestScheduler scheduler(1, 4);
+  std::atomic<bool> started(false);
+  z3::check_result result = z3::sat;
+  std::thread client([&]() {
+    CancellationToken token;
+    EXPECT_EQ(scheduler.Run([&]() {
+      z3::context c;
+      ScopedInterruptible interruptible(c);
+      z3::solver s(c);
+      z3::params p(c);
+      p.set(":timeout", SolverTimeoutMs(60000u));
+      s.set(p);
+      // Hard instance: x^3 + y^3 == z^3 over positive integers
+      z3::expr x = c.int_const("x"), y = c.int_const("y"), z = c.int_const("z");
+      s.add(x > 0 && y > 0 && z > 0 && x * x * x + y * y * y == z * z * z);
+      started = true;
+      result = s.check();
+    }, &token, "req"), RequestScheduler::Status::CANCELLED);
+  });
+  while (!started) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  EXPECT_TRUE(scheduler.Cancel("req"));
+  client.join();
+  EXPECT_EQ(result, z3::unknown);
+  EXPECT_FALSE(scheduler.Cancel("req"));
+  EXPECT_EQ(scheduler.GetStats().cancelled, 1);
+}
+
+TEST(RequestSchedulerTest, DeadlineAfterCompletionKeepsResult) {
+  RequestScheduler scheduler(1, 4);
+  bool executed = false;
+  CancellationToken token(InMs(20));
+  EXPECT_EQ(scheduler.Run([&]() {
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    executed = true;
+  }, &token), RequestScheduler::Status::OK);
+  EXPECT_TRUE(executed);
+  EXPECT_EQ(scheduler.GetStats().expired, 0);
+}
+
+TEST(RequestSchedulerTest, DeadlineInterruptsSolver) {
+  RequestScheduler scheduler(1, 4);
+  z3::check_result result = z3::sat;
+  CancellationToken token(InMs(100));
+  EXPECT_EQ(scheduler.Run([&]() {
+    z3::context c;
+    ScopedInterruptible interruptible(c);
+    z3::solver s(c);
+    z3::params p(c);
+    p.set(":timeout", SolverTimeoutMs(60000u));
+    s.set(p);
+    z3::expr x = c.int_const("x"), y = c.int_const("y"), z = c.int_const("z");
+    s.add(x > 0 && y > 0 && z > 0 && x * x * x + y * y * y == z * z * z);
+    result = s.check();
+  }, &token), RequestScheduler::Status::DEADLINE_EXCEEDED);
+  EXPECT_EQ(result, z3::unknown);
+  EXPECT_EQ(scheduler.GetStats().expired, 1);
+}
+
+TEST(RequestSchedulerTest, DeadlineInterruptsUncappedSolver) {
+  RequestScheduler scheduler(1, 4);
+  z3::check_result result = z3::sat;
+  CancellationToken token(InMs(100));
+  auto start = std::chrono::steady_clock::now();
+  EXPECT_EQ(scheduler.Run([&]() {
+    z3::context c;
+    ScopedInterruptible interruptible(c);
+    z3::solver s(c);
+    // The timeout is not capped by the deadline, the solve is interrupted once the deadline passes
+    z3::params p(c);
+    p.set(":timeout", 60000u);
+    s.set(p);
+    z3::expr x = c.int_const("x"), y = c.int_const("y"), z = c.int_const("z");
+    s.add(x > 0 && y > 0 && z > 0 && x * x * x + y * y * y == z * z * z);
+    result = s.check();
+  }, &token), RequestScheduler::Status::DEADLINE_EXCEEDED);
+  EXPECT_EQ(result, z3::unknown);
+  EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds(5));
+}
+
+TEST(RequestSchedulerTest, RunAsyncCallsDone) {
+  RequestScheduler scheduler(1, 1);
+  std::mutex mutex;
+  std::condition_variable cv;
+  std::vector<RequestScheduler::Status> statuses;
+  auto done = [&](RequestScheduler::Status status) {
+    std::lock_guard<std::mutex> lock(mutex);
+    statuses.push_back(status);
+    cv.notify_all();
+  };
+
+  std::atomic<bool> release(false);
+  CancellationToken running_token, queued_token(InMs(50)), rejected_token;
+  scheduler.RunAsync([&release]() {
+    while (!release) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }, &running_token, done);
+  while (scheduler.GetStats().running == 0) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  bool executed = false;
+  scheduler.RunAsync([&executed]() { executed = true; }, &queued_token, done);
+  EXPECT_EQ(1, QueuedGauge());
+  // Rejected right away on the calling thread
+  scheduler.RunAsync([]() {}, &rejected_token, done);
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    ASSERT_EQ(statuses.size(), 1);
+    EXPECT_EQ(statuses[0], RequestScheduler::Status::REJECTED);
+    // The queued request is dropped once it expires
+    cv.wait(lock, [&statuses]() { return statuses.size() == 2; });
+    EXPECT_EQ(statuses[1], RequestScheduler::Status::DEADLINE_EXCEEDED);
+  }
+  EXPECT_FALSE(executed);
+  EXPECT_EQ(0, QueuedGauge());
+
+  release = true;
+  std::unique_lock<std::mutex> lock(mutex);
+  cv.wait(lock, [&statuses]() { return statuses.size() == 3; });
+  EXPECT_EQ(statuses[2], RequestScheduler::Status::OK);
+  EXPECT_EQ(scheduler.GetStats().expired, 1);
+  EXPECT_EQ(scheduler.GetStats().rejected, 1);
+}
+
+TEST(RequestSchedulerTest, DeadlineCapsSolverTimeout) {
+  CancellationToken token(InMs(1000));
+  EXPECT_EQ(SolverTimeoutMs(60000u), 60000u);
+  ScopedCancellation scoped_cancellation(&token);
+  EXPECT_LE(SolverTimeoutMs(60000u), 1000u);
+  EXPECT_EQ(SolverTimeoutMs(10u), 10u);
+  token.Cancel();
+  EXPECT_EQ(SolverTimeoutMs(60000u), 1u);
+}
+
+int main(int argc, char **argv) {
+  google::InstallFailureSignalHandler();
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
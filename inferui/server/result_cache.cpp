@@ -0,0 +1,236 @@
+/*
+   Copyright 2018 Software Reliability Lab, ETH Zurich
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#include "result_cache.h"
+
+#include <stdint.h>
+#include "base/stringprintf.h"
+#include "glog/logging.h"
+
+namespace {
+
+// The file is rewritten once more than this fraction of its records is dead
+const double kMaxDeadRecordRatio = 0.5;
+
+int ViewSizeOrNone(const View& view, const Orientation& orientation) {
+  auto it = view.view_size.find(orientation);
+  return (it == view.view_size.end()) ? -1 : static_cast<int>(it->second);
+}
+
+// Records are stored as 4 byte length followed by the serialized message
+bool WriteRecord(FILE* file, const CachedResult& result) {
+  std::string data;
+  CHECK(result.SerializeToString(&data));
+  uint32_t size = data.size();
+  return fwrite(&size, sizeof(size), 1, file) == 1 && fwrite(data.data(), 1, data.size(), file) == data.size();
+}
+
+// The size of the record is checked against the rest of the file, so that a corrupted one is not allocated
+bool ReadRecord(FILE* file, long file_size, CachedResult* result) {
+  uint32_t size;
+  if (fread(&size, sizeof(size), 1, file) != 1) return false;
+  long offset = ftell(file);
+  if (offset < 0 || size > file_size - offset) return false;
+  std::string data(size, '\0');
+  if (fread(&data[0], 1, size, file) != size) return false;
+  return result->ParseFromString(data);
+}
+
+}  // namespace
+
+std::string LayoutFingerprint(const App& app, const Device& ref_device, const std::vector<Device>& devices,
+                              const std::string& model_version) {
+  std::string key = model_version;
+  StringAppendF(&key, "|%dx%d|", ref_device.width, ref_device.height);
+  for (const Device& device : devices) {
+    StringAppendF(&key, "%dx%d,", device.width, device.height);
+  }
+  key += '|';
+  for (const View& view : app.GetViews()) {
+    StringAppendF(&key, "%s %d %d %d %d %d %d,", view.name.c_str(), view.xleft, view.ytop, view.xright, view.ybottom,
+                  ViewSizeOrNone(view, Orientation::HORIZONTAL), ViewSizeOrNone(view, Orientation::VERTICAL));
+  }
+  return key;
+}
+
+void ResultToProto(const SynResult& res, CachedResult* proto) {
+  proto->set_status(static_cast<int>(res.status));
+  proto->clear_attributes();
+  for (const View& view : res.app.GetViews()) {
+    for (const auto& it : view.attributes) {
+      const Attribute& attr = it.second;
+      CachedAttribute* cached = proto->add_attributes();
+      cached->set_view_pos(view.pos);
+      cached->set_orientation(static_cast<int>(it.first));
+      cached->set_type(static_cast<int>(attr.type));
+      cached->set_view_size(static_cast<int>(attr.view_size));
+      cached->set_value_primary(attr.value_primary);
+      cached->set_value_secondary(attr.value_secondary);
+      cached->set_tgt_primary_pos(attr.tgt_primary->pos);
+      cached->set_tgt_secondary_pos((attr.tgt_secondary == nullptr) ? -1 : attr.tgt_secondary->pos);
+      cached->set_bias(attr.bias);
+      cached->set_prob(attr.prob);
+    }
+  }
+}
+
+bool ProtoToResult(const CachedResult& proto, SynResult* res) {
+  std::vector<View>& views = res->app.GetViews();
+  const int num_views = views.size();
+  for (const CachedAttribute& cached : proto.attributes()) {
+    if (cached.view_pos() < 0 || cached.view_pos() >= num_views || cached.tgt_primary_pos() < 0 || cached.tgt_primary_pos() >= num_views ||
+        cached.tgt_secondary_pos() >= num_views) {
+      return false;
+    }
+  }
+
+  res->status = static_cast<Status>(proto.status());
+  for (View& view : views) {
+    view.attributes.clear();
+  }
+  for (const CachedAttribute& cached : proto.attributes()) {
+    Attribute attr(static_cast<ConstraintType>(cached.type()), static_cast<ViewSize>(cached.view_size()),
+                   cached.value_primary(), cached.value_secondary(),
+                   &views[cached.view_pos()], &views[cached.tgt_primary_pos()],
+                   (cached.tgt_secondary_pos() < 0) ? nullptr : &views[cached.tgt_secondary_pos()],
+                   cached.bias());
+    attr.prob = cached.prob();
+    views[cached.view_pos()].attributes.insert({static_cast<Orientation>(cached.orientation()), attr});
+  }
+  return true;
+}
+
+ResultCache::ResultCache(size_t max_size, const std::string& filename)
+    : max_size(max_size), filename(filename), file(nullptr), num_records(0), hits(0), misses(0), evictions(0) {
+  if (!filename.empty()) {
+    Load();
+  }
+}
+
+ResultCache::~ResultCache() {
+  if (file != nullptr) {
+    fclose(file);
+  }
+}
+
+bool ResultCache::Get(const std::string& key, CachedResult* result) {
+  std::lock_guard<std::mutex> lock(mutex);
+  auto it = index.find(key);
+  if (it == index.end()) {
+    misses++;
+    return false;
+  }
+  hits++;
+  entries.splice(entries.begin(), entries, it->second);
+  *result = *it->second;
+  return true;
+}
+
+void ResultCache::Put(const CachedResult& result) {
+  if (max_size == 0) return;
+  std::lock_guard<std::mutex> lock(mutex);
+  Insert(result);
+  if (file != nullptr) {
+    if (!WriteRecord(file, result) || fflush(file) != 0) {
+      LOG(ERROR) << "Could not write to " << filename << ", results are no longer persisted";
+      fclose(file);
+      file = nullptr;
+      return;
+    }
+    num_records++;
+    MaybeCompact();
+  }
+}
+
+ResultCache::Stats ResultCache::GetStats() const {
+  std::lock_guard<std::mutex> lock(mutex);
+  Stats stats;
+  stats.size = entries.size();
+  stats.hits = hits;
+  stats.misses = misses;
+  stats.evictions = evictions;
+  return stats;
+}
+
+void ResultCache::Insert(const CachedResult& result) {
+  auto it = index.find(result.key());
+  if (it != index.end()) {
+    entries.erase(it->second);
+    index.erase(it);
+  }
+  entries.push_front(result);
+  index[result.key()] = entries.begin();
+  while (entries.size() > max_size) {
+    index.erase(entries.back().key());
+    entries.pop_back();
+    evictions++;
+  }
+}
+
+void ResultCache::Load() {
+  FILE* in = fopen(filename.c_str(), "rb");
+  if (in != nullptr) {
+    CHECK_EQ(fseek(in, 0, SEEK_END), 0);
+    long file_size = ftell(in);
+    rewind(in);
+    CachedResult result;
+    while (ReadRecord(in, file_size, &result)) {
+      Insert(result);
+    }
+    fclose(in);
+  }
+  // Evictions while loading are not counted
+  evictions = 0;
+  LOG(INFO) << "Loaded " << entries.size() << " cached results from " << filename;
+
+  // Drops evicted results and a truncated last record
+  CHECK(Rewrite()) << "Could not replace " << filename;
+  file = fopen(filename.c_str(), "ab");
+  CHECK(file != nullptr) << "Could not open " << filename;
+}
+
+bool ResultCache::Rewrite() {
+  const std::string tmp_filename = filename + ".tmp";
+  FILE* out = fopen(tmp_filename.c_str(), "wb");
+  if (out == nullptr) {
+    LOG(ERROR) << "Could not create " << tmp_filename;
+    return false;
+  }
+  // Least recently used first, so that loading the file restores the order
+  bool written = true;
+  for (auto it = entries.rbegin(); it != entries.rend() && written; ++it) {
+    written = WriteRecord(out, *it);
+  }
+  if (fclose(out) != 0 || !written || rename(tmp_filename.c_str(), filename.c_str()) != 0) {
+    LOG(ERROR) << "Could not write " << tmp_filename;
+    remove(tmp_filename.c_str());
+    return false;
+  }
+  num_records = entries.size();
+  return true;
+}
+
+void ResultCache::MaybeCompact() {
+  if (num_records - entries.size() <= num_records * kMaxDeadRecordRatio) return;
+  fclose(file);
+  file = nullptr;
+  if (Rewrite()) {
+    file = fopen(filename.c_str(), "ab");
+  }
+  if (file == nullptr) {
+    LOG(ERROR) << "Could not compact " << filename << ", results are no longer persisted";
+  }
+}
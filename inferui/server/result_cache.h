@@ -0,0 +1,91 @@
+/*
+   Copyright 2018 Software Reliability Lab, ETH Zurich
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#ifndef CC_SYNTHESIS_RESULT_CACHE_H
+#define CC_SYNTHESIS_RESULT_CACHE_H
+
+#include <stdio.h>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "inferui/synthesis/z3inference.h"
+#include "server/result_cache.pb.h"
+
+// Canonical key of a synthesis request: geometry, type and size of the views (in order),
+// the reference and target devices and the version of the model used to synthesize it.
+// Does not depend on the view ids, so that the same screen submitted by different clients shares the result.
+std::string LayoutFingerprint(const App& app, const Device& ref_device, const std::vector<Device>& devices,
+                              const std::string& model_version);
+
+// Stores status and synthesized attributes of the result.
+void ResultToProto(const SynResult& res, CachedResult* proto);
+
+// Applies the cached attributes to res->app, which has to contain the views of the request.
+// @returns false if the cached result does not match the views.
+bool ProtoToResult(const CachedResult& proto, SynResult* res);
+
+// LRU cache of synthesis results with at most max_size entries.
+// If filename is set, the results are also appended to the file and loaded from it on startup
+// (each result is flushed right away, a truncated last record is ignored).
+// The file is compacted once most of its records are replaced or evicted.
+// Thread safe.
+class ResultCache {
+public:
+  struct Stats {
+    size_t size;
+    long long hits;
+    long long misses;
+    long long evictions;
+  };
+
+  ResultCache(size_t max_size, const std::string& filename = "");
+  ~ResultCache();
+
+  bool Get(const std::string& key, CachedResult* result);
+  void Put(const CachedResult& result);
+
+  Stats GetStats() const;
+
+private:
+  typedef std::list<CachedResult> Entries;
+
+  // Requires mutex
+  void Insert(const CachedResult& result);
+  void Load();
+  // Writes the current entries to the file. @returns false if the file could not be replaced.
+  bool Rewrite();
+  // Rewrites the file once most of its records are dead
+  void MaybeCompact();
+
+  const size_t max_size;
+  const std::string filename;
+
+  mutable std::mutex mutex;
+  // Most recently used first
+  Entries entries;
+  std::unordered_map<std::string, Entries::iterator> index;
+  FILE* file;
+  // Records in the file, including the replaced and evicted ones
+  size_t num_records;
+
+  long long hits;
+  long long misses;
+  long long evictions;
+};
+
+#endif //CC_SYNTHESIS_RESULT_CACHE_H
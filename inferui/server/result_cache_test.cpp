@@ -0,0 +1,207 @@
+/*
+   Copyright 2018 Software Reliability Lab, ETH Zurich
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#include "gtest/gtest.h"
+#include "glog/logging.h"
+
+#include <stdio.h>
+#include "base/test_tmpfile.h"
+#include "result_cache.h"
+
+namespace {
+
+App TestApp(int shift) {
+  App app;
+  app.AddView(View(0, 0, 720, 1280, "parent", 0));
+  app.AddView(View(10 + shift, 10, 110 + shift, 60, "Button", 1));
+  app.AddView(View(150, 10, 250, 60, "TextView", 2));
+  return app;
+}
+
+CachedResult TestResult(const std::string& key) {
+  CachedResult result;
+  result.set_key(key);
+  result.set_status(static_cast<int>(Status::SUCCESS));
+  return result;
+}
+
+long FileSize(const std::string& filename) {
+  FILE* file = fopen(filename.c_str(), "rb");
+  CHECK(file != nullptr);
+  fseek(file, 0, SEEK_END);
+  long size = ftell(file);
+  fclose(file);
+  return size;
+}
+
+class ResultCacheFileTest : public TempFileTest {
+};
+
+}  // namespace
+
+TEST(ResultCacheTest, Fingerprint) {
+  Device ref(720, 1280);
+  std::vector<Device> devices = {Device(700, 1200)};
+  const std::string key = LayoutFingerprint(TestApp(0), ref, devices, "v1");
+  EXPECT_EQ(key, LayoutFingerprint(TestApp(0), ref, devices, "v1"));
+
+  EXPECT_NE(key, LayoutFingerprint(TestApp(1), ref, devices, "v1"));
+  EXPECT_NE(key, LayoutFingerprint(TestApp(0), ref, devices, "v2"));
+  EXPECT_NE(key, LayoutFingerprint(TestApp(0), Device(720, 1200), devices, "v1"));
+  EXPECT_NE(key, LayoutFingerprint(TestApp(0), ref, {Device(700, 1200), Device(760, 1300)}, "v1"));
+
+  App app = TestApp(0);
+  app.GetViews()[1].view_size[Orientation::HORIZONTAL] = ViewSize::MATCH_CONSTRAINT;
+  EXPECT_NE(key, LayoutFingerprint(app, ref, devices, "v1"));
+
+  // Ids are not part of the key
+  App renamed;
+  renamed.AddView(View(0, 0, 720, 1280, "parent", 0));
+  renamed.AddView(View(10, 10, 110, 60, "Button", 1, "@+id/ok"));
+  renamed.AddView(View(150, 10, 250, 60, "TextView", 2, "@+id/title"));
+  EXPECT_EQ(key, LayoutFingerprint(renamed, ref, devices, "v1"));
+}
+
+TEST(ResultCacheTest, ResultProto) {
+  SynResult res;
+  res.app = TestApp(0);
+  res.status = Status::SUCCESS;
+  std::vector<View>& views = res.app.GetViews();
+  views[1].ApplyAttribute(Orientation::HORIZONTAL, Attribute(ConstraintType::L2L, ViewSize::FIXED, 10, &views[1], &views[0]));
+  views[2].ApplyAttribute(Orientation::HORIZONTAL, Attribute(ConstraintType::L2RxR2R, ViewSize::FIXED, 40, 470, &views[2], &views[1], &views[0], 0.3));
+
+  CachedResult proto;
+  ResultToProto(res, &proto);
+  EXPECT_EQ(2, proto.attributes_size());
+
+  SynResult cached;
+  cached.app = TestApp(0);
+  ASSERT_TRUE(ProtoToResult(proto, &cached));
+  EXPECT_EQ(Status::SUCCESS, cached.status);
+  const std::vector<View>& cached_views = cached.app.GetViews();
+  ASSERT_TRUE(cached_views[2].HasAttribute(Orientation::HORIZONTAL));
+  EXPECT_FALSE(cached_views[2].HasAttribute(Orientation::VERTICAL));
+  const Attribute& attr = cached_views[2].GetAttribute(Orientation::HORIZONTAL);
+  EXPECT_TRUE(attr == views[2].GetAttribute(Orientation::HORIZONTAL));
+  EXPECT_EQ(&cached_views[2], attr.src);
+  EXPECT_EQ(&cached_views[1], attr.tgt_primary);
+  EXPECT_EQ(&cached_views[0], attr.tgt_secondary);
+  EXPECT_FLOAT_EQ(0.3, attr.bias);
+
+  // Fewer views than in the cached result
+  SynResult other;
+  other.app.AddView(View(0, 0, 720, 1280, "parent", 0));
+  EXPECT_FALSE(ProtoToResult(proto, &other));
+}
+
+TEST(ResultCacheTest, Lru) {
+  ResultCache cache(2);
+  CachedResult result;
+  EXPECT_FALSE(cache.Get("a", &result));
+  cache.Put(TestResult("a"));
+  cache.Put(TestResult("b"));
+  EXPECT_TRUE(cache.Get("a", &result));
+  EXPECT_EQ("a", result.key());
+  // b is the least recently used
+  cache.Put(TestResult("c"));
+  EXPECT_FALSE(cache.Get("b", &result));
+  EXPECT_TRUE(cache.Get("a", &result));
+  EXPECT_TRUE(cache.Get("c", &result));
+
+  ResultCache::Stats stats = cache.GetStats();
+  EXPECT_EQ(2, stats.size);
+  EXPECT_EQ(3, stats.hits);
+  EXPECT_EQ(2, stats.misses);
+  EXPECT_EQ(1, stats.evictions);
+
+  ResultCache disabled(0);
+  disabled.Put(TestResult("a"));
+  EXPECT_FALSE(disabled.Get("a", &result));
+}
+
+TEST_F(ResultCacheFileTest, Persistence) {
+  const char* filename = path.c_str();
+
+  {
+    ResultCache cache(2, filename);
+    cache.Put(TestResult("a"));
+    cache.Put(TestResult("b"));
+    cache.Put(TestResult("c"));
+  }
+  // Truncated record written by a crashed server
+  FILE* file = fopen(filename, "ab");
+  fputs("\x10\x00", file);
+  fclose(file);
+
+  {
+    ResultCache cache(2, filename);
+    CachedResult result;
+    EXPECT_EQ(2, cache.GetStats().size);
+    EXPECT_FALSE(cache.Get("a", &result));
+    EXPECT_TRUE(cache.Get("b", &result));
+    EXPECT_TRUE(cache.Get("c", &result));
+    cache.Put(TestResult("d"));
+  }
+  {
+    ResultCache cache(2, filename);
+    CachedResult result;
+    EXPECT_TRUE(cache.Get("d", &result));
+    EXPECT_TRUE(cache.Get("c", &result));
+    EXPECT_FALSE(cache.Get("b", &result));
+  }
+}
+
+TEST_F(ResultCacheFileTest, CompactsReplacedResults) {
+  ResultCache cache(2, path);
+  cache.Put(TestResult("a"));
+  cache.Put(TestResult("b"));
+  const long size = FileSize(path);
+  for (int i = 0; i < 100; i++) {
+    cache.Put(TestResult("a"));
+  }
+  // At most as many dead records as live ones
+  EXPECT_LE(FileSize(path), 2 * size);
+
+  ResultCache loaded(2, path);
+  CachedResult result;
+  EXPECT_EQ(2, loaded.GetStats().size);
+  EXPECT_TRUE(loaded.Get("a", &result));
+  EXPECT_TRUE(loaded.Get("b", &result));
+}
+
+TEST_F(ResultCacheFileTest, CorruptedRecordSize) {
+  {
+    ResultCache cache(2, path);
+    cache.Put(TestResult("a"));
+  }
+  // The length of the record is larger than the file
+  FILE* file = fopen(path.c_str(), "ab");
+  const uint32_t size = 0xffffffff;
+  fwrite(&size, sizeof(size), 1, file);
+  fputs("abc", file);
+  fclose(file);
+
+  ResultCache cache(2, path);
+  CachedResult result;
+  EXPECT_EQ(1, cache.GetStats().size);
+  EXPECT_TRUE(cache.Get("a", &result));
+}
+
+int main(int argc, char **argv) {
+  google::InstallFailureSignalHandler();
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -3,11 +3,17 @@
  */
 
 #include <stdlib.h>
+#include <algorithm>
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <thread>
 #include "glog/logging.h"
 
 #include "json/json.h"
 #include "json/server.h"
 #include "json/server_connectors_httpserver.h"
+#include "json/server_connectors_unixdomainsocketserver.h"
 #include "json/common_exception.h"
 #include "json/client.h"
 #include "json/client_connectors_httpclient.h"
@@ -21,14 +27,30 @@
 #include "base/fileutil.h"
 #include "inferui/eval/eval_util.h"
 #include "inferui/eval/eval_app_util.h"
+#include "server/app_catalog.h"
+#include "server/readiness.h"
+#include "server/request_scheduler.h"
+#include "server/server_metrics.h"
 
 #include <experimental/filesystem>
 namespace fs = std::experimental::filesystem;
 
 DEFINE_int32(server_port, 9005, "Port of the server.");
 DEFINE_string(server_host, "", "If client, this gives url (i.e. http://host:port/ ) of the server.");
+DEFINE_string(server_socket, "", "If set, the server listens on this unix domain socket path instead of --server_port.");
+DEFINE_int32(server_threads, 16, "Number of threads handling HTTP connections.");
+DEFINE_int32(synthesis_workers, 1, "Maximum number of analysis and synthesis requests processed concurrently.");
+DEFINE_int32(synthesis_queue_size, 16, "Maximum number of requests waiting for a worker. Further requests are rejected.");
+DEFINE_int32(default_deadline_ms, 0, "Deadline of requests that do not specify deadline_ms. 0 means no deadline.");
 
 DEFINE_string(data, "uidumps.proto", "File with app data.");
+DEFINE_string(app_catalog, "", "Index of the valid apps in --data, built on the first start. Defaults to <data>.catalog.");
+DEFINE_string(analysis_devices, "", "If set, properties of all the apps are analyzed in the background for these devices, e.g., 1080x1920,480x800.");
+DEFINE_int32(analysis_threads, 4, "Number of scheduler tasks analyzing the apps for the dataset method, "
+                                  "they count against --synthesis_workers.");
+
+// Error of the requests that need the layout solver when it failed on all the endpoints
+const char kLayoutSolverFailed[] = "LAYOUT_SOLVER_FAILED";
 
 
 /************************* Server ***************************/
@@ -37,7 +59,8 @@ class SynthesisServer : public jsonrpc::AbstractServer<SynthesisServer> {
 public:
   std::vector<std::unique_ptr<Synthesizer>> synthesizers;
 
-  SynthesisServer(jsonrpc::HttpServer* server) : jsonrpc::AbstractServer<SynthesisServer>(*server) {
+  SynthesisServer(jsonrpc::AbstractServerConnector* server) : jsonrpc::AbstractServer<SynthesisServer>(*server),
+      scheduler(FLAGS_synthesis_workers, FLAGS_synthesis_queue_size) {
     bindAndAddMethod(
         jsonrpc::Procedure("layout", jsonrpc::PARAMS_BY_NAME, jsonrpc::JSON_ARRAY,
             // Parameters:
@@ -74,6 +97,37 @@ public:
                            NULL),
         &SynthesisServer::analyze_app);
 
+    bindAndAddMethod(
+        jsonrpc::Procedure("cancel", jsonrpc::PARAMS_BY_NAME, jsonrpc::JSON_OBJECT,
+            // Parameters:
+                           "request_id", jsonrpc::JSON_STRING,
+                           NULL),
+        &SynthesisServer::cancel);
+
+    bindAndAddMethod(
+        jsonrpc::Procedure("scheduler_stats", jsonrpc::PARAMS_BY_NAME, jsonrpc::JSON_OBJECT,
+            // Parameters:
+                           NULL),
+        &SynthesisServer::scheduler_stats);
+
+    bindAndAddMethod(
+        jsonrpc::Procedure("metrics", jsonrpc::PARAMS_BY_NAME, jsonrpc::JSON_OBJECT,
+            // Parameters:
+                           NULL),
+        &SynthesisServer::metrics);
+
+    bindAndAddMethod(
+        jsonrpc::Procedure("health", jsonrpc::PARAMS_BY_NAME, jsonrpc::JSON_OBJECT,
+            // Parameters:
+                           NULL),
+        &SynthesisServer::health);
+
+    bindAndAddMethod(
+        jsonrpc::Procedure("ready", jsonrpc::PARAMS_BY_NAME, jsonrpc::JSON_OBJECT,
+            // Parameters:
+                           NULL),
+        &SynthesisServer::ready);
+
     synthesizers.emplace_back(std::unique_ptr<GenUserConstraints>(new GenUserConstraints()));
 //    synthesizers.emplace_back(std::unique_ptr<GenSmtSingleDeviceProbOpt>(new GenSmtSingleDeviceProbOpt(true)));
 //    synthesizers.emplace_back(std::unique_ptr<GenSmtMultiDeviceProbOpt>(new GenSmtMultiDeviceProbOpt(true)));
@@ -81,31 +135,44 @@ public:
 
     only_constraint_views = true;
 
-    Solver solver;
-    LOG(INFO) << "Loading apps to serve...";
-    ForEachValidApp(FLAGS_data.c_str(), [&](const ProtoApp& app) {
-      const ProtoScreen& screen = app.screens(0);
-
-      App syn_app(screen, only_constraint_views);
-      if (syn_app.GetViews().size() <= 2) return;
-//      if (syn_app.GetViews().size() > 20) return;
-
-//      App screen_app(screen, true);
-//      syn_app.InitializeAttributes(screen);
-//      Json::Value layout = solver.sendPost(syn_app.ToJSON());
-//      App rendered_app = JsonToApp(layout);
-//
-//      if (AppMatch(syn_app, rendered_app)) {
-//        return;
-//      }
-      apps_.push_back(app);
-      return;
+    // Requests received until the catalog is loaded wait in WaitUntilReady
+    readiness_.Start([this]() {
+      catalog_.reset(new AppCatalog(FLAGS_app_catalog.empty() ? FLAGS_data + ".catalog" : FLAGS_app_catalog,
+                                    DataVersion(FLAGS_data), [this](const std::function<void(const ProtoApp&)>& cb) {
+        ForEachValidApp(FLAGS_data.c_str(), [&](const ProtoApp& app) {
+          const ProtoScreen& screen = app.screens(0);
+
+          App syn_app(screen, only_constraint_views);
+          if (syn_app.GetViews().size() <= 2) return;
+//          if (syn_app.GetViews().size() > 20) return;
+          cb(app);
+        });
+      }));
+      LOG(INFO) << "Serving " << catalog_->size() << " apps.";
     });
-    LOG(INFO) << "Done. Loaded " << apps_.size() << " apps.";
+
+    if (!FLAGS_analysis_devices.empty()) {
+      std::vector<Device> devices = ParseDevices(FLAGS_analysis_devices);
+      warmup_thread_ = std::thread([this, devices]() {
+        if (!readiness_.WaitUntilReady(warmup_token_)) return;
+        LOG(INFO) << "Analyzing apps in the background...";
+        RequestScheduler::Status status = AnalyzeAll(devices, &warmup_token_);
+        LOG(INFO) << "Done analyzing apps: " << RequestScheduler::StatusStr(status);
+      });
+    }
+  }
+
+  ~SynthesisServer() {
+    warmup_token_.Cancel();
+    if (warmup_thread_.joinable()) {
+      warmup_thread_.join();
+    }
   }
 
-  Json::Value analyzeApp(const ProtoApp& app, const std::vector<Device>& devices) {
-    Json::Value res = Json::Value(Json::objectValue);
+  // @returns false if the layout solver could not render the app.
+  bool analyzeApp(const ProtoApp& app, const std::vector<Device>& devices, Json::Value* analysis) {
+    Json::Value& res = *analysis;
+    res = Json::Value(Json::objectValue);
 
     const ProtoScreen& screen = app.screens(0);
     App syn_app(screen, true);
@@ -118,42 +185,88 @@ public:
     }
     res["size"] = static_cast<int>(syn_app.GetViews().size());
 
+    std::map<std::string, bool> checked;
+    if (!CheckProperties(syn_app, Device(720, 1280), devices, &checked)) {
+      return false;
+    }
     Json::Value properties = Json::Value(Json::objectValue);
-    for (const auto& it : CheckProperties(syn_app, Device(720, 1280), devices)) {
+    for (const auto& it : checked) {
       properties[it.first] = it.second;
     }
     res["properties"] = properties;
 
-    return res;
+    return true;
   }
 
   void analyze_app(const Json::Value& request, Json::Value& response) {
+    if (!WaitUntilReady(request, response)) return;
     std::vector<Device> devices;
     for (const Json::Value &device : request["devices"]) {
       devices.push_back(Device(device[0].asInt(), device[1].asInt()));
     }
 
-    response = analyzeApp(apps_[request["id"].asInt()], devices);
+    int id = request["id"].asInt();
+    if (id < 0 || id >= static_cast<int>(catalog_->size())) {
+      response["error"] = "Requested ID does is invalid!";
+      return;
+    }
+    Schedule(request, response, [this, id, &response, &devices]() {
+      if (!AnalyzeCached(id, devices, &response)) {
+        response = Json::Value(Json::objectValue);
+        response["error"] = kLayoutSolverFailed;
+      }
+    });
   }
 
   void dataset(const Json::Value& request, Json::Value& response) {
+    if (!WaitUntilReady(request, response)) return;
     std::vector<Device> devices;
     for (const Json::Value& device : request["devices"]) {
       devices.push_back(Device(device[0].asInt(), device[1].asInt()));
     }
 
-    for (const ProtoApp& app : apps_) {
-      response.append(analyzeApp(app, devices));
-//      if (response.size() > 50) break;
+    // Not wrapped in Schedule, the analysis itself runs as scheduler tasks
+    CancellationToken token(RequestDeadline(request));
+    RequestScheduler::Status status = AnalyzeAll(devices, &token, request.get("request_id", "").asString());
+    if (status != RequestScheduler::Status::OK) {
+      response["error"] = RequestScheduler::StatusStr(status);
+      return;
     }
+
+    // The entries have the id of the app
+    Json::Value apps = Json::Value(Json::arrayValue);
+    Json::Value entry;
+    int missing = 0;
+    for (int id = 0; id < static_cast<int>(catalog_->size()); id++) {
+      if (!LookupAnalysis(id, devices, &entry)) {
+        missing++;
+        continue;
+      }
+      entry["id"] = id;
+      apps.append(entry);
+    }
+    if (missing > 0) {
+      // Some apps were not analyzed before the request was cancelled or expired, or could not be rendered
+      if (token.IsCancelled()) {
+        response["error"] = "CANCELLED";
+      } else if (token.IsExpired()) {
+        response["error"] = "DEADLINE_EXCEEDED";
+      } else {
+        response["error"] = kLayoutSolverFailed;
+      }
+      response["missing"] = missing;
+      return;
+    }
+    response = apps;
   }
 
   void screenshots(const Json::Value& request, Json::Value& response) {
     LOG(INFO) << "screenshots";
-    for (const ProtoApp& app : apps_) {
+    if (!WaitUntilReady(request, response)) return;
+    for (size_t id = 0; id < catalog_->size(); id++) {
       Json::Value entry = Json::Value(Json::objectValue);
-      const ProtoScreen& screen = app.screens(0);
-      entry["path"] = StringPrintf("%s", screen.window_path().substr(std::string("/home/pavol/ETH/data/").size()).c_str());
+      const AppCatalogEntry& app = catalog_->entry(id);
+      entry["path"] = StringPrintf("%s", app.window_path().substr(std::string("/home/pavol/ETH/data/").size()).c_str());
 //      LOG(INFO) << entry["path"];
       entry["name"] = app.package_name();
       response.append(entry);
@@ -190,18 +303,22 @@ public:
 
   void apps(const Json::Value& request, Json::Value& response) {
     LOG(INFO) << "apps";
+    if (!WaitUntilReady(request, response)) return;
     LOG(INFO) << request["id"].asInt();
     int id = request["id"].asInt();
-    if (id < 0 || id >= static_cast<int>(apps_.size())) {
+    ProtoApp app;
+    if (!catalog_->Get(id, &app)) {
       response["error"] = "Requested ID does is invalid!";
       return;
     }
 
-    const ProtoApp& app = apps_[id];
     const ProtoScreen& screen = app.screens(0);
     App syn_app(screen, true);
     syn_app.InitializeAttributes(screen);
-    adjustViewsByUserConstraints(&syn_app);
+    if (!adjustViewsByUserConstraints(&syn_app)) {
+      response["error"] = kLayoutSolverFailed;
+      return;
+    }
 
     LOG(INFO) << "Original";
     PrintApp(syn_app, true);
@@ -264,11 +381,13 @@ public:
       response["xml"] = xml_data;
     }
 
-    {
+    Schedule(request, response, [this, &response, &screen]() {
       LOG(INFO) << "Start Synthesis";
       Json::Value json_layouts = Json::Value(Json::objectValue);
       for (const auto &syn : synthesizers) {
+        ScopedMetricsLabel label(syn->name);
         SynResult res = syn->Synthesize(screen, only_constraint_views);
+        IncrementLabeled("status." + StatusStr(res.status));
         if (res.status == Status::SUCCESS) {
           LOG(INFO) << syn->name;
           PrintApp(res.app);
@@ -278,19 +397,174 @@ public:
       }
       LOG(INFO) << "Done..";
       response["layouts"] = json_layouts;
-    }
+    });
 
   }
 
+  void cancel(const Json::Value& request, Json::Value& response) {
+    response["cancelled"] = scheduler.Cancel(request["request_id"].asString());
+  }
+
+  void scheduler_stats(const Json::Value& /*request*/, Json::Value& response) {
+    RequestScheduler::Stats stats = scheduler.GetStats();
+    response["queued"] = stats.queued;
+    response["running"] = stats.running;
+    response["completed"] = static_cast<Json::Int64>(stats.completed);
+    response["rejected"] = static_cast<Json::Int64>(stats.rejected);
+    response["expired"] = static_cast<Json::Int64>(stats.expired);
+    response["cancelled"] = static_cast<Json::Int64>(stats.cancelled);
+  }
+
+  // Liveness probe, answered also while the server is starting
+  void health(const Json::Value& /*request*/, Json::Value& response) {
+    response["status"] = "ok";
+    response["uptime_ms"] = static_cast<Json::Int64>(readiness_.UptimeMs());
+  }
+
+  // Readiness probe, "ready" is false until the app catalog is loaded
+  void ready(const Json::Value& /*request*/, Json::Value& response) {
+    response["ready"] = readiness_.IsReady();
+    response["init_ms"] = static_cast<Json::Int64>(readiness_.InitMs());
+  }
+
+  // Latencies of the synthesis phases, statuses, render and Z3 statistics (see MetricsToJson)
+  void metrics(const Json::Value& /*request*/, Json::Value& response) {
+    response = MetricsToJson(Metrics().GetSnapshot(), scheduler.GetStats());
+  }
+
 private:
-  std::vector<ProtoApp> apps_;
+  // Waits until the server is initialized, at most until the deadline of the request.
+  // If the server is still starting, the response contains the error.
+  bool WaitUntilReady(const Json::Value& request, Json::Value& response) {
+    if (readiness_.IsReady()) {
+      return true;
+    }
+    CancellationToken token(RequestDeadline(request));
+    if (!readiness_.WaitUntilReady(token)) {
+      response["error"] = "UNAVAILABLE";
+      return false;
+    }
+    return true;
+  }
+
+  CancellationToken::Clock::time_point RequestDeadline(const Json::Value& request) {
+    int deadline_ms = request.get("deadline_ms", FLAGS_default_deadline_ms).asInt();
+    return deadline_ms > 0 ?
+           CancellationToken::Clock::now() + std::chrono::milliseconds(deadline_ms) :
+           CancellationToken::Clock::time_point::max();
+  }
+
+  // Runs fn on one of the --synthesis_workers. The request can specify deadline_ms and request_id (used by cancel).
+  // If the request is rejected, expires or is cancelled, the response contains the error.
+  void Schedule(const Json::Value& request, Json::Value& response, const std::function<void()>& fn) {
+    CancellationToken token(RequestDeadline(request));
+    RequestScheduler::Status status = scheduler.Run(fn, &token, request.get("request_id", "").asString());
+    if (status != RequestScheduler::Status::OK) {
+      response["error"] = RequestScheduler::StatusStr(status);
+    }
+  }
+
+  static std::vector<Device> ParseDevices(const std::string& value) {
+    std::vector<Device> devices;
+    std::vector<std::string> parts;
+    SplitStringUsing(value, ',', &parts);
+    for (const std::string& part : parts) {
+      int width, height;
+      CHECK_EQ(sscanf(part.c_str(), "%dx%d", &width, &height), 2) << "Invalid device " << part;
+      devices.push_back(Device(width, height));
+    }
+    return devices;
+  }
+
+  static std::string DevicesKey(const std::vector<Device>& devices) {
+    std::string key;
+    for (const Device& device : devices) {
+      key += StringPrintf("%dx%d,", device.width, device.height);
+    }
+    return key;
+  }
+
+  bool LookupAnalysis(int id, const std::vector<Device>& devices, Json::Value* res) {
+    std::lock_guard<std::mutex> lock(analysis_mutex_);
+    auto it = analysis_cache_.find(std::make_pair(DevicesKey(devices), id));
+    if (it == analysis_cache_.end()) {
+      return false;
+    }
+    *res = it->second;
+    return true;
+  }
+
+  // analyzeApp of the app from the catalog, the results are cached for each list of devices.
+  // @returns false if the layout solver could not render the app.
+  bool AnalyzeCached(int id, const std::vector<Device>& devices, Json::Value* res) {
+    if (LookupAnalysis(id, devices, res)) {
+      return true;
+    }
+    ProtoApp app;
+    CHECK(catalog_->Get(id, &app));
+    if (!analyzeApp(app, devices, res)) {
+      return false;
+    }
+    // Results of interrupted analyses are not cached
+    CancellationToken* token = ScopedCancellation::Current();
+    if (token == nullptr || (!token->IsCancelled() && !token->IsExpired())) {
+      std::lock_guard<std::mutex> lock(analysis_mutex_);
+      analysis_cache_[std::make_pair(DevicesKey(devices), id)] = *res;
+    }
+    return true;
+  }
+
+  // Analyzes the apps that are not cached yet on up to --analysis_threads scheduler workers.
+  // Stops early if the token is cancelled or expires.
+  // @returns OK if at least one of the tasks ran, otherwise why they did not run.
+  RequestScheduler::Status AnalyzeAll(const std::vector<Device>& devices, CancellationToken* token,
+                                      const std::string& request_id = "") {
+    const int num_apps = catalog_->size();
+    std::atomic<int> next_id(0);
+    // The tasks take the next app until all are analyzed, so the work is split among the ones that are not rejected
+    std::function<void()> fn = [this, &devices, &next_id, num_apps, token]() {
+      for (int id = next_id++; id < num_apps; id = next_id++) {
+        if (token->IsCancelled() || token->IsExpired()) return;
+        Json::Value analysis;
+        AnalyzeCached(id, devices, &analysis);
+      }
+    };
+    std::vector<RequestScheduler::Status> statuses = scheduler.RunAll(
+        std::vector<std::function<void()>>(std::max(1, FLAGS_analysis_threads), fn), token, request_id);
+    for (RequestScheduler::Status status : statuses) {
+      if (status == RequestScheduler::Status::OK) return status;
+    }
+    return statuses[0];
+  }
+
+  std::unique_ptr<AppCatalog> catalog_;
   bool only_constraint_views;
+  RequestScheduler scheduler;
+
+  std::mutex analysis_mutex_;
+  // Keyed by the devices and app id
+  std::map<std::pair<std::string, int>, Json::Value> analysis_cache_;
+  CancellationToken warmup_token_;
+  std::thread warmup_thread_;
+
+  // Last so that the initialization finishes before the other members are destroyed
+  Readiness readiness_;
 };
 
-void RunServer() {
+std::unique_ptr<jsonrpc::AbstractServerConnector> CreateServerConnector() {
+  if (!FLAGS_server_socket.empty()) {
+    LOG(INFO) << "Starting server on socket: " << FLAGS_server_socket;
+    // Remove stale socket left by a previous run, otherwise bind fails
+    unlink(FLAGS_server_socket.c_str());
+    return std::unique_ptr<jsonrpc::AbstractServerConnector>(new jsonrpc::UnixDomainSocketServer(FLAGS_server_socket));
+  }
   LOG(INFO) << "Starting server on port: " << FLAGS_server_port;
-  jsonrpc::HttpServer jsonhttp(FLAGS_server_port, "", "", 1);  // Single-threaded.
-  SynthesisServer server(&jsonhttp);
+  return std::unique_ptr<jsonrpc::AbstractServerConnector>(new jsonrpc::HttpServer(FLAGS_server_port, "", "", FLAGS_server_threads));
+}
+
+void RunServer() {
+  std::unique_ptr<jsonrpc::AbstractServerConnector> connector = CreateServerConnector();
+  SynthesisServer server(connector.get());
 
   server.StartListening();
 
@@ -0,0 +1,67 @@
+/*
+   Copyright 2018 Software Reliability Lab, ETH Zurich
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#include "server_metrics.h"
+
+namespace {
+
+Json::Value HistogramToJson(const Histogram& histogram) {
+  Json::Value res(Json::objectValue);
+  res["count"] = static_cast<Json::Int64>(histogram.count);
+  res["sum"] = histogram.sum;
+  res["max"] = histogram.max;
+  res["p50"] = histogram.Percentile(50);
+  res["p90"] = histogram.Percentile(90);
+  res["p99"] = histogram.Percentile(99);
+  // Only non-empty buckets
+  Json::Value buckets(Json::arrayValue);
+  for (size_t i = 0; i < histogram.buckets.size(); i++) {
+    if (histogram.buckets[i] == 0) continue;
+    Json::Value bucket(Json::arrayValue);
+    bucket.append(Histogram::Bounds()[i]);
+    bucket.append(static_cast<Json::Int64>(histogram.buckets[i]));
+    buckets.append(bucket);
+  }
+  res["buckets"] = buckets;
+  return res;
+}
+
+}  // namespace
+
+Json::Value MetricsToJson(const MetricsRegistry::Snapshot& snapshot, const RequestScheduler::Stats& scheduler_stats) {
+  Json::Value res(Json::objectValue);
+  Json::Value& counters = res["counters"] = Json::Value(Json::objectValue);
+  for (const auto& it : snapshot.counters) {
+    counters[it.first] = static_cast<Json::Int64>(it.second);
+  }
+  counters["scheduler.completed"] = static_cast<Json::Int64>(scheduler_stats.completed);
+  counters["scheduler.rejected"] = static_cast<Json::Int64>(scheduler_stats.rejected);
+  counters["scheduler.expired"] = static_cast<Json::Int64>(scheduler_stats.expired);
+  counters["scheduler.cancelled"] = static_cast<Json::Int64>(scheduler_stats.cancelled);
+
+  Json::Value& gauges = res["gauges"] = Json::Value(Json::objectValue);
+  for (const auto& it : snapshot.gauges) {
+    gauges[it.first] = it.second;
+  }
+  gauges["scheduler.queued"] = scheduler_stats.queued;
+  gauges["scheduler.running"] = scheduler_stats.running;
+
+  Json::Value& histograms = res["histograms"] = Json::Value(Json::objectValue);
+  for (const auto& it : snapshot.histograms) {
+    histograms[it.first] = HistogramToJson(it.second);
+  }
+  return res;
+}
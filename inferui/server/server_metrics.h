@@ -0,0 +1,30 @@
+/*
+   Copyright 2018 Software Reliability Lab, ETH Zurich
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#ifndef CC_SYNTHESIS_SERVER_METRICS_H
+#define CC_SYNTHESIS_SERVER_METRICS_H
+
+#include "base/metrics.h"
+#include "json/json.h"
+#include "server/request_scheduler.h"
+
+// Response of the metrics method:
+//   {"counters": {name: value}, "gauges": {name: value},
+//    "histograms": {name: {"count", "sum", "max", "p50", "p90", "p99", "buckets": [[upper bound, count], ...]}}}
+// The scheduler stats are added to the counters and gauges with the "scheduler." prefix.
+Json::Value MetricsToJson(const MetricsRegistry::Snapshot& snapshot, const RequestScheduler::Stats& scheduler_stats);
+
+#endif //CC_SYNTHESIS_SERVER_METRICS_H
@@ -3,11 +3,18 @@
  */
 
 #include <stdlib.h>
+#include <sys/stat.h>
+#include <condition_variable>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <thread>
 #include "glog/logging.h"
 
 #include "json/json.h"
 #include "json/server.h"
 #include "json/server_connectors_httpserver.h"
+#include "json/server_connectors_unixdomainsocketserver.h"
 #include "json/common_exception.h"
 #include "json/client.h"
 #include "json/client_connectors_httpclient.h"
@@ -20,22 +27,166 @@
 #include "inferui/model/model.h"
 #include "base/fileutil.h"
 #include "inferui/eval/eval_util.h"
+#include "inferui/synthesis/layout_session.h"
+#include "inferui/synthesis/progress.h"
+#include "server/readiness.h"
+#include "server/request_scheduler.h"
+#include "server/result_cache.h"
+#include "server/server_metrics.h"
+#include "server/worker_pool.h"
+#include "server/worker_protocol.h"
 
 DEFINE_int32(server_port, 9017, "Port of the server.");
 DEFINE_string(server_host, "", "If client, this gives url (i.e. http://host:port/ ) of the server.");
+DEFINE_string(server_socket, "", "If set, the server listens on this unix domain socket path instead of --server_port.");
+DEFINE_int32(server_threads, 16, "Number of threads handling HTTP connections.");
+DEFINE_int32(synthesis_workers, 4, "Maximum number of layouts synthesized concurrently.");
+DEFINE_int32(synthesis_queue_size, 64, "Maximum number of layout requests waiting for a synthesis worker. Further requests are rejected.");
+DEFINE_int32(default_deadline_ms, 60000, "Deadline of requests that do not specify deadline_ms. 0 means no deadline.");
+DEFINE_int32(stream_ttl_ms, 60000, "Finished streaming requests that are not polled for this long are discarded.");
+DEFINE_int32(max_poll_ms, 30000, "Maximum time a poll request waits for new results.");
+DEFINE_int32(session_ttl_ms, 600000, "Editing sessions that are not used for this long are closed.");
+DEFINE_int32(result_cache_size, 4096, "Maximum number of synthesized layouts cached. 0 disables the cache.");
+DEFINE_string(result_cache_file, "", "If set, cached layouts are persisted in this file and loaded on startup.");
+DEFINE_string(synthesis_worker, "", "If set, layouts are synthesized in --synthesis_processes worker processes started from this binary "
+              "(bazel-bin/server/synthesis_worker) instead of in the server process.");
+DEFINE_int32(synthesis_processes, 4, "Number of synthesis worker processes.");
+DEFINE_int32(worker_memory_limit_mb, 4096, "Memory limit of each synthesis worker process. 0 means no limit.");
+DEFINE_int32(worker_retries, 1, "Number of times a request is retried after its synthesis worker crashed.");
+DEFINE_bool(warmup_solve, true, "Synthesize a small layout after training the model, before the server reports ready.");
 
 /************************* Server ***************************/
 
 enum ERROR_CODES {
   INPUT_ERROR = 1,
   SYNTHESIS_ERROR,
+  REJECTED,
+  DEADLINE_EXCEEDED,
+  CANCELLED,
+  UNAVAILABLE,
+};
+
+// Synthesized once on startup to initialize Z3 before the first request
+const char kWarmupLayout[] = R"({"ref_device": {"width": 720, "height": 1280}, "devices": [{"width": 700, "height": 1200}],
+  "layout": {"content_frame": {"location": [0, 0, 720, 1280]}, "components": [
+    {"location": [10, 10, 40, 40], "type": "TextView", "attributes": {
+      "{http://schemas.android.com/apk/res/android}id": "@+id/text",
+      "{http://schemas.android.com/apk/res/android}layout_width": "wrap_content",
+      "{http://schemas.android.com/apk/res/android}layout_height": "wrap_content"}},
+    {"location": [50, 10, 40, 40], "type": "Button", "attributes": {
+      "{http://schemas.android.com/apk/res/android}id": "@+id/button",
+      "{http://schemas.android.com/apk/res/android}layout_width": "wrap_content",
+      "{http://schemas.android.com/apk/res/android}layout_height": "wrap_content"}}]}})";
+
+// Constraints synthesized so far (only orientations that are already solved)
+Json::Value PartialLayoutToJson(const App& app) {
+  Json::Value layout(Json::arrayValue);
+  for (size_t i = 1; i < app.GetViews().size(); i++) {
+    const View& view = app.GetViews()[i];
+    std::unordered_map<std::string, std::string> properties;
+    properties[Constants::name(Constants::ID, Constants::Type::INPUT_XML)] = view.id_string;
+    for (const auto& it : view.attributes) {
+      it.second.ToProperties(properties, Constants::Type::INPUT_XML);
+    }
+    Json::Value view_json(Json::objectValue);
+    for (const auto& it : properties) {
+      view_json[it.first] = it.second;
+    }
+    layout.append(view_json);
+  }
+  return layout;
+}
+
+// Results of a streaming layout request. Synthesis pushes intermediate results
+// (feasible and optimized layout of each orientation) followed by the final result,
+// which the client long-polls using the stream id.
+class LayoutStream : public ProgressListener {
+public:
+  typedef std::chrono::steady_clock Clock;
+
+  LayoutStream(const std::string& id, CancellationToken::Clock::time_point deadline)
+      : id(id), token(deadline), done(false), last_access(Clock::now()) {
+  }
+
+  void OnProgress(const std::string& stage, const App& app) override {
+    Json::Value update(Json::objectValue);
+    update["stage"] = stage;
+    update["layout"] = PartialLayoutToJson(app);
+    Push(update, false);
+  }
+
+  void Push(Json::Value update, bool last) {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      update["seq"] = static_cast<int>(updates.size());
+      updates.push_back(update);
+      done = last;
+    }
+    cv.notify_all();
+  }
+
+  // Waits at most timeout_ms until there are updates with seq >= after or the stream is done.
+  Json::Value Poll(int after, int timeout_ms) {
+    std::unique_lock<std::mutex> lock(mutex);
+    cv.wait_for(lock, std::chrono::milliseconds(timeout_ms), [this, after]{
+      return done || static_cast<int>(updates.size()) > after;
+    });
+    last_access = Clock::now();
+    Json::Value response(Json::objectValue);
+    response["stream_id"] = id;
+    response["updates"] = Json::Value(Json::arrayValue);
+    for (size_t i = std::max(after, 0); i < updates.size(); i++) {
+      response["updates"].append(updates[i]);
+    }
+    response["done"] = done;
+    return response;
+  }
+
+  bool IsFinished(int seen) {
+    std::lock_guard<std::mutex> lock(mutex);
+    return done && seen >= static_cast<int>(updates.size());
+  }
 
+  bool IsAbandoned() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return done && Clock::now() - last_access > std::chrono::milliseconds(FLAGS_stream_ttl_ms);
+  }
+
+  const std::string id;
+  // Deadline of the synthesis, the stream id is used to cancel it
+  CancellationToken token;
+
+private:
+  std::mutex mutex;
+  std::condition_variable cv;
+  std::vector<Json::Value> updates;
+  bool done;
+  Clock::time_point last_access;
+};
+
+// Layout edited interactively, the parsed app and its candidate constraints are kept between requests.
+struct EditingSession {
+  typedef std::chrono::steady_clock Clock;
+
+  EditingSession(const ProbModel* model, App&& app, const Device& ref_device, const std::vector<Device>& devices, bool opt)
+      : session(model, std::move(app), ref_device, devices, opt), last_access(Clock::now()) {
+  }
+
+  std::mutex mutex;
+  LayoutSession session;
+  // Layout request with the current components, used to format the responses
+  Json::Value request;
+  std::map<std::string, int> ids;
+  Clock::time_point last_access;
 };
 
 class SynthesisServer : public jsonrpc::AbstractServer<SynthesisServer> {
 public:
 
-  SynthesisServer(jsonrpc::HttpServer* server) : jsonrpc::AbstractServer<SynthesisServer>(*server), syn(true) {
+  SynthesisServer(jsonrpc::AbstractServerConnector* server) : jsonrpc::AbstractServer<SynthesisServer>(*server),
+      next_stream_id(0), stopping(false), next_session_id(0),
+      model_version(ModelVersion()), result_cache(FLAGS_result_cache_size, FLAGS_result_cache_file),
+      scheduler(FLAGS_synthesis_workers, FLAGS_synthesis_queue_size) {
     bindAndAddMethod(
         jsonrpc::Procedure("layout", jsonrpc::PARAMS_BY_NAME, jsonrpc::JSON_ARRAY,
             // Parameters:
@@ -46,7 +197,120 @@ public:
                            NULL),
         &SynthesisServer::layout);
 
+    bindAndAddMethod(
+        jsonrpc::Procedure("layout_batch", jsonrpc::PARAMS_BY_NAME, jsonrpc::JSON_ARRAY,
+            // Parameters:
+                           "requests", jsonrpc::JSON_ARRAY,
+                           NULL),
+        &SynthesisServer::layout_batch);
+
+    bindAndAddMethod(
+        jsonrpc::Procedure("poll", jsonrpc::PARAMS_BY_NAME, jsonrpc::JSON_OBJECT,
+            // Parameters:
+                           "stream_id", jsonrpc::JSON_STRING,
+                           NULL),
+        &SynthesisServer::poll);
+
+    bindAndAddMethod(
+        jsonrpc::Procedure("open_session", jsonrpc::PARAMS_BY_NAME, jsonrpc::JSON_OBJECT,
+            // Parameters:
+                           "ref_device", jsonrpc::JSON_OBJECT,
+                           "devices", jsonrpc::JSON_ARRAY,
+                           "layout", jsonrpc::JSON_OBJECT,
+                           NULL),
+        &SynthesisServer::open_session);
+
+    bindAndAddMethod(
+        jsonrpc::Procedure("update_views", jsonrpc::PARAMS_BY_NAME, jsonrpc::JSON_OBJECT,
+            // Parameters:
+                           "session_id", jsonrpc::JSON_STRING,
+                           NULL),
+        &SynthesisServer::update_views);
+
+    bindAndAddMethod(
+        jsonrpc::Procedure("synthesize", jsonrpc::PARAMS_BY_NAME, jsonrpc::JSON_OBJECT,
+            // Parameters:
+                           "session_id", jsonrpc::JSON_STRING,
+                           NULL),
+        &SynthesisServer::synthesize);
+
+    bindAndAddMethod(
+        jsonrpc::Procedure("close_session", jsonrpc::PARAMS_BY_NAME, jsonrpc::JSON_OBJECT,
+            // Parameters:
+                           "session_id", jsonrpc::JSON_STRING,
+                           NULL),
+        &SynthesisServer::close_session);
+
+    bindAndAddMethod(
+        jsonrpc::Procedure("cancel", jsonrpc::PARAMS_BY_NAME, jsonrpc::JSON_OBJECT,
+            // Parameters:
+                           "request_id", jsonrpc::JSON_STRING,
+                           NULL),
+        &SynthesisServer::cancel);
+
+    bindAndAddMethod(
+        jsonrpc::Procedure("scheduler_stats", jsonrpc::PARAMS_BY_NAME, jsonrpc::JSON_OBJECT,
+            // Parameters:
+                           NULL),
+        &SynthesisServer::scheduler_stats);
+
+    bindAndAddMethod(
+        jsonrpc::Procedure("cache_stats", jsonrpc::PARAMS_BY_NAME, jsonrpc::JSON_OBJECT,
+            // Parameters:
+                           NULL),
+        &SynthesisServer::cache_stats);
+
+    bindAndAddMethod(
+        jsonrpc::Procedure("metrics", jsonrpc::PARAMS_BY_NAME, jsonrpc::JSON_OBJECT,
+            // Parameters:
+                           NULL),
+        &SynthesisServer::metrics);
 
+    bindAndAddMethod(
+        jsonrpc::Procedure("health", jsonrpc::PARAMS_BY_NAME, jsonrpc::JSON_OBJECT,
+            // Parameters:
+                           NULL),
+        &SynthesisServer::health);
+
+    bindAndAddMethod(
+        jsonrpc::Procedure("ready", jsonrpc::PARAMS_BY_NAME, jsonrpc::JSON_OBJECT,
+            // Parameters:
+                           NULL),
+        &SynthesisServer::ready);
+
+    stream_reaper = std::thread([this]() {
+      std::unique_lock<std::mutex> lock(streams_mutex);
+      while (!stopping) {
+        streams_cv.wait_for(lock, std::chrono::seconds(1));
+        RemoveAbandonedStreams();
+      }
+    });
+
+    // Requests received until the model is trained wait in WaitUntilReady
+    readiness.Start([this]() {
+      if (!FLAGS_synthesis_worker.empty()) {
+        worker_pool.reset(new WorkerPool(
+            {FLAGS_synthesis_worker, "--train_data=" + FLAGS_train_data, "--logtostderr"},
+            FLAGS_synthesis_processes, static_cast<int64_t>(FLAGS_worker_memory_limit_mb) << 20, FLAGS_worker_retries));
+      }
+      syn.reset(new GenSmtMultiDeviceProbOpt(true));
+      if (FLAGS_warmup_solve) {
+        WarmUp();
+      }
+    });
+  }
+
+  ~SynthesisServer() {
+    {
+      std::lock_guard<std::mutex> lock(streams_mutex);
+      stopping = true;
+      // Running syntheses of streams are interrupted, the scheduler waits for them when it is destroyed
+      for (auto& it : streams) {
+        it.second->token.Cancel();
+      }
+    }
+    streams_cv.notify_all();
+    stream_reaper.join();
   }
 
   Device parseDevice(const Json::Value& obj) {
@@ -67,6 +331,14 @@ public:
     }
   }
 
+  Json::Value ErrorToJson(const jsonrpc::JsonRpcException& e) {
+    Json::Value error(Json::objectValue);
+    error["status"] = "INVALID";
+    error["code"] = e.GetCode();
+    error["error"] = e.GetMessage();
+    return error;
+  }
+
   View JsonToView(const Json::Value& value, std::map<std::string, int>& ids) {
     if (!value.isMember("attributes")) {
       ids.insert(std::make_pair("parent", 0));
@@ -106,25 +378,106 @@ public:
     return app;
   }
 
-  void layout(const Json::Value& request, Json::Value& response) {
-    LOG(INFO) << request;
+  // Parsed layout request ready to be synthesized
+  struct LayoutJob {
+    App app;
+    Device ref_device = Device(0, 0);
+    std::vector<Device> devices;
+    SynResult res;
+    // Result cache key
+    std::string key;
+  };
+
+  LayoutJob ParseLayoutRequest(const Json::Value& request) {
     std::map<std::string, int> ids;
-    App app = JsonToApp(request["layout"], ids);
-    for (const View& view : app.GetViews()) {
+    return ParseLayoutRequest(request, ids);
+  }
+
+  LayoutJob ParseLayoutRequest(const Json::Value& request, std::map<std::string, int>& ids) {
+    LayoutJob job;
+    job.app = JsonToApp(request["layout"], ids);
+    for (const View& view : job.app.GetViews()) {
       LOG(INFO) << view;
     }
 
-    Device ref_device = parseDevice(request["ref_device"]);
-    std::vector<Device> devices;
+    job.ref_device = parseDevice(request["ref_device"]);
     for (auto device : request["devices"]) {
-      devices.push_back(parseDevice(device));
+      job.devices.push_back(parseDevice(device));
     }
-    syn.SetDevice(ref_device, devices);
-    app.SetResizable(ref_device, devices);
+    job.app.SetResizable(job.ref_device, job.devices);
+    job.key = LayoutFingerprint(job.app, job.ref_device, job.devices, model_version);
+    return job;
+  }
+
+  // Returns true and sets the result of the job if the same layout was already synthesized
+  bool LookupResult(LayoutJob* job) {
+    CachedResult cached;
+    if (!result_cache.Get(job->key, &cached)) {
+      return false;
+    }
+    // Same views as the result of Synthesize
+    job->res.app = job->app;
+    return ProtoToResult(cached, &job->res);
+  }
 
-    SynResult res = syn.Synthesize(std::move(app));
-    LOG(INFO) << res.status;
+  std::function<void()> SynthesizeFn(LayoutJob* job) {
+    return [this, job]() {
+      {
+        ScopedMetricsLabel label(syn->name);
+        job->res = worker_pool ? SynthesizeInWorker(*job) :
+                   syn->Synthesize(std::move(job->app), job->ref_device, job->devices);
+        IncrementLabeled("status." + StatusStr(job->res.status));
+      }
 
+      // Interrupted requests and timeouts are not cached
+      CancellationToken* token = ScopedCancellation::Current();
+      if ((job->res.status == Status::SUCCESS || job->res.status == Status::UNSAT) &&
+          (token == nullptr || (!token->IsCancelled() && !token->IsExpired()))) {
+        CachedResult cached;
+        cached.set_key(job->key);
+        ResultToProto(job->res, &cached);
+        result_cache.Put(cached);
+      }
+    };
+  }
+
+  // Synthesizes the layout in one of the worker processes. If the worker crashes (and all the retries fail),
+  // the status is UNKNOWN.
+  SynResult SynthesizeInWorker(const LayoutJob& job) {
+    CancellationToken no_deadline;
+    CancellationToken* token = ScopedCancellation::Current();
+    if (token == nullptr) {
+      token = &no_deadline;
+    }
+    const unsigned no_timeout = std::numeric_limits<unsigned>::max();
+    const unsigned timeout_ms = SolverTimeoutMs(no_timeout);
+    WorkerRequest request;
+    LayoutToWorkerRequest(job.app, job.ref_device, job.devices, (timeout_ms == no_timeout) ? 0 : timeout_ms, &request);
+
+    SynResult res;
+    // Same views as the result of Synthesize
+    res.app = job.app;
+    std::string response;
+    CachedResult result;
+    bool received = worker_pool->Run(request.SerializeAsString(), &response, token);
+    if (!received && (token->IsCancelled() || token->IsExpired())) {
+      // The worker was killed (or never acquired) because of the token
+      ScopedCancellation::MarkInterrupted();
+    }
+    if (!received || !result.ParseFromString(response) ||
+        !ProtoToResult(result, &res)) {
+      res.status = Status::UNKNOWN;
+    }
+    return res;
+  }
+
+  void CheckSchedulerStatus(RequestScheduler::Status scheduler_status) {
+    ASSERT(scheduler_status != RequestScheduler::Status::REJECTED, ERROR_CODES::REJECTED, "Server overloaded, try again later");
+    ASSERT(scheduler_status != RequestScheduler::Status::DEADLINE_EXCEEDED, ERROR_CODES::DEADLINE_EXCEEDED, "Deadline exceeded");
+    ASSERT(scheduler_status != RequestScheduler::Status::CANCELLED, ERROR_CODES::CANCELLED, "Request cancelled");
+  }
+
+  Json::Value LayoutResponse(const Json::Value& request, const SynResult& res) {
     ASSERT(res.status == Status::SUCCESS, ERROR_CODES::SYNTHESIS_ERROR, StringPrintf("Synthesis Unsuccesfull: %s", StatusStr(res.status).c_str()));
 
     Json::Value layout(Json::arrayValue);
@@ -143,18 +496,380 @@ public:
 
       layout.append(view_json);
     }
-    response["layout"] = layout;
+    return layout;
+  }
+
+  void layout(const Json::Value& request, Json::Value& response) {
+    LOG(INFO) << request;
+    WaitUntilReady(request);
+    if (request.get("stream", false).asBool()) {
+      response["stream_id"] = StartStream(request);
+      return;
+    }
+    LayoutJob job = ParseLayoutRequest(request);
+
+    if (!LookupResult(&job)) {
+      // Optional: relative deadline and id used to cancel the request
+      CancellationToken token(RequestDeadline(request));
+      RequestScheduler::Status scheduler_status = scheduler.Run(SynthesizeFn(&job), &token, request.get("request_id", "").asString());
+      LOG(INFO) << RequestScheduler::StatusStr(scheduler_status) << " " << job.res.status;
+      CheckSchedulerStatus(scheduler_status);
+    }
+
+    response["layout"] = LayoutResponse(request, job.res);
     LOG(INFO) << response;
   }
 
+  // Synthesizes all the requests (each in the format of the layout method) in parallel.
+  // The results are returned in the same order, each with its own status:
+  //   {"status": "SUCCESS", "layout": [...]} or {"status": ..., "code": ..., "error": ...}
+  void layout_batch(const Json::Value& request, Json::Value& response) {
+    const Json::Value& requests = request["requests"];
+    LOG(INFO) << "layout_batch: " << requests.size() << " requests";
+    WaitUntilReady(request);
+    std::vector<LayoutJob> jobs(requests.size());
+    std::vector<Json::Value> errors(requests.size(), Json::Value(Json::nullValue));
+    std::vector<std::function<void()>> fns;
+    std::vector<int> scheduled;
+    std::vector<int> parsed;
+    for (Json::ArrayIndex i = 0; i < requests.size(); i++) {
+      try {
+        jobs[i] = ParseLayoutRequest(requests[i]);
+        parsed.push_back(i);
+        if (!LookupResult(&jobs[i])) {
+          fns.push_back(SynthesizeFn(&jobs[i]));
+          scheduled.push_back(i);
+        }
+      } catch (const jsonrpc::JsonRpcException& e) {
+        errors[i] = ErrorToJson(e);
+      }
+    }
+
+    // The deadline and request id apply to the whole batch
+    CancellationToken token(RequestDeadline(request));
+    std::vector<RequestScheduler::Status> scheduler_statuses(requests.size(), RequestScheduler::Status::OK);
+    if (!fns.empty()) {
+      std::vector<RequestScheduler::Status> statuses = scheduler.RunAll(fns, &token, request.get("request_id", "").asString());
+      for (size_t i = 0; i < scheduled.size(); i++) {
+        scheduler_statuses[scheduled[i]] = statuses[i];
+      }
+    }
+
+    for (int id : parsed) {
+      try {
+        CheckSchedulerStatus(scheduler_statuses[id]);
+        Json::Value entry(Json::objectValue);
+        entry["layout"] = LayoutResponse(requests[id], jobs[id].res);
+        entry["status"] = StatusStr(jobs[id].res.status);
+        response[id] = entry;
+      } catch (const jsonrpc::JsonRpcException& e) {
+        errors[id] = ErrorToJson(e);
+        if (scheduler_statuses[id] == RequestScheduler::Status::OK) {
+          errors[id]["status"] = StatusStr(jobs[id].res.status);
+        } else {
+          errors[id]["status"] = RequestScheduler::StatusStr(scheduler_statuses[id]);
+        }
+      }
+    }
+    for (Json::ArrayIndex i = 0; i < requests.size(); i++) {
+      if (!errors[i].isNull()) {
+        response[i] = errors[i];
+      }
+    }
+  }
+
+  // Long-polls results of a streaming layout request.
+  // Optional "after" is the number of updates already received, "timeout_ms" the maximum wait.
+  void poll(const Json::Value& request, Json::Value& response) {
+    const std::string id = request["stream_id"].asString();
+    std::shared_ptr<LayoutStream> stream;
+    {
+      std::lock_guard<std::mutex> lock(streams_mutex);
+      auto it = streams.find(id);
+      ASSERT(it != streams.end(), ERROR_CODES::INPUT_ERROR, "Unknown stream_id " + id);
+      stream = it->second;
+    }
+    int after = request.get("after", 0).asInt();
+    int timeout_ms = std::min(request.get("timeout_ms", FLAGS_max_poll_ms).asInt(), FLAGS_max_poll_ms);
+    response = stream->Poll(after, timeout_ms);
+
+    if (stream->IsFinished(after + response["updates"].size())) {
+      std::lock_guard<std::mutex> lock(streams_mutex);
+      streams.erase(id);
+    }
+  }
+
+  // Starts an editing session with the layout, the parameters are the same as in the layout method.
+  void open_session(const Json::Value& request, Json::Value& response) {
+    WaitUntilReady(request);
+    std::map<std::string, int> ids;
+    LayoutJob job = ParseLayoutRequest(request, ids);
+    std::shared_ptr<EditingSession> session = std::make_shared<EditingSession>(
+        syn->GetModel(), std::move(job.app), job.ref_device, job.devices, syn->IsOpt());
+    session->request["layout"] = request["layout"];
+    session->ids = std::move(ids);
+
+    std::lock_guard<std::mutex> lock(sessions_mutex);
+    RemoveExpiredSessions();
+    const std::string id = StringPrintf("session%lld", next_session_id++);
+    sessions[id] = session;
+    response["session_id"] = id;
+  }
+
+  // Replaces "components" (in the format of the layout method) of the views with the same ids
+  // and optionally the "content_frame". Only the candidates affected by the moved views are recomputed.
+  void update_views(const Json::Value& request, Json::Value& response) {
+    std::shared_ptr<EditingSession> session = FindSession(request["session_id"].asString());
+    std::lock_guard<std::mutex> lock(session->mutex);
+
+    std::vector<View> updates;
+    std::vector<std::pair<int, Json::Value>> components;
+    if (request.isMember("content_frame")) {
+      updates.push_back(JsonToView(request["content_frame"], session->ids));
+    }
+    for (const Json::Value& component : request["components"]) {
+      const std::string& id_string = component["attributes"][Constants::name(Constants::Name::ID, Constants::Type::INPUT_XML)].asString();
+      ASSERT(Contains(session->ids, id_string), ERROR_CODES::INPUT_ERROR, "Unknown view " + id_string, component);
+      updates.push_back(JsonToView(component, session->ids));
+      components.emplace_back(updates.back().id - 1, component);
+    }
+    ASSERT(session->session.UpdateViews(updates), ERROR_CODES::INPUT_ERROR, "Unknown view");
+    // The session request is changed only once all the updates are valid
+    if (request.isMember("content_frame")) {
+      session->request["layout"]["content_frame"] = request["content_frame"];
+    }
+    for (const auto& it : components) {
+      session->request["layout"]["components"][it.first] = it.second;
+    }
+    response["updated_candidates"] = session->session.NumUpdatedCandidates();
+  }
+
+  // Synthesizes the current layout of the session, the layout is in the same format as for the layout method.
+  // Optional "deadline_ms" and "request_id" as in the layout method.
+  void synthesize(const Json::Value& request, Json::Value& response) {
+    std::shared_ptr<EditingSession> session = FindSession(request["session_id"].asString());
+    std::lock_guard<std::mutex> lock(session->mutex);
+
+    const SynResult* res = nullptr;
+    const bool cached = session->session.HasResult();
+    if (cached) {
+      res = &session->session.Synthesize();
+    } else {
+      CancellationToken token(RequestDeadline(request));
+      RequestScheduler::Status scheduler_status = scheduler.Run([this, &session, &res]() {
+        ScopedMetricsLabel label(syn->name);
+        res = &session->session.Synthesize();
+        IncrementLabeled("status." + StatusStr(res->status));
+      }, &token, request.get("request_id", "").asString());
+      LOG(INFO) << RequestScheduler::StatusStr(scheduler_status);
+      CheckSchedulerStatus(scheduler_status);
+    }
+    response["layout"] = LayoutResponse(session->request, *res);
+    response["cached"] = cached;
+  }
+
+  void close_session(const Json::Value& request, Json::Value& response) {
+    std::lock_guard<std::mutex> lock(sessions_mutex);
+    response["closed"] = sessions.erase(request["session_id"].asString()) > 0;
+  }
+
+  void cancel(const Json::Value& request, Json::Value& response) {
+    response["cancelled"] = scheduler.Cancel(request["request_id"].asString());
+  }
+
+  void scheduler_stats(const Json::Value& /*request*/, Json::Value& response) {
+    RequestScheduler::Stats stats = scheduler.GetStats();
+    response["queued"] = stats.queued;
+    response["running"] = stats.running;
+    response["completed"] = static_cast<Json::Int64>(stats.completed);
+    response["rejected"] = static_cast<Json::Int64>(stats.rejected);
+    response["expired"] = static_cast<Json::Int64>(stats.expired);
+    response["cancelled"] = static_cast<Json::Int64>(stats.cancelled);
+  }
+
+  void cache_stats(const Json::Value& /*request*/, Json::Value& response) {
+    ResultCache::Stats stats = result_cache.GetStats();
+    response["size"] = static_cast<Json::UInt64>(stats.size);
+    response["hits"] = static_cast<Json::Int64>(stats.hits);
+    response["misses"] = static_cast<Json::Int64>(stats.misses);
+    response["evictions"] = static_cast<Json::Int64>(stats.evictions);
+  }
+
+  // Liveness probe, answered also while the server is starting
+  void health(const Json::Value& /*request*/, Json::Value& response) {
+    response["status"] = "ok";
+    response["uptime_ms"] = static_cast<Json::Int64>(readiness.UptimeMs());
+  }
+
+  // Readiness probe, "ready" is false until the model is trained and the warm-up solve finished
+  void ready(const Json::Value& /*request*/, Json::Value& response) {
+    response["ready"] = readiness.IsReady();
+    response["init_ms"] = static_cast<Json::Int64>(readiness.InitMs());
+  }
+
+  // Latencies of the synthesis phases, statuses, render and Z3 statistics (see MetricsToJson)
+  void metrics(const Json::Value& /*request*/, Json::Value& response) {
+    response = MetricsToJson(Metrics().GetSnapshot(), scheduler.GetStats());
+    ResultCache::Stats stats = result_cache.GetStats();
+    response["gauges"]["result_cache.size"] = static_cast<Json::UInt64>(stats.size);
+    response["counters"]["result_cache.hits"] = static_cast<Json::Int64>(stats.hits);
+    response["counters"]["result_cache.misses"] = static_cast<Json::Int64>(stats.misses);
+    response["counters"]["result_cache.evictions"] = static_cast<Json::Int64>(stats.evictions);
+    if (worker_pool) {
+      WorkerPool::Stats worker_stats = worker_pool->GetStats();
+      response["counters"]["workers.requests"] = static_cast<Json::Int64>(worker_stats.requests);
+      response["counters"]["workers.crashes"] = static_cast<Json::Int64>(worker_stats.crashes);
+      response["counters"]["workers.killed"] = static_cast<Json::Int64>(worker_stats.killed);
+    }
+  }
+
 private:
-  GenSmtMultiDeviceProbOpt syn;
+  // Waits until the server is initialized, at most until the deadline of the request
+  void WaitUntilReady(const Json::Value& request) {
+    if (readiness.IsReady()) {
+      return;
+    }
+    CancellationToken token(RequestDeadline(request));
+    ASSERT(readiness.WaitUntilReady(token), ERROR_CODES::UNAVAILABLE, "Server is starting, try again later");
+  }
+
+  void WarmUp() {
+    Json::Value request;
+    CHECK(Json::Reader().parse(kWarmupLayout, request));
+    LayoutJob job = ParseLayoutRequest(request);
+    SynResult res = syn->Synthesize(std::move(job.app), job.ref_device, job.devices);
+    LOG(INFO) << "Warm-up synthesis: " << StatusStr(res.status);
+  }
+
+  // Identifies the trained model, cached results of a different model are not used
+  static std::string ModelVersion() {
+    struct stat st;
+    if (stat(FLAGS_train_data.c_str(), &st) != 0) {
+      return FLAGS_train_data;
+    }
+    return StringPrintf("%s:%lld:%lld", FLAGS_train_data.c_str(), static_cast<long long>(st.st_size), static_cast<long long>(st.st_mtime));
+  }
+
+  // Synthesizes the layout on the scheduler, the results are returned by poll
+  std::string StartStream(const Json::Value& request) {
+    std::shared_ptr<LayoutJob> job = std::make_shared<LayoutJob>(ParseLayoutRequest(request));
+    std::shared_ptr<LayoutStream> stream;
+    {
+      std::lock_guard<std::mutex> lock(streams_mutex);
+      stream = std::make_shared<LayoutStream>(StringPrintf("stream%lld", next_stream_id++), RequestDeadline(request));
+      streams[stream->id] = stream;
+    }
+
+    auto finish = [this, request, job, stream](RequestScheduler::Status scheduler_status) {
+      Json::Value update(Json::objectValue);
+      try {
+        CheckSchedulerStatus(scheduler_status);
+        update["layout"] = LayoutResponse(request, job->res);
+        update["status"] = StatusStr(job->res.status);
+      } catch (const jsonrpc::JsonRpcException& e) {
+        update = ErrorToJson(e);
+        update["status"] = (scheduler_status == RequestScheduler::Status::OK) ?
+                           StatusStr(job->res.status) : RequestScheduler::StatusStr(scheduler_status);
+      }
+      update["stage"] = "final";
+      stream->Push(update, true);
+    };
+    if (LookupResult(job.get())) {
+      finish(RequestScheduler::Status::OK);
+      return stream->id;
+    }
+
+    // The stream id is also used to cancel the request
+    std::function<void()> synthesize = SynthesizeFn(job.get());
+    scheduler.RunAsync([synthesize, job, stream]() {
+      ScopedProgressListener listener(stream.get());
+      synthesize();
+    }, &stream->token, finish, stream->id);
+    return stream->id;
+  }
+
+  std::shared_ptr<EditingSession> FindSession(const std::string& id) {
+    std::lock_guard<std::mutex> lock(sessions_mutex);
+    auto it = sessions.find(id);
+    ASSERT(it != sessions.end(), ERROR_CODES::INPUT_ERROR, "Unknown session_id " + id);
+    it->second->last_access = EditingSession::Clock::now();
+    return it->second;
+  }
+
+  // Requires sessions_mutex
+  void RemoveExpiredSessions() {
+    for (auto it = sessions.begin(); it != sessions.end();) {
+      if (EditingSession::Clock::now() - it->second->last_access > std::chrono::milliseconds(FLAGS_session_ttl_ms)) {
+        LOG(INFO) << "Closing expired " << it->first;
+        it = sessions.erase(it);
+      } else {
+        ++it;
+      }
+    }
+  }
+
+  // Requires streams_mutex
+  void RemoveAbandonedStreams() {
+    for (auto it = streams.begin(); it != streams.end();) {
+      if (it->second->IsAbandoned()) {
+        LOG(INFO) << "Removing abandoned " << it->first;
+        it = streams.erase(it);
+      } else {
+        ++it;
+      }
+    }
+  }
+
+  CancellationToken::Clock::time_point RequestDeadline(const Json::Value& request) {
+    int deadline_ms = request.get("deadline_ms", FLAGS_default_deadline_ms).asInt();
+    if (deadline_ms <= 0) {
+      return CancellationToken::Clock::time_point::max();
+    }
+    return CancellationToken::Clock::now() + std::chrono::milliseconds(deadline_ms);
+  }
+
+  // Trained in the background, set once readiness is ready
+  std::unique_ptr<const GenSmtMultiDeviceProbOpt> syn;
+  // Set if --synthesis_worker is used
+  std::unique_ptr<WorkerPool> worker_pool;
+
+  std::mutex streams_mutex;
+  std::map<std::string, std::shared_ptr<LayoutStream>> streams;
+  long long next_stream_id;
+  // Removes finished streams that are no longer polled
+  std::thread stream_reaper;
+  std::condition_variable streams_cv;
+  bool stopping;
+
+  std::mutex sessions_mutex;
+  std::map<std::string, std::shared_ptr<EditingSession>> sessions;
+  long long next_session_id;
+
+  const std::string model_version;
+  ResultCache result_cache;
+
+  // Z3 solves run on --synthesis_workers threads, the connection threads only parse and serialize requests.
+  // Destroyed before the members used by the running requests.
+  RequestScheduler scheduler;
+
+  // Last so that the initialization finishes before the other members are destroyed
+  Readiness readiness;
 };
 
-void RunServer() {
+std::unique_ptr<jsonrpc::AbstractServerConnector> CreateServerConnector() {
+  if (!FLAGS_server_socket.empty()) {
+    LOG(INFO) << "Starting server on socket: " << FLAGS_server_socket;
+    // Remove stale socket left by a previous run, otherwise bind fails
+    unlink(FLAGS_server_socket.c_str());
+    return std::unique_ptr<jsonrpc::AbstractServerConnector>(new jsonrpc::UnixDomainSocketServer(FLAGS_server_socket));
+  }
   LOG(INFO) << "Starting server on port: " << FLAGS_server_port;
-  jsonrpc::HttpServer jsonhttp(FLAGS_server_port, "", "", 1);  // Single-threaded.
-  SynthesisServer server(&jsonhttp);
+  return std::unique_ptr<jsonrpc::AbstractServerConnector>(new jsonrpc::HttpServer(FLAGS_server_port, "", "", FLAGS_server_threads));
+}
+
+void RunServer() {
+  std::unique_ptr<jsonrpc::AbstractServerConnector> connector = CreateServerConnector();
+  SynthesisServer server(connector.get());
 
   server.StartListening();
 
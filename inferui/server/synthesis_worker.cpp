@@ -0,0 +1,72 @@
+/*
+   Copyright 2018 Software Reliability Lab, ETH Zurich
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+// Synthesis worker started by WorkerPool (see --synthesis_worker in studio).
+// Writes an empty frame to stdout once the model is trained, then reads WorkerRequest frames from stdin
+// and writes a CachedResult frame to stdout for each of them.
+// Exits when stdin is closed.
+
+#include <unistd.h>
+#include "glog/logging.h"
+
+#include "inferui/eval/eval_util.h"
+#include "server/result_cache.h"
+#include "server/worker_pool.h"
+#include "server/worker_protocol.h"
+
+int main(int argc, char** argv) {
+  google::InstallFailureSignalHandler();
+  google::ParseCommandLineFlags(&argc, &argv, true);
+  google::InitGoogleLogging(argv[0]);
+
+  // Responses are written to the original stdout, anything else printed to stdout goes to stderr
+  int response_fd = dup(STDOUT_FILENO);
+  CHECK_GE(response_fd, 0);
+  CHECK_GE(dup2(STDERR_FILENO, STDOUT_FILENO), 0);
+
+  const GenSmtMultiDeviceProbOpt syn(true);
+  LOG(INFO) << "Worker " << getpid() << " ready";
+  // Until then the pool sends the requests to the other workers
+  if (!WriteFrame(response_fd, "")) {
+    return 0;
+  }
+
+  std::string data;
+  while (ReadFrame(STDIN_FILENO, &data)) {
+    WorkerRequest request;
+    CHECK(request.ParseFromString(data));
+    Device ref_device(0, 0);
+    std::vector<Device> devices;
+    App app = WorkerRequestToLayout(request, &ref_device, &devices);
+
+    CancellationToken token(request.timeout_ms() > 0 ?
+                            CancellationToken::Clock::now() + std::chrono::milliseconds(request.timeout_ms()) :
+                            CancellationToken::Clock::time_point::max());
+    SynResult res;
+    {
+      ScopedCancellation scoped_cancellation(&token);
+      res = syn.Synthesize(std::move(app), ref_device, devices);
+    }
+
+    CachedResult result;
+    ResultToProto(res, &result);
+    CHECK(result.SerializeToString(&data));
+    if (!WriteFrame(response_fd, data)) {
+      break;
+    }
+  }
+  return 0;
+}
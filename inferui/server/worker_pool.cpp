@@ -0,0 +1,255 @@
+/*
+   Copyright 2018 Software Reliability Lab, ETH Zurich
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#include "worker_pool.h"
+
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <glog/logging.h>
+
+namespace {
+
+// Delay before a worker whose process exited during the initialization is started again
+const int kFailedStartDelayMs = 1000;
+
+bool ReadFully(int fd, char* data, size_t size) {
+  while (size > 0) {
+    ssize_t res = read(fd, data, size);
+    if (res < 0 && errno == EINTR) continue;
+    if (res <= 0) return false;
+    data += res;
+    size -= res;
+  }
+  return true;
+}
+
+bool WriteFully(int fd, const char* data, size_t size) {
+  while (size > 0) {
+    ssize_t res = write(fd, data, size);
+    if (res < 0 && errno == EINTR) continue;
+    if (res <= 0) return false;
+    data += res;
+    size -= res;
+  }
+  return true;
+}
+
+}  // namespace
+
+bool ReadFrame(int fd, std::string* data) {
+  uint32_t size;
+  if (!ReadFully(fd, reinterpret_cast<char*>(&size), sizeof(size))) return false;
+  data->resize(size);
+  return ReadFully(fd, &(*data)[0], size);
+}
+
+bool WriteFrame(int fd, const std::string& data) {
+  uint32_t size = data.size();
+  return WriteFully(fd, reinterpret_cast<const char*>(&size), sizeof(size)) && WriteFully(fd, data.data(), data.size());
+}
+
+WorkerPool::WorkerPool(const std::vector<std::string>& cmd, int num_workers, int64_t memory_limit, int max_retries)
+    : cmd(cmd), memory_limit(memory_limit), max_retries(max_retries), stopped(false) {
+  CHECK_GT(num_workers, 0);
+  for (int i = 0; i < num_workers; i++) {
+    workers.emplace_back(new Worker());
+    StartWorker(workers.back().get());
+  }
+  restart_thread = std::thread(&WorkerPool::RestartLoop, this);
+}
+
+WorkerPool::~WorkerPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopped = true;
+  }
+  restart_cv.notify_all();
+  restart_thread.join();
+  // No requests are running, so the workers can be killed right away
+  for (auto& worker : workers) {
+    kill(worker->process->pid(), SIGKILL);
+    worker->process->Close();
+    worker->process.reset();
+  }
+}
+
+void WorkerPool::StartWorker(Worker* worker) {
+  worker->initialized = false;
+  worker->has_response = false;
+  worker->exited = false;
+  worker->process.reset(new Subprocess(cmd));
+  if (memory_limit > 0) {
+    worker->process->SetMemoryLimit(memory_limit);
+  }
+  worker->process->Start([this, worker](int fd) {
+    std::string response;
+    const bool initialized = ReadFrame(fd, &response);
+    if (initialized) {
+      {
+        std::lock_guard<std::mutex> lock(worker->mutex);
+        worker->initialized = true;
+      }
+      Release(worker);
+    }
+    while (initialized && ReadFrame(fd, &response)) {
+      std::lock_guard<std::mutex> lock(worker->mutex);
+      worker->response.swap(response);
+      worker->has_response = true;
+      worker->cv.notify_all();
+    }
+    close(fd);
+    {
+      std::lock_guard<std::mutex> lock(worker->mutex);
+      worker->exited = true;
+      worker->cv.notify_all();
+    }
+    if (!initialized) {
+      LOG(ERROR) << "Worker exited before it was initialized";
+      ScheduleRestart(worker);
+    }
+  }, [](int /*fd*/) {});
+  VLOG(1) << "Started worker " << worker->process->pid();
+}
+
+void WorkerPool::RestartWorker(Worker* worker) {
+  kill(worker->process->pid(), SIGKILL);
+  worker->process->Close();
+  // Waits for the process and its stdout reader
+  worker->process.reset();
+  StartWorker(worker);
+}
+
+void WorkerPool::ScheduleRestart(Worker* worker) {
+  std::lock_guard<std::mutex> lock(mutex);
+  if (stopped) return;
+  restarts.push_back(worker);
+  restart_cv.notify_one();
+}
+
+void WorkerPool::RestartLoop() {
+  std::unique_lock<std::mutex> lock(mutex);
+  for (;;) {
+    restart_cv.wait(lock, [this]{ return stopped || !restarts.empty(); });
+    if (stopped) {
+      return;
+    }
+    Worker* worker = restarts.front();
+    restarts.pop_front();
+    lock.unlock();
+
+    bool failed_start;
+    {
+      std::lock_guard<std::mutex> worker_lock(worker->mutex);
+      failed_start = !worker->initialized;
+    }
+    if (failed_start) {
+      // Does not restart a worker that cannot start in a tight loop
+      lock.lock();
+      if (restart_cv.wait_for(lock, std::chrono::milliseconds(kFailedStartDelayMs), [this]{ return stopped; })) {
+        return;
+      }
+      lock.unlock();
+    }
+    RestartWorker(worker);
+    lock.lock();
+  }
+}
+
+WorkerPool::Worker* WorkerPool::Acquire(CancellationToken* token) {
+  std::unique_lock<std::mutex> lock(mutex);
+  while (idle.empty()) {
+    if (token->IsCancelled() || token->IsExpired()) {
+      return nullptr;
+    }
+    idle_cv.wait_for(lock, std::chrono::milliseconds(100));
+  }
+  Worker* worker = idle.back();
+  idle.pop_back();
+  return worker;
+}
+
+void WorkerPool::Release(Worker* worker) {
+  std::lock_guard<std::mutex> lock(mutex);
+  idle.push_back(worker);
+  idle_cv.notify_one();
+}
+
+bool WorkerPool::Run(const std::string& request, std::string* response, CancellationToken* token) {
+  for (int attempt = 0; attempt <= max_retries; attempt++) {
+    Worker* worker = Acquire(token);
+    if (worker == nullptr) {
+      return false;
+    }
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      stats.requests++;
+    }
+
+    uint32_t size = request.size();
+    bool sent = worker->process->Write(reinterpret_cast<const char*>(&size), sizeof(size)) &&
+        worker->process->Write(request.data(), request.size());
+    worker->process->Flush();
+
+    bool interrupted = false;
+    bool received = false;
+    {
+      std::unique_lock<std::mutex> lock(worker->mutex);
+      while (sent && !worker->has_response && !worker->exited) {
+        if (token->IsCancelled() || token->IsExpired()) {
+          interrupted = true;
+          break;
+        }
+        // Wake up periodically to check the token
+        worker->cv.wait_for(lock, std::chrono::milliseconds(100));
+      }
+      if (worker->has_response) {
+        response->swap(worker->response);
+        worker->has_response = false;
+        received = true;
+      }
+    }
+
+    if (received) {
+      Release(worker);
+      return true;
+    }
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      if (interrupted) {
+        stats.killed++;
+      } else {
+        stats.crashes++;
+      }
+    }
+    if (interrupted) {
+      LOG(INFO) << "Killing worker " << worker->process->pid() << " of interrupted request";
+    } else {
+      LOG(WARNING) << "Worker " << worker->process->pid() << " crashed, restarting (attempt " << attempt << ")";
+    }
+    // The retry goes to another worker while this one starts again
+    ScheduleRestart(worker);
+    if (interrupted) {
+      return false;
+    }
+  }
+  return false;
+}
+
+WorkerPool::Stats WorkerPool::GetStats() const {
+  std::lock_guard<std::mutex> lock(mutex);
+  return stats;
+}
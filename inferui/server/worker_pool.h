@@ -0,0 +1,99 @@
+/*
+   Copyright 2018 Software Reliability Lab, ETH Zurich
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#ifndef CC_SYNTHESIS_WORKER_POOL_H
+#define CC_SYNTHESIS_WORKER_POOL_H
+
+#include <stdint.h>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "inferui/synthesis/cancellation.h"
+#include "util/process/subprocess.h"
+
+// Messages on the worker pipes are sent as 4 byte length followed by the data.
+bool ReadFrame(int fd, std::string* data);
+bool WriteFrame(int fd, const std::string& data);
+
+// Pool of worker processes started with cmd, each handling one request at a time:
+// once initialized, the worker writes an empty frame to stdout, then it reads a frame with the request from stdin
+// and writes a frame with the response to stdout.
+// Workers that crash (e.g., exceed memory_limit) are restarted in the background and the request is retried
+// at most max_retries times on the workers that are initialized.
+// A crash of a worker does not affect the other requests. Thread safe.
+class WorkerPool {
+public:
+  struct Stats {
+    int64_t requests = 0;
+    int64_t crashes = 0;
+    int64_t killed = 0;
+  };
+
+  // memory_limit in bytes, -1 for no limit
+  WorkerPool(const std::vector<std::string>& cmd, int num_workers, int64_t memory_limit, int max_retries);
+  ~WorkerPool();
+
+  // Sends the request to an idle worker and waits for its response.
+  // If the token is cancelled or expires, the worker is killed and restarted.
+  // @returns false if no response was received.
+  bool Run(const std::string& request, std::string* response, CancellationToken* token);
+
+  Stats GetStats() const;
+
+private:
+  struct Worker {
+    std::unique_ptr<Subprocess> process;
+    std::mutex mutex;
+    std::condition_variable cv;
+    // Set by the stdout reader of the process
+    bool initialized;
+    bool has_response;
+    bool exited;
+    std::string response;
+  };
+
+  // The worker is idle once its process writes the first frame
+  void StartWorker(Worker* worker);
+  // Kills the process and starts a new one
+  void RestartWorker(Worker* worker);
+  // Restarts the worker on the restart thread
+  void ScheduleRestart(Worker* worker);
+  void RestartLoop();
+
+  Worker* Acquire(CancellationToken* token);
+  void Release(Worker* worker);
+
+  const std::vector<std::string> cmd;
+  const int64_t memory_limit;
+  const int max_retries;
+
+  mutable std::mutex mutex;
+  std::condition_variable idle_cv;
+  std::vector<std::unique_ptr<Worker>> workers;
+  std::vector<Worker*> idle;
+  Stats stats;
+  bool stopped;
+  std::condition_variable restart_cv;
+  // Workers that crashed or whose process exited before it was initialized
+  std::deque<Worker*> restarts;
+  std::thread restart_thread;
+};
+
+#endif //CC_SYNTHESIS_WORKER_POOL_H
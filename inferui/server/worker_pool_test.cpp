@@ -0,0 +1,182 @@
+/*
+   Copyright 2018 Software Reliability Lab, ETH Zurich
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#include <sys/stat.h>
+#include <unistd.h>
+#include <thread>
+
+#include "gtest/gtest.h"
+#include "glog/logging.h"
+
+#include "base/test_tmpfile.h"
+#include "server/worker_pool.h"
+#include "server/worker_protocol.h"
+
+namespace {
+
+// Empty frame the workers write once they are initialized
+const char kInitialized[] = "printf '\\000\\000\\000\\000'; ";
+
+std::vector<std::string> ShellWorker(const std::string& script) {
+  return {"/bin/sh", "-c", script};
+}
+
+// Scripts of the workers take turns through directories created with mkdir (which is atomic)
+class WorkerPoolRestartTest : public TempFileTest {
+protected:
+  void TearDown() override {
+    for (const char* suffix : {".crasher", ".healthy", ".started"}) {
+      rmdir((path + suffix).c_str());
+    }
+    unlink((path + ".request").c_str());
+    TempFileTest::TearDown();
+  }
+
+  bool Exists(const std::string& suffix) {
+    struct stat st;
+    return stat((path + suffix).c_str(), &st) == 0;
+  }
+};
+
+}  // namespace
+
+// cat sends each request back as the response
+TEST(WorkerPoolTest, EchoWorkers) {
+  WorkerPool pool(ShellWorker(std::string(kInitialized) + "exec cat"), 2, -1, 0);
+  std::vector<std::thread> threads;
+  std::vector<std::string> responses(8);
+  for (size_t i = 0; i < responses.size(); i++) {
+    threads.emplace_back([&pool, &responses, i]() {
+      CancellationToken token;
+      EXPECT_TRUE(pool.Run("request" + std::to_string(i), &responses[i], &token));
+    });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  for (size_t i = 0; i < responses.size(); i++) {
+    EXPECT_EQ("request" + std::to_string(i), responses[i]);
+  }
+  EXPECT_EQ(8, pool.GetStats().requests);
+  EXPECT_EQ(0, pool.GetStats().crashes);
+}
+
+TEST(WorkerPoolTest, RestartsCrashedWorkers) {
+  // Exits after reading a part of the request
+  WorkerPool pool(ShellWorker(std::string(kInitialized) + "head -c 2 > /dev/null"), 1, -1, 2);
+  CancellationToken token;
+  std::string response;
+  EXPECT_FALSE(pool.Run("request", &response, &token));
+  EXPECT_EQ(3, pool.GetStats().requests);
+  EXPECT_EQ(3, pool.GetStats().crashes);
+  // Restarted worker handles further requests
+  EXPECT_FALSE(pool.Run("request", &response, &token));
+  EXPECT_EQ(6, pool.GetStats().crashes);
+}
+
+TEST(WorkerPoolTest, KillsWorkersOfExpiredRequests) {
+  WorkerPool pool(ShellWorker(std::string(kInitialized) + "exec sleep 100"), 1, -1, 2);
+  CancellationToken token(CancellationToken::Clock::now() + std::chrono::milliseconds(200));
+  std::string response;
+  EXPECT_FALSE(pool.Run("request", &response, &token));
+  EXPECT_EQ(1, pool.GetStats().requests);
+  EXPECT_EQ(1, pool.GetStats().killed);
+  EXPECT_EQ(0, pool.GetStats().crashes);
+
+  CancellationToken cancelled;
+  cancelled.Cancel();
+  EXPECT_FALSE(pool.Run("request", &response, &cancelled));
+}
+
+TEST_F(WorkerPoolRestartTest, RetriesOnInitializedWorker) {
+  // The first worker crashes on its request and its restarts never finish the initialization,
+  // the second one echoes each request (4 byte length and "request") after 200ms
+  WorkerPool pool(ShellWorker(
+      "if mkdir " + path + ".crasher 2> /dev/null; then " + kInitialized + "head -c 2 > /dev/null; exit 1; fi; "
+      "if ! mkdir " + path + ".healthy 2> /dev/null; then exec sleep 100; fi; " + kInitialized +
+      "while head -c 11 > " + path + ".request; do sleep 0.2; cat " + path + ".request; done"), 2, -1, 1);
+  while (!Exists(".crasher") || !Exists(".healthy")) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+  // Both requests run at the same time, the one on the crashed worker is retried once the other one finishes
+  std::vector<std::thread> threads;
+  std::vector<std::string> responses(2);
+  for (size_t i = 0; i < responses.size(); i++) {
+    threads.emplace_back([&pool, &responses, i]() {
+      CancellationToken token(CancellationToken::Clock::now() + std::chrono::seconds(5));
+      EXPECT_TRUE(pool.Run("request", &responses[i], &token));
+    });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ("request", responses[0]);
+  EXPECT_EQ("request", responses[1]);
+  EXPECT_EQ(3, pool.GetStats().requests);
+  EXPECT_EQ(1, pool.GetStats().crashes);
+}
+
+TEST_F(WorkerPoolRestartTest, RestartsWorkerExitedBeforeInitialization) {
+  WorkerPool pool(ShellWorker(
+      "if mkdir " + path + ".started 2> /dev/null; then exit 1; fi; " + kInitialized + "exec cat"), 1, -1, 0);
+  CancellationToken token(CancellationToken::Clock::now() + std::chrono::seconds(5));
+  std::string response;
+  EXPECT_TRUE(pool.Run("request", &response, &token));
+  EXPECT_EQ("request", response);
+  EXPECT_EQ(0, pool.GetStats().crashes);
+}
+
+TEST(WorkerProtocolTest, LayoutRoundTrip) {
+  App app;
+  app.AddView(View(0, 0, 720, 1280, "parent", 0));
+  View button(10, 20, 110, 70, "Button", 1, "@+id/button");
+  button.view_size[Orientation::HORIZONTAL] = ViewSize::MATCH_CONSTRAINT;
+  button.view_size[Orientation::VERTICAL] = ViewSize::FIXED;
+  app.AddView(std::move(button));
+
+  WorkerRequest request;
+  LayoutToWorkerRequest(app, Device(720, 1280), {Device(720, 1000)}, 500, &request);
+  WorkerRequest parsed;
+  ASSERT_TRUE(parsed.ParseFromString(request.SerializeAsString()));
+  EXPECT_EQ(500, parsed.timeout_ms());
+
+  Device ref_device(0, 0);
+  std::vector<Device> devices;
+  App res = WorkerRequestToLayout(parsed, &ref_device, &devices);
+  EXPECT_EQ(720, ref_device.width);
+  ASSERT_EQ(1u, devices.size());
+  EXPECT_EQ(1000, devices[0].height);
+  EXPECT_FALSE(res.IsResizable(Orientation::HORIZONTAL));
+  EXPECT_TRUE(res.IsResizable(Orientation::VERTICAL));
+
+  ASSERT_EQ(2u, res.GetViews().size());
+  const View& view = res.GetViews()[1];
+  EXPECT_EQ(1, view.pos);
+  EXPECT_EQ("Button", view.name);
+  EXPECT_EQ("@+id/button", view.id_string);
+  EXPECT_EQ(110, view.xright);
+  EXPECT_TRUE(view.view_size.at(Orientation::HORIZONTAL) == ViewSize::MATCH_CONSTRAINT);
+  EXPECT_TRUE(view.view_size.at(Orientation::VERTICAL) == ViewSize::FIXED);
+  EXPECT_EQ(0u, res.GetViews()[0].view_size.size());
+}
+
+int main(int argc, char **argv) {
+  google::InstallFailureSignalHandler();
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,74 @@
+/*
+   Copyright 2018 Software Reliability Lab, ETH Zurich
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#include "worker_protocol.h"
+
+namespace {
+
+int ViewSizeOrNone(const View& view, const Orientation& orientation) {
+  auto it = view.view_size.find(orientation);
+  return (it == view.view_size.end()) ? -1 : static_cast<int>(it->second);
+}
+
+void SetDevice(const Device& device, WorkerDevice* proto) {
+  proto->set_width(device.width);
+  proto->set_height(device.height);
+}
+
+}  // namespace
+
+void LayoutToWorkerRequest(const App& app, const Device& ref_device, const std::vector<Device>& devices,
+                           int64_t timeout_ms, WorkerRequest* request) {
+  request->Clear();
+  for (const View& view : app.GetViews()) {
+    WorkerView* proto = request->add_views();
+    proto->set_xleft(view.xleft);
+    proto->set_ytop(view.ytop);
+    proto->set_xright(view.xright);
+    proto->set_ybottom(view.ybottom);
+    proto->set_name(view.name);
+    proto->set_id(view.id);
+    proto->set_id_string(view.id_string);
+    proto->set_width_size(ViewSizeOrNone(view, Orientation::HORIZONTAL));
+    proto->set_height_size(ViewSizeOrNone(view, Orientation::VERTICAL));
+  }
+  SetDevice(ref_device, request->mutable_ref_device());
+  for (const Device& device : devices) {
+    SetDevice(device, request->add_devices());
+  }
+  request->set_timeout_ms(timeout_ms);
+}
+
+App WorkerRequestToLayout(const WorkerRequest& request, Device* ref_device, std::vector<Device>* devices) {
+  App app;
+  for (const WorkerView& proto : request.views()) {
+    View view(proto.xleft(), proto.ytop(), proto.xright(), proto.ybottom(), proto.name(), proto.id(), proto.id_string());
+    if (proto.width_size() >= 0) {
+      view.view_size[Orientation::HORIZONTAL] = static_cast<ViewSize>(proto.width_size());
+    }
+    if (proto.height_size() >= 0) {
+      view.view_size[Orientation::VERTICAL] = static_cast<ViewSize>(proto.height_size());
+    }
+    app.AddView(std::move(view));
+  }
+  *ref_device = Device(request.ref_device().width(), request.ref_device().height());
+  devices->clear();
+  for (const WorkerDevice& device : request.devices()) {
+    devices->push_back(Device(device.width(), device.height()));
+  }
+  app.SetResizable(*ref_device, *devices);
+  return app;
+}
@@ -0,0 +1,32 @@
+/*
+   Copyright 2018 Software Reliability Lab, ETH Zurich
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#ifndef CC_SYNTHESIS_WORKER_PROTOCOL_H
+#define CC_SYNTHESIS_WORKER_PROTOCOL_H
+
+#include <stdint.h>
+#include <vector>
+#include "inferui/synthesis/z3inference.h"
+#include "server/synthesis_worker.pb.h"
+
+// Views (geometry, type, ids and sizes) and devices of a layout to be synthesized by a synthesis worker.
+void LayoutToWorkerRequest(const App& app, const Device& ref_device, const std::vector<Device>& devices,
+                           int64_t timeout_ms, WorkerRequest* request);
+
+// Inverse of LayoutToWorkerRequest, the app is resizable as for the given devices.
+App WorkerRequestToLayout(const WorkerRequest& request, Device* ref_device, std::vector<Device>* devices);
+
+#endif //CC_SYNTHESIS_WORKER_PROTOCOL_H
@@ -0,0 +1,47 @@
+/*
+   Copyright 2018 Software Reliability Lab, ETH Zurich
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+// Converts a compressed record file (RecordCompressedWriter) to the indexed record format (RecordIndexWriter).
+
+#include <gflags/gflags.h>
+#include "glog/logging.h"
+
+#include "util/recordio/parallel_writer.h"
+#include "util/recordio/recordio.h"
+
+DEFINE_string(input, "", "Compressed record file.");
+DEFINE_string(output, "", "Indexed record file.");
+DEFINE_int32(block_size_kb, 1024, "Size of the uncompressed blocks.");
+DEFINE_int32(threads, 4, "Number of threads compressing the blocks.");
+
+int main(int argc, char** argv) {
+  google::InstallFailureSignalHandler();
+  google::ParseCommandLineFlags(&argc, &argv, true);
+  google::InitGoogleLogging(argv[0]);
+  CHECK(!FLAGS_input.empty() && !FLAGS_output.empty()) << "Both --input and --output are required";
+
+  RecordCompressedReader reader(FLAGS_input);
+  ParallelRecordWriter writer(FLAGS_output, FLAGS_threads, static_cast<size_t>(FLAGS_block_size_kb) << 10);
+  std::string data;
+  int64_t num_records = 0;
+  while (reader.ReadRaw(&data)) {
+    writer.WriteRaw(data);
+    num_records++;
+  }
+  writer.Close();
+  LOG(INFO) << "Converted " << num_records << " records";
+  return 0;
+}
@@ -0,0 +1,168 @@
+/*
+   Copyright 2018 Software Reliability Lab, ETH Zurich
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#ifndef UTIL_RECORDIO_PARALLEL_READER_H_
+#define UTIL_RECORDIO_PARALLEL_READER_H_
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "glog/logging.h"
+
+#include "util/recordio/recordio.h"
+#include "util/thread/work_queue.h"
+
+struct ParallelReaderOptions {
+  // Threads that parse and filter the records, 0 uses one per core.
+  int num_threads = 0;
+  // Capacity of the queues between the stages.
+  size_t queue_size = 256;
+  // Deliver the records in the order of the file.
+  bool ordered = true;
+};
+
+// Calls cb(std::string*) with each serialized record of a compressed or an indexed record file.
+template <class Callback>
+void ForEachRawRecord(const std::string& file_name, const Callback& cb) {
+  std::string data;
+  if (IsIndexedRecordFile(file_name)) {
+    RecordIndexReader reader(file_name);
+    while (reader.ReadRaw(&data)) {
+      if (!cb(&data)) break;
+    }
+    return;
+  }
+  RecordCompressedReader reader(file_name);
+  while (reader.ReadRaw(&data)) {
+    if (!cb(&data)) break;
+  }
+  reader.Close();
+}
+
+// Reads the records in a pipeline: a reader thread decompresses the records, options.num_threads threads
+// parse them and call filter(thread, record) and the records for which the filter returns true are passed to
+// cb(record) on the calling thread. Reading stops once cb returns false.
+// The filter is called concurrently (thread is in [0, num_threads) and can be used to index per thread state),
+// cb is never called concurrently.
+template <class Record, class Filter, class Callback>
+void ForEachRecordParallel(const std::string& file_name, const ParallelReaderOptions& options,
+                           const Filter& filter, const Callback& cb) {
+  struct RawRecord {
+    // -1 marks the end of the input
+    int64_t index = -1;
+    std::string data;
+  };
+  struct ParsedRecord {
+    // -1 marks that a parse thread finished
+    int64_t index = -1;
+    bool valid = false;
+    Record record;
+  };
+
+  const int num_threads = (options.num_threads > 0) ? options.num_threads :
+      std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+  ProducerConsumerQueue<RawRecord> raw_records(options.queue_size);
+  ProducerConsumerQueue<ParsedRecord> parsed_records(options.queue_size);
+
+  // In ordered mode the reader stays at most window records ahead of the delivered records,
+  // which bounds the number of records waiting for a slower preceding record.
+  const int64_t window = 2 * options.queue_size + num_threads;
+  std::mutex window_mutex;
+  std::condition_variable window_cond;
+  int64_t delivered = 0;
+  std::atomic<bool> stopped(false);
+
+  std::thread reader([&]() {
+    int64_t index = 0;
+    ForEachRawRecord(file_name, [&](std::string* data) {
+      if (options.ordered) {
+        std::unique_lock<std::mutex> lock(window_mutex);
+        window_cond.wait(lock, [&] { return stopped || index < delivered + window; });
+      }
+      if (stopped) return false;
+      RawRecord raw;
+      raw.index = index++;
+      raw.data.swap(*data);
+      raw_records.Emplace(std::move(raw));
+      return true;
+    });
+    for (int i = 0; i < num_threads; i++) {
+      raw_records.Emplace();
+    }
+  });
+
+  std::vector<std::thread> parsers;
+  for (int thread = 0; thread < num_threads; thread++) {
+    parsers.emplace_back([&, thread]() {
+      for (;;) {
+        RawRecord raw = raw_records.PopSwap();
+        ParsedRecord parsed;
+        if (raw.index < 0) {
+          parsed_records.Emplace(std::move(parsed));
+          return;
+        }
+        parsed.index = raw.index;
+        if (!stopped) {
+          CHECK(parsed.record.ParseFromString(raw.data));
+          parsed.valid = filter(thread, static_cast<const Record&>(parsed.record));
+        }
+        parsed_records.Emplace(std::move(parsed));
+      }
+    });
+  }
+
+  // Records that arrived before the preceding ones, only used in ordered mode.
+  std::map<int64_t, ParsedRecord> pending;
+  auto deliver = [&](const ParsedRecord& parsed) {
+    if (parsed.valid && !stopped && !cb(parsed.record)) {
+      stopped = true;
+    }
+    {
+      std::lock_guard<std::mutex> lock(window_mutex);
+      delivered++;
+    }
+    window_cond.notify_one();
+  };
+  for (int finished = 0; finished < num_threads;) {
+    ParsedRecord parsed = parsed_records.PopSwap();
+    if (parsed.index < 0) {
+      finished++;
+      continue;
+    }
+    if (!options.ordered) {
+      deliver(parsed);
+      continue;
+    }
+    pending.emplace(parsed.index, std::move(parsed));
+    for (auto it = pending.begin(); it != pending.end() && it->first == delivered; it = pending.erase(it)) {
+      deliver(it->second);
+    }
+  }
+  CHECK(stopped || pending.empty());
+
+  reader.join();
+  for (std::thread& parser : parsers) {
+    parser.join();
+  }
+}
+
+#endif /* UTIL_RECORDIO_PARALLEL_READER_H_ */
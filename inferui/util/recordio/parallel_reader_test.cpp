@@ -0,0 +1,125 @@
+/*
+   Copyright 2018 Software Reliability Lab, ETH Zurich
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#include <unistd.h>
+
+#include <atomic>
+
+#include "gtest/gtest.h"
+#include "glog/logging.h"
+
+#include "base/test_tmpfile.h"
+#include "util/recordio/parallel_reader.h"
+#include "util/recordio/test_record.pb.h"
+
+namespace {
+
+class ParallelReaderTest : public TempFileTest {
+protected:
+  void WriteRecords(int num_records, bool indexed) {
+    RecordIndexWriter index_writer(indexed ? path : path + ".unused", 1024);
+    RecordCompressedWriter writer(indexed ? path + ".unused" : path);
+    for (int i = 0; i < num_records; i++) {
+      TestRecord record;
+      record.set_id(i);
+      record.set_payload(std::string(i % 100, 'x'));
+      if (indexed) {
+        index_writer.Write(record);
+      } else {
+        writer.Write(record);
+      }
+    }
+    index_writer.Close();
+    writer.Close();
+    unlink((path + ".unused").c_str());
+  }
+};
+
+}  // namespace
+
+TEST_F(ParallelReaderTest, OrderedDelivery) {
+  for (bool indexed : {false, true}) {
+    WriteRecords(2000, indexed);
+    ParallelReaderOptions options;
+    options.num_threads = 4;
+    options.queue_size = 16;
+    std::vector<int> filtered_by_thread(options.num_threads, 0);
+    std::vector<int64_t> ids;
+    ForEachRecordParallel<TestRecord>(path, options, [&](int thread, const TestRecord& record) {
+      if (record.id() % 3 == 0) {
+        filtered_by_thread[thread]++;
+        return false;
+      }
+      // Delay some records so that they complete out of order
+      if (record.id() % 50 == 1) usleep(1000);
+      return true;
+    }, [&](const TestRecord& record) {
+      EXPECT_EQ(std::string(record.id() % 100, 'x'), record.payload());
+      ids.push_back(record.id());
+      return true;
+    });
+
+    int filtered = 0;
+    for (int count : filtered_by_thread) filtered += count;
+    EXPECT_EQ(667, filtered);
+    ASSERT_EQ(1333u, ids.size());
+    for (size_t i = 1; i < ids.size(); i++) {
+      ASSERT_LT(ids[i - 1], ids[i]);
+    }
+  }
+}
+
+TEST_F(ParallelReaderTest, UnorderedDelivery) {
+  WriteRecords(1000, false);
+  ParallelReaderOptions options;
+  options.num_threads = 3;
+  options.ordered = false;
+  std::vector<bool> seen(1000, false);
+  ForEachRecordParallel<TestRecord>(path, options, [&](int /*thread*/, const TestRecord& /*record*/) {
+    return true;
+  }, [&](const TestRecord& record) {
+    EXPECT_FALSE(seen[record.id()]);
+    seen[record.id()] = true;
+    return true;
+  });
+  for (int i = 0; i < 1000; i++) {
+    EXPECT_TRUE(seen[i]) << i;
+  }
+}
+
+TEST_F(ParallelReaderTest, StopsEarly) {
+  WriteRecords(5000, true);
+  ParallelReaderOptions options;
+  options.num_threads = 2;
+  options.queue_size = 8;
+  std::atomic<int> filtered(0);
+  int delivered = 0;
+  ForEachRecordParallel<TestRecord>(path, options, [&](int /*thread*/, const TestRecord& /*record*/) {
+    filtered++;
+    return true;
+  }, [&](const TestRecord& record) {
+    EXPECT_EQ(delivered, record.id());
+    return ++delivered < 10;
+  });
+  EXPECT_EQ(10, delivered);
+  EXPECT_LT(filtered, 5000);
+}
+
+int main(int argc, char **argv) {
+  google::InstallFailureSignalHandler();
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,97 @@
+/*
+   Copyright 2018 Software Reliability Lab, ETH Zurich
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#include "parallel_writer.h"
+
+#include <algorithm>
+#include <memory>
+
+#include "glog/logging.h"
+
+ParallelRecordWriter::ParallelRecordWriter(const std::string& filename, int num_threads, size_t block_size,
+                                           size_t max_blocks_in_flight)
+    : block_size_(block_size),
+      max_blocks_in_flight_(max_blocks_in_flight > 0 ? max_blocks_in_flight : 2 * std::max(num_threads, 1)),
+      writer_(filename, block_size),
+      block_records_(0), in_flight_(0), next_block_(0), next_write_(0), closed_(false),
+      // The queue never fills up since at most max_blocks_in_flight_ tasks are submitted
+      pool_(std::max(num_threads, 1), max_blocks_in_flight_ + 1) {
+}
+
+ParallelRecordWriter::~ParallelRecordWriter() {
+  Close();
+}
+
+void ParallelRecordWriter::Write(const google::protobuf::MessageLite& message) {
+  std::string data;
+  CHECK(message.SerializeToString(&data));
+  WriteRaw(data);
+}
+
+void ParallelRecordWriter::WriteRaw(const std::string& data) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  CHECK(!closed_);
+  AppendRecordToBlock(data, &block_);
+  block_records_++;
+  if (block_.size() >= block_size_) {
+    SubmitBlock(&lock);
+  }
+}
+
+void ParallelRecordWriter::SubmitBlock(std::unique_lock<std::mutex>* lock) {
+  block_written_.wait(*lock, [this] { return in_flight_ < max_blocks_in_flight_; });
+  // Another thread may have submitted the block while waiting
+  if (block_records_ == 0) return;
+  in_flight_++;
+  int64_t id = next_block_++;
+  // The pool copies the task, the block is moved into a shared buffer to avoid copying it
+  std::shared_ptr<std::string> block = std::make_shared<std::string>();
+  block->swap(block_);
+  uint32_t num_records = block_records_;
+  block_records_ = 0;
+  pool_.AddTask([this, id, block, num_records]() {
+    CompressBlock(id, std::move(*block), num_records);
+  });
+}
+
+void ParallelRecordWriter::CompressBlock(int64_t id, std::string block, uint32_t num_records) {
+  CompressedBlock compressed;
+  compressed.data = CompressRecordBlock(block);
+  compressed.uncompressed_size = block.size();
+  compressed.num_records = num_records;
+
+  std::unique_lock<std::mutex> lock(mutex_);
+  compressed_.emplace(id, std::move(compressed));
+  // The thread that completes the next block writes all the blocks that are ready
+  for (auto it = compressed_.begin(); it != compressed_.end() && it->first == next_write_; it = compressed_.erase(it)) {
+    writer_.WriteCompressedBlock(it->second.data, it->second.uncompressed_size, it->second.num_records);
+    next_write_++;
+    in_flight_--;
+  }
+  lock.unlock();
+  block_written_.notify_all();
+}
+
+void ParallelRecordWriter::Close() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  if (closed_) return;
+  SubmitBlock(&lock);
+  closed_ = true;
+  block_written_.wait(lock, [this] { return in_flight_ == 0; });
+  lock.unlock();
+  pool_.JoinAll();
+  writer_.Close();
+}
@@ -0,0 +1,78 @@
+/*
+   Copyright 2018 Software Reliability Lab, ETH Zurich
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#ifndef UTIL_RECORDIO_PARALLEL_WRITER_H_
+#define UTIL_RECORDIO_PARALLEL_WRITER_H_
+
+#include <stdint.h>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <string>
+
+#include <google/protobuf/message_lite.h>
+
+#include "util/recordio/record_index.h"
+#include "util/thread/work_queue.h"
+
+// Writes an indexed record file (see RecordIndexWriter) while the records are produced: full blocks are
+// compressed on a thread pool and written in order. At most max_blocks_in_flight blocks are buffered,
+// Write blocks when the compression falls behind. Write can be called from multiple threads.
+class ParallelRecordWriter {
+public:
+  explicit ParallelRecordWriter(const std::string& filename, int num_threads = 4, size_t block_size = 1 << 20,
+                                size_t max_blocks_in_flight = 0);
+  ~ParallelRecordWriter();
+
+  void Write(const google::protobuf::MessageLite& message);
+  // Serialized message
+  void WriteRaw(const std::string& data);
+
+  // Writes the remaining records and the index.
+  void Close();
+
+private:
+  struct CompressedBlock {
+    std::string data;
+    uint32_t uncompressed_size;
+    uint32_t num_records;
+  };
+
+  // Requires mutex_ to be held
+  void SubmitBlock(std::unique_lock<std::mutex>* lock);
+  void CompressBlock(int64_t id, std::string block, uint32_t num_records);
+
+  const size_t block_size_;
+  const size_t max_blocks_in_flight_;
+  RecordIndexWriter writer_;
+
+  std::mutex mutex_;
+  std::condition_variable block_written_;
+  std::string block_;
+  uint32_t block_records_;
+  // Blocks submitted for compression but not written yet
+  size_t in_flight_;
+  int64_t next_block_;
+  int64_t next_write_;
+  // Compressed blocks waiting for the preceding blocks
+  std::map<int64_t, CompressedBlock> compressed_;
+  bool closed_;
+
+  // Last member, its threads are joined before the rest is destroyed
+  SimpleThreadPool pool_;
+};
+
+#endif /* UTIL_RECORDIO_PARALLEL_WRITER_H_ */
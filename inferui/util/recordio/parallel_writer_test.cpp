@@ -0,0 +1,100 @@
+/*
+   Copyright 2018 Software Reliability Lab, ETH Zurich
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "glog/logging.h"
+
+#include "base/test_tmpfile.h"
+#include "util/recordio/parallel_writer.h"
+#include "util/recordio/recordio.h"
+#include "util/recordio/test_record.pb.h"
+
+namespace {
+
+class ParallelWriterTest : public TempFileTest {
+};
+
+TestRecord MakeRecord(int id) {
+  TestRecord record;
+  record.set_id(id);
+  record.set_payload(std::string(id % 500, 'a' + id % 26));
+  return record;
+}
+
+}  // namespace
+
+TEST_F(ParallelWriterTest, WritesRecordsInOrder) {
+  {
+    ParallelRecordWriter writer(path, 4, 1024, 3);
+    for (int i = 0; i < 3000; i++) {
+      writer.Write(MakeRecord(i));
+    }
+    writer.Close();
+  }
+
+  ASSERT_TRUE(IsIndexedRecordFile(path));
+  RecordIndexReader reader(path);
+  EXPECT_EQ(3000, reader.num_records());
+  EXPECT_GT(reader.blocks().size(), 100u);
+  TestRecord record;
+  for (int i = 0; i < 3000; i++) {
+    ASSERT_TRUE(reader.Read(&record));
+    ASSERT_EQ(i, record.id());
+    ASSERT_EQ(MakeRecord(i).payload(), record.payload());
+  }
+  EXPECT_FALSE(reader.Read(&record));
+}
+
+TEST_F(ParallelWriterTest, ConcurrentWriters) {
+  {
+    ParallelRecordWriter writer(path, 3, 512);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; t++) {
+      threads.emplace_back([&writer, t]() {
+        for (int i = t; i < 2000; i += 4) {
+          writer.Write(MakeRecord(i));
+        }
+      });
+    }
+    for (std::thread& thread : threads) {
+      thread.join();
+    }
+  }
+
+  std::vector<TestRecord> records = ReadIntoVector<TestRecord>(path.c_str());
+  ASSERT_EQ(2000u, records.size());
+  std::vector<bool> seen(2000, false);
+  for (const TestRecord& record : records) {
+    EXPECT_FALSE(seen[record.id()]);
+    seen[record.id()] = true;
+    EXPECT_EQ(MakeRecord(record.id()).payload(), record.payload());
+  }
+}
+
+TEST_F(ParallelWriterTest, Empty) {
+  ParallelRecordWriter(path, 2).Close();
+  RecordIndexReader reader(path);
+  EXPECT_EQ(0, reader.num_records());
+}
+
+int main(int argc, char **argv) {
+  google::InstallFailureSignalHandler();
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,305 @@
+/*
+   Copyright 2018 Software Reliability Lab, ETH Zurich
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#include "record_index.h"
+
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <zlib.h>
+#include <algorithm>
+
+#include "glog/logging.h"
+
+namespace {
+
+const char kMagic[8] = {'R', 'E', 'C', 'I', 'D', 'X', '0', '1'};
+// index offset, number of blocks and magic
+const size_t kTrailerSize = 2 * sizeof(uint64_t) + sizeof(kMagic);
+// offset, compressed size, uncompressed size, number of records
+const size_t kIndexEntrySize = sizeof(uint64_t) + 3 * sizeof(uint32_t);
+
+template <class T>
+void Append(T value, std::string* out) {
+  out->append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+template <class T>
+T Parse(const char* data) {
+  T value;
+  memcpy(&value, data, sizeof(value));
+  return value;
+}
+
+bool PreadFully(int fd, char* data, size_t size, uint64_t offset) {
+  while (size > 0) {
+    ssize_t res = pread(fd, data, size, offset);
+    if (res <= 0) return false;
+    data += res;
+    size -= res;
+    offset += res;
+  }
+  return true;
+}
+
+// Reads the trailer, @returns false if the file is not in the indexed format
+bool ReadTrailer(int fd, uint64_t* index_offset, uint64_t* num_blocks) {
+  off_t size = lseek(fd, 0, SEEK_END);
+  if (size < static_cast<off_t>(kTrailerSize)) return false;
+  char trailer[kTrailerSize];
+  if (!PreadFully(fd, trailer, kTrailerSize, size - kTrailerSize)) return false;
+  if (memcmp(trailer + 2 * sizeof(uint64_t), kMagic, sizeof(kMagic)) != 0) return false;
+  *index_offset = Parse<uint64_t>(trailer);
+  *num_blocks = Parse<uint64_t>(trailer + sizeof(uint64_t));
+  return *index_offset + *num_blocks * kIndexEntrySize + kTrailerSize == static_cast<uint64_t>(size);
+}
+
+void AppendVarint32(uint32_t value, std::string* out) {
+  while (value >= 0x80) {
+    out->push_back(static_cast<char>(value | 0x80));
+    value >>= 7;
+  }
+  out->push_back(static_cast<char>(value));
+}
+
+bool ParseVarint32(const std::string& data, size_t* pos, uint32_t* value) {
+  *value = 0;
+  for (int shift = 0; shift < 35 && *pos < data.size(); shift += 7) {
+    uint8_t byte = data[(*pos)++];
+    *value |= static_cast<uint32_t>(byte & 0x7f) << shift;
+    if ((byte & 0x80) == 0) return true;
+  }
+  return false;
+}
+
+}  // namespace
+
+void AppendRecordToBlock(const std::string& data, std::string* block) {
+  AppendVarint32(data.size(), block);
+  block->append(data);
+}
+
+std::string CompressRecordBlock(const std::string& block) {
+  uLongf compressed_size = compressBound(block.size());
+  std::string compressed(compressed_size, '\0');
+  CHECK_EQ(compress2(reinterpret_cast<Bytef*>(&compressed[0]), &compressed_size,
+                     reinterpret_cast<const Bytef*>(block.data()), block.size(), Z_DEFAULT_COMPRESSION), Z_OK);
+  compressed.resize(compressed_size);
+  return compressed;
+}
+
+bool IsIndexedRecordFile(const std::string& filename) {
+  int fd = open(filename.c_str(), O_RDONLY);
+  if (fd < 0) return false;
+  uint64_t index_offset, num_blocks;
+  bool res = ReadTrailer(fd, &index_offset, &num_blocks);
+  close(fd);
+  return res;
+}
+
+RecordIndexWriter::RecordIndexWriter(const std::string& filename, size_t block_size)
+    : block_size_(block_size), block_records_(0), offset_(0) {
+  file_ = fopen(filename.c_str(), "wb");
+  CHECK(file_ != nullptr) << "Could not create " << filename;
+}
+
+RecordIndexWriter::~RecordIndexWriter() {
+  if (file_ != nullptr) {
+    Close();
+  }
+}
+
+void RecordIndexWriter::Write(const google::protobuf::MessageLite& message) {
+  std::string data;
+  CHECK(message.SerializeToString(&data));
+  WriteRaw(data);
+}
+
+void RecordIndexWriter::WriteRaw(const std::string& data) {
+  AppendRecordToBlock(data, &block_);
+  block_records_++;
+  if (block_.size() >= block_size_) {
+    FlushBlock();
+  }
+}
+
+void RecordIndexWriter::FlushBlock() {
+  if (block_records_ == 0) return;
+  AppendBlock(CompressRecordBlock(block_), block_.size(), block_records_);
+  block_.clear();
+  block_records_ = 0;
+}
+
+void RecordIndexWriter::WriteCompressedBlock(const std::string& compressed, uint32_t uncompressed_size, uint32_t num_records) {
+  // The records written with WriteRaw are not in a block yet
+  CHECK_EQ(block_records_, 0u) << "Compressed blocks cannot be mixed with records";
+  AppendBlock(compressed, uncompressed_size, num_records);
+}
+
+void RecordIndexWriter::AppendBlock(const std::string& compressed, uint32_t uncompressed_size, uint32_t num_records) {
+  CHECK(file_ != nullptr);
+  CHECK_EQ(fwrite(compressed.data(), 1, compressed.size(), file_), compressed.size());
+
+  RecordBlockInfo info;
+  info.offset = offset_;
+  info.compressed_size = compressed.size();
+  info.uncompressed_size = uncompressed_size;
+  info.num_records = num_records;
+  info.first_record = blocks_.empty() ? 0 : blocks_.back().first_record + blocks_.back().num_records;
+  blocks_.push_back(info);
+  offset_ += compressed.size();
+}
+
+void RecordIndexWriter::Close() {
+  CHECK(file_ != nullptr);
+  FlushBlock();
+  std::string index;
+  for (const RecordBlockInfo& info : blocks_) {
+    Append(info.offset, &index);
+    Append(info.compressed_size, &index);
+    Append(info.uncompressed_size, &index);
+    Append(info.num_records, &index);
+  }
+  Append(offset_, &index);
+  Append(static_cast<uint64_t>(blocks_.size()), &index);
+  index.append(kMagic, sizeof(kMagic));
+  CHECK_EQ(fwrite(index.data(), 1, index.size(), file_), index.size());
+  CHECK_EQ(fclose(file_), 0);
+  file_ = nullptr;
+}
+
+RecordIndexReader::RecordIndexReader(const std::string& filename)
+    : filename_(filename), num_records_(0), current_block_(-1), data_pos_(0), next_record_(0), end_record_(0) {
+  fd_ = open(filename.c_str(), O_RDONLY);
+  CHECK_GE(fd_, 0) << "Could not open " << filename;
+  uint64_t index_offset, num_blocks;
+  CHECK(ReadTrailer(fd_, &index_offset, &num_blocks)) << filename << " is not an indexed record file";
+
+  std::string index(num_blocks * kIndexEntrySize, '\0');
+  CHECK(PreadFully(fd_, &index[0], index.size(), index_offset));
+  for (uint64_t i = 0; i < num_blocks; i++) {
+    const char* entry = index.data() + i * kIndexEntrySize;
+    RecordBlockInfo info;
+    info.offset = Parse<uint64_t>(entry);
+    info.compressed_size = Parse<uint32_t>(entry + sizeof(uint64_t));
+    info.uncompressed_size = Parse<uint32_t>(entry + sizeof(uint64_t) + sizeof(uint32_t));
+    info.num_records = Parse<uint32_t>(entry + sizeof(uint64_t) + 2 * sizeof(uint32_t));
+    info.first_record = num_records_;
+    num_records_ += info.num_records;
+    blocks_.push_back(info);
+  }
+  end_record_ = num_records_;
+}
+
+RecordIndexReader::~RecordIndexReader() {
+  if (fd_ >= 0) {
+    Close();
+  }
+}
+
+void RecordIndexReader::Close() {
+  close(fd_);
+  fd_ = -1;
+}
+
+size_t RecordIndexReader::FindBlock(int64_t record) const {
+  // Last block starting at or before the record
+  auto it = std::upper_bound(blocks_.begin(), blocks_.end(), record,
+                             [](int64_t value, const RecordBlockInfo& info) { return value < info.first_record; });
+  return (it - blocks_.begin()) - 1;
+}
+
+void RecordIndexReader::LoadBlock(size_t block) {
+  const RecordBlockInfo& info = blocks_[block];
+  std::string compressed(info.compressed_size, '\0');
+  CHECK(PreadFully(fd_, &compressed[0], compressed.size(), info.offset)) << "Could not read block " << block << " of " << filename_;
+  data_.resize(info.uncompressed_size);
+  uLongf size = info.uncompressed_size;
+  CHECK_EQ(uncompress(reinterpret_cast<Bytef*>(&data_[0]), &size,
+                      reinterpret_cast<const Bytef*>(compressed.data()), compressed.size()), Z_OK)
+      << "Corrupted block " << block << " of " << filename_;
+  CHECK_EQ(size, info.uncompressed_size);
+  current_block_ = block;
+  data_pos_ = 0;
+}
+
+void RecordIndexReader::Seek(int64_t record) {
+  CHECK_GE(record, 0);
+  next_record_ = record;
+  if (record >= num_records_) {
+    return;
+  }
+  size_t block = FindBlock(record);
+  if (block != current_block_) {
+    LoadBlock(block);
+  } else {
+    data_pos_ = 0;
+  }
+  // Skips the preceding records of the block
+  for (int64_t i = blocks_[block].first_record; i < record; i++) {
+    uint32_t size;
+    CHECK(ParseVarint32(data_, &data_pos_, &size));
+    data_pos_ += size;
+  }
+}
+
+void RecordIndexReader::SetRange(int64_t begin, int64_t end) {
+  end_record_ = std::min(end, num_records_);
+  Seek(begin);
+}
+
+bool RecordIndexReader::ReadRaw(std::string* data) {
+  if (next_record_ >= end_record_) {
+    return false;
+  }
+  if (current_block_ == static_cast<size_t>(-1) || data_pos_ >= data_.size()) {
+    LoadBlock(FindBlock(next_record_));
+  }
+  uint32_t size;
+  CHECK(ParseVarint32(data_, &data_pos_, &size)) << "Corrupted block " << current_block_ << " of " << filename_;
+  CHECK_LE(data_pos_ + size, data_.size());
+  data->assign(data_, data_pos_, size);
+  data_pos_ += size;
+  next_record_++;
+  return true;
+}
+
+bool RecordIndexReader::Read(google::protobuf::MessageLite* message) {
+  std::string data;
+  if (!ReadRaw(&data)) {
+    return false;
+  }
+  CHECK(message->ParseFromString(data));
+  return true;
+}
+
+std::vector<std::pair<int64_t, int64_t>> RecordIndexReader::Split(int num_ranges) const {
+  CHECK_GT(num_ranges, 0);
+  std::vector<std::pair<int64_t, int64_t>> ranges;
+  int64_t begin = 0;
+  for (const RecordBlockInfo& info : blocks_) {
+    int64_t end = info.first_record + info.num_records;
+    // Closes the range once it reaches its share of the records
+    if (end * num_ranges >= num_records_ * static_cast<int64_t>(ranges.size() + 1)) {
+      ranges.emplace_back(begin, end);
+      begin = end;
+    }
+  }
+  if (begin < num_records_) {
+    ranges.emplace_back(begin, num_records_);
+  }
+  return ranges;
+}
@@ -0,0 +1,127 @@
+/*
+   Copyright 2018 Software Reliability Lab, ETH Zurich
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#ifndef UTIL_RECORDIO_RECORD_INDEX_H_
+#define UTIL_RECORDIO_RECORD_INDEX_H_
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <google/protobuf/message_lite.h>
+
+// Indexed record file:
+//   block* index trailer
+// Each block contains varint delimited records (as written by RecordWriter) compressed with zlib.
+// The index stores for each block its offset, compressed and uncompressed size and the number of records.
+// The trailer stores the offset of the index, the number of blocks and a magic string.
+// Records can be read from any position without decompressing the preceding blocks.
+
+struct RecordBlockInfo {
+  uint64_t offset;
+  uint32_t compressed_size;
+  uint32_t uncompressed_size;
+  uint32_t num_records;
+  // Index of the first record of the block, not stored in the file
+  int64_t first_record;
+};
+
+// True if the file ends with the trailer of the indexed record format.
+bool IsIndexedRecordFile(const std::string& filename);
+
+// Appends the serialized record to an uncompressed block.
+void AppendRecordToBlock(const std::string& data, std::string* block);
+
+// Compresses a block of records, thread safe.
+std::string CompressRecordBlock(const std::string& block);
+
+class RecordIndexWriter {
+public:
+  // Blocks are compressed once they contain at least block_size bytes.
+  explicit RecordIndexWriter(const std::string& filename, size_t block_size = 1 << 20);
+  ~RecordIndexWriter();
+
+  void Write(const google::protobuf::MessageLite& message);
+  // Serialized message
+  void WriteRaw(const std::string& data);
+
+  // Appends a block compressed with CompressRecordBlock. Cannot be mixed with Write/WriteRaw.
+  void WriteCompressedBlock(const std::string& compressed, uint32_t uncompressed_size, uint32_t num_records);
+
+  // Writes the remaining records and the index.
+  void Close();
+
+private:
+  void FlushBlock();
+  void AppendBlock(const std::string& compressed, uint32_t uncompressed_size, uint32_t num_records);
+
+  const size_t block_size_;
+  FILE* file_;
+  std::string block_;
+  uint32_t block_records_;
+  uint64_t offset_;
+  std::vector<RecordBlockInfo> blocks_;
+};
+
+// Reads indexed record files. Not thread safe, use a reader per thread (e.g., one for each range from Split).
+class RecordIndexReader {
+public:
+  explicit RecordIndexReader(const std::string& filename);
+  ~RecordIndexReader();
+
+  int64_t num_records() const {
+    return num_records_;
+  }
+
+  const std::vector<RecordBlockInfo>& blocks() const {
+    return blocks_;
+  }
+
+  // Next Read returns the given record. Only the block containing the record is decompressed.
+  void Seek(int64_t record);
+
+  // Reads only the records in [begin, end).
+  void SetRange(int64_t begin, int64_t end);
+
+  bool Read(google::protobuf::MessageLite* message);
+  bool ReadRaw(std::string* data);
+
+  // Splits the records into at most num_ranges ranges [begin, end) of whole blocks with similar number of records.
+  std::vector<std::pair<int64_t, int64_t>> Split(int num_ranges) const;
+
+  void Close();
+
+private:
+  // Index of the block containing the record
+  size_t FindBlock(int64_t record) const;
+  void LoadBlock(size_t block);
+
+  const std::string filename_;
+  int fd_;
+  std::vector<RecordBlockInfo> blocks_;
+  int64_t num_records_;
+
+  // Decompressed current block
+  size_t current_block_;
+  std::string data_;
+  size_t data_pos_;
+  int64_t next_record_;
+  int64_t end_record_;
+};
+
+#endif /* UTIL_RECORDIO_RECORD_INDEX_H_ */
@@ -0,0 +1,117 @@
+/*
+   Copyright 2018 Software Reliability Lab, ETH Zurich
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#include "gtest/gtest.h"
+#include "glog/logging.h"
+
+#include "base/test_tmpfile.h"
+#include "util/recordio/record_index.h"
+
+namespace {
+
+std::string Record(int i) {
+  // Records of different sizes, some larger than the block
+  return std::string(1 + (i * 37) % 300, 'a' + i % 26) + std::to_string(i);
+}
+
+class RecordIndexTest : public TempFileTest {
+protected:
+  void WriteRecords(int num_records, size_t block_size) {
+    RecordIndexWriter writer(path, block_size);
+    for (int i = 0; i < num_records; i++) {
+      writer.WriteRaw(Record(i));
+    }
+    writer.Close();
+  }
+};
+
+}  // namespace
+
+TEST_F(RecordIndexTest, ReadsAllRecords) {
+  EXPECT_FALSE(IsIndexedRecordFile(path));
+  WriteRecords(1000, 1024);
+  EXPECT_TRUE(IsIndexedRecordFile(path));
+
+  RecordIndexReader reader(path);
+  EXPECT_EQ(1000, reader.num_records());
+  EXPECT_GT(reader.blocks().size(), 10u);
+  std::string data;
+  for (int i = 0; i < 1000; i++) {
+    ASSERT_TRUE(reader.ReadRaw(&data));
+    ASSERT_EQ(Record(i), data);
+  }
+  EXPECT_FALSE(reader.ReadRaw(&data));
+}
+
+TEST_F(RecordIndexTest, EmptyFile) {
+  WriteRecords(0, 1024);
+  EXPECT_TRUE(IsIndexedRecordFile(path));
+  RecordIndexReader reader(path);
+  EXPECT_EQ(0, reader.num_records());
+  std::string data;
+  EXPECT_FALSE(reader.ReadRaw(&data));
+  EXPECT_TRUE(reader.Split(4).empty());
+}
+
+TEST_F(RecordIndexTest, Seek) {
+  WriteRecords(500, 2048);
+  RecordIndexReader reader(path);
+  std::string data;
+  for (int record : {499, 0, 250, 251, 17, 17, 300}) {
+    reader.Seek(record);
+    ASSERT_TRUE(reader.ReadRaw(&data));
+    EXPECT_EQ(Record(record), data);
+    if (record + 1 < 500) {
+      ASSERT_TRUE(reader.ReadRaw(&data));
+      EXPECT_EQ(Record(record + 1), data);
+    } else {
+      EXPECT_FALSE(reader.ReadRaw(&data));
+    }
+  }
+  reader.Seek(500);
+  EXPECT_FALSE(reader.ReadRaw(&data));
+}
+
+TEST_F(RecordIndexTest, SplitIntoRanges) {
+  WriteRecords(1000, 512);
+  RecordIndexReader reader(path);
+  std::vector<std::pair<int64_t, int64_t>> ranges = reader.Split(4);
+  ASSERT_EQ(4u, ranges.size());
+  EXPECT_EQ(0, ranges.front().first);
+  EXPECT_EQ(1000, ranges.back().second);
+
+  // Each range read by an independent reader
+  int64_t next = 0;
+  for (const auto& range : ranges) {
+    EXPECT_EQ(next, range.first);
+    EXPECT_GT(range.second - range.first, 150);
+    RecordIndexReader range_reader(path);
+    range_reader.SetRange(range.first, range.second);
+    std::string data;
+    for (int64_t i = range.first; i < range.second; i++) {
+      ASSERT_TRUE(range_reader.ReadRaw(&data));
+      ASSERT_EQ(Record(i), data);
+    }
+    EXPECT_FALSE(range_reader.ReadRaw(&data));
+    next = range.second;
+  }
+}
+
+int main(int argc, char **argv) {
+  google::InstallFailureSignalHandler();
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -98,6 +98,16 @@ bool RecordCompressedReader::Read(google::protobuf::MessageLite* message) {
   return true;
 }
 
+bool RecordCompressedReader::ReadRaw(std::string* data) {
+  google::protobuf::io::CodedInputStream in(in_stream_.get());
+  unsigned int size;
+  CHECK(in.ReadVarint32(&size));
+  if (size == static_cast<unsigned int>(-1)) return false;
+  CHECK_GE(static_cast<int>(size), 0);  // No integer overflow.
+  CHECK(in.ReadString(data, size));
+  return true;
+}
+
 RecordReader::RecordReader(const std::string& filename) : in_file_(filename) {
   CHECK(in_file_.is_open()) << "Could not open " << filename;
   in_stream_.reset(new google::protobuf::io::IstreamInputStream(&in_file_));
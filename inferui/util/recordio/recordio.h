@@ -14,6 +14,8 @@
 #include <google/protobuf/message_lite.h>
 #include <mutex>
 
+#include "util/recordio/record_index.h"
+
 namespace google { namespace protobuf { namespace io {
 class OstreamOutputStream;
 class CodedOutputStream;
@@ -58,6 +60,8 @@ public:
   ~RecordCompressedReader();
 
   bool Read(google::protobuf::MessageLite* message);
+  // Serialized message
+  bool ReadRaw(std::string* data);
 
   void Close();
 
@@ -80,6 +84,7 @@ private:
   std::unique_ptr<google::protobuf::io::IstreamInputStream> in_stream_;
 };
 
+// Keeps all the records in memory until Close(), see ParallelRecordWriter for large outputs.
 template <class Record>
 class BufferedRecordWriter {
 public:
@@ -105,9 +110,19 @@ private:
   const std::string file_name_;
 };
 
+// Both the compressed and the indexed record files are supported.
 template <class Record>
 std::vector<Record> ReadIntoVector(const char* file_name) {
   std::vector<Record> results;
+  if (IsIndexedRecordFile(file_name)) {
+    RecordIndexReader reader(file_name);
+    results.reserve(reader.num_records());
+    Record report;
+    while (reader.Read(&report)) {
+      results.push_back(report);
+    }
+    return results;
+  }
   RecordCompressedReader reader(file_name);
   Record report;
   while(reader.Read(&report)) {
@@ -119,6 +134,14 @@ std::vector<Record> ReadIntoVector(const char* file_name) {
 
 template <class Record, class Callback>
 void ForEachRecord(const char* file_name, const Callback& cb) {
+  if (IsIndexedRecordFile(file_name)) {
+    RecordIndexReader reader(file_name);
+    Record report;
+    while (reader.Read(&report)) {
+      if (!cb(report)) break;
+    }
+    return;
+  }
   RecordCompressedReader reader(file_name);
   Record report;
   while(reader.Read(&report)) {
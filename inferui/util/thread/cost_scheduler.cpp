@@ -0,0 +1,192 @@
+/*
+   Copyright 2018 Software Reliability Lab, ETH Zurich
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#include "util/thread/cost_scheduler.h"
+
+#include <stdio.h>
+
+#include <algorithm>
+#include <fstream>
+#include <memory>
+#include <numeric>
+#include <thread>
+
+#include "base/base.h"
+#include "base/stringprintf.h"
+#include "glog/logging.h"
+
+namespace {
+
+struct TaskQueue {
+  std::mutex mutex;
+  // Ordered by decreasing cost
+  std::deque<size_t> tasks;
+};
+
+}  // namespace
+
+CostScheduler::CostScheduler(int num_threads) : num_threads_(num_threads) {
+  if (num_threads_ <= 0) {
+    num_threads_ = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+  }
+}
+
+std::vector<ThreadUtilization> CostScheduler::Run(const std::vector<double>& costs,
+                                                  const std::function<void(size_t task, int thread)>& fn) const {
+  std::vector<size_t> order(costs.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(), [&costs](size_t a, size_t b) {
+    return costs[a] > costs[b];
+  });
+
+  // Round robin such that each thread starts with one of the most expensive tasks
+  std::vector<std::unique_ptr<TaskQueue>> queues;
+  for (int thread = 0; thread < num_threads_; thread++) {
+    queues.emplace_back(new TaskQueue());
+  }
+  for (size_t i = 0; i < order.size(); i++) {
+    queues[i % num_threads_]->tasks.push_back(order[i]);
+  }
+
+  auto pop = [&queues](int thread, bool own, size_t* task) {
+    TaskQueue& queue = *queues[thread];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (queue.tasks.empty()) return false;
+    if (own) {
+      *task = queue.tasks.front();
+      queue.tasks.pop_front();
+    } else {
+      *task = queue.tasks.back();
+      queue.tasks.pop_back();
+    }
+    return true;
+  };
+
+  std::vector<ThreadUtilization> utilization(num_threads_);
+  Timer wall_timer;
+  wall_timer.Start();
+  std::vector<std::thread> threads;
+  for (int thread = 0; thread < num_threads_; thread++) {
+    threads.emplace_back([&, thread]() {
+      ThreadUtilization& stats = utilization[thread];
+      for (;;) {
+        size_t task;
+        bool found = pop(thread, true, &task);
+        for (int i = 1; !found && i < num_threads_; i++) {
+          found = pop((thread + i) % num_threads_, false, &task);
+          if (found) stats.stolen++;
+        }
+        // Tasks are never added, so all the queues stay empty
+        if (!found) break;
+
+        Timer timer;
+        timer.Start();
+        fn(task, thread);
+        stats.busy_ms += timer.GetMilliSeconds();
+        stats.tasks++;
+      }
+    });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  // Threads that finished early were idle until the last one finished
+  double wall_ms = wall_timer.GetMilliSeconds();
+  for (ThreadUtilization& stats : utilization) {
+    stats.wall_ms = wall_ms;
+  }
+  return utilization;
+}
+
+void CostScheduler::LogUtilization(const std::vector<ThreadUtilization>& utilization) {
+  double busy_ms = 0, wall_ms = 0;
+  LOG(INFO) << "Thread utilization:";
+  for (size_t thread = 0; thread < utilization.size(); thread++) {
+    const ThreadUtilization& stats = utilization[thread];
+    LOG(INFO) << StringPrintf("\t%2d: %5.1f%% (%d tasks, %d stolen, busy %.1fs)", static_cast<int>(thread),
+                              stats.wall_ms > 0 ? 100 * stats.busy_ms / stats.wall_ms : 0.0,
+                              stats.tasks, stats.stolen, stats.busy_ms / 1000);
+    busy_ms += stats.busy_ms;
+    wall_ms += stats.wall_ms;
+  }
+  LOG(INFO) << StringPrintf("\tTotal: %5.1f%%", wall_ms > 0 ? 100 * busy_ms / wall_ms : 0.0);
+}
+
+TaskCostHistory::TaskCostHistory(const std::string& filename) : filename_(filename) {
+  std::ifstream in(filename);
+  std::string key;
+  double ms;
+  while (std::getline(in, key, '\t') && in >> ms) {
+    costs_[key] = ms;
+    in.ignore(1);
+  }
+  if (!costs_.empty()) {
+    LOG(INFO) << "Loaded solve times of " << costs_.size() << " tasks from " << filename;
+  }
+}
+
+bool TaskCostHistory::Get(const std::string& key, double* ms) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = costs_.find(key);
+  if (it == costs_.end()) return false;
+  *ms = it->second;
+  return true;
+}
+
+void TaskCostHistory::Set(const std::string& key, double ms) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  costs_[key] = ms;
+}
+
+std::vector<double> TaskCostHistory::PredictCosts(const std::vector<std::string>& keys,
+                                                  const std::vector<double>& estimates) const {
+  CHECK_EQ(keys.size(), estimates.size());
+  std::vector<double> costs(keys.size(), -1);
+  double known_ms = 0, known_estimate = 0;
+  for (size_t i = 0; i < keys.size(); i++) {
+    if (Get(keys[i], &costs[i])) {
+      known_ms += costs[i];
+      known_estimate += estimates[i];
+    } else {
+      costs[i] = -1;
+    }
+  }
+  const double scale = (known_estimate > 0) ? known_ms / known_estimate : 1;
+  for (size_t i = 0; i < keys.size(); i++) {
+    if (costs[i] < 0) {
+      costs[i] = estimates[i] * scale;
+    }
+  }
+  return costs;
+}
+
+void TaskCostHistory::Save() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  const std::string tmp_filename = filename_ + ".tmp";
+  {
+    std::ofstream out(tmp_filename, std::ios::trunc);
+    for (const auto& it : costs_) {
+      out << it.first << '\t' << it.second << '\n';
+    }
+    if (out.fail()) {
+      LOG(WARNING) << "Could not write " << tmp_filename;
+      return;
+    }
+  }
+  if (rename(tmp_filename.c_str(), filename_.c_str()) != 0) {
+    LOG(WARNING) << "Could not write " << filename_;
+  }
+}
@@ -0,0 +1,82 @@
+/*
+   Copyright 2018 Software Reliability Lab, ETH Zurich
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#ifndef UTIL_THREAD_COST_SCHEDULER_H_
+#define UTIL_THREAD_COST_SCHEDULER_H_
+
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+struct ThreadUtilization {
+  ThreadUtilization() : tasks(0), stolen(0), busy_ms(0), wall_ms(0) {
+  }
+
+  int tasks;
+  // Tasks taken from the queue of another thread
+  int stolen;
+  double busy_ms;
+  double wall_ms;
+};
+
+// Runs tasks with very different costs (e.g., synthesis of apps) on a fixed number of threads.
+// The tasks are started in the order of decreasing predicted cost such that the expensive tasks do not end up
+// last. Each thread has its own queue and takes the cheapest remaining tasks of other threads once its queue is empty.
+class CostScheduler {
+public:
+  // 0 threads uses one per core
+  explicit CostScheduler(int num_threads = 0);
+
+  int num_threads() const {
+    return num_threads_;
+  }
+
+  // Calls fn(task, thread) for each task in [0, costs.size()), thread is in [0, num_threads()).
+  std::vector<ThreadUtilization> Run(const std::vector<double>& costs,
+                                     const std::function<void(size_t task, int thread)>& fn) const;
+
+  static void LogUtilization(const std::vector<ThreadUtilization>& utilization);
+
+private:
+  int num_threads_;
+};
+
+// Solve times of previous runs used to predict the cost of tasks, stored as lines "<key>\t<ms>".
+class TaskCostHistory {
+public:
+  // Loads the file if it exists, Save writes to the same file.
+  explicit TaskCostHistory(const std::string& filename);
+
+  bool Get(const std::string& key, double* ms) const;
+  // Thread safe
+  void Set(const std::string& key, double ms);
+
+  // History if available, otherwise the estimate scaled by the average ratio of history to estimate
+  // of the known tasks.
+  std::vector<double> PredictCosts(const std::vector<std::string>& keys, const std::vector<double>& estimates) const;
+
+  void Save() const;
+
+private:
+  const std::string filename_;
+  mutable std::mutex mutex_;
+  std::unordered_map<std::string, double> costs_;
+};
+
+#endif /* UTIL_THREAD_COST_SCHEDULER_H_ */
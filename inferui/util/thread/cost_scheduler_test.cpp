@@ -0,0 +1,100 @@
+/*
+   Copyright 2018 Software Reliability Lab, ETH Zurich
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+ */
+
+#include <atomic>
+#include <thread>
+
+#include "gtest/gtest.h"
+#include "glog/logging.h"
+
+#include "base/test_tmpfile.h"
+#include "util/thread/cost_scheduler.h"
+
+TEST(CostSchedulerTest, RunsEachTaskOnce) {
+  CostScheduler scheduler(4);
+  std::vector<double> costs;
+  for (int i = 0; i < 1000; i++) {
+    costs.push_back(i % 17);
+  }
+  std::vector<std::atomic<int>> runs(costs.size());
+  for (auto& value : runs) {
+    value.store(0);
+  }
+  std::vector<ThreadUtilization> utilization = scheduler.Run(costs, [&](size_t task, int thread) {
+    EXPECT_GE(thread, 0);
+    EXPECT_LT(thread, 4);
+    runs[task]++;
+  });
+  for (size_t i = 0; i < runs.size(); i++) {
+    EXPECT_EQ(1, runs[i].load()) << i;
+  }
+  ASSERT_EQ(4u, utilization.size());
+  int tasks = 0;
+  for (const ThreadUtilization& stats : utilization) {
+    tasks += stats.tasks;
+  }
+  EXPECT_EQ(1000, tasks);
+}
+
+TEST(CostSchedulerTest, LargestFirstAndStealing) {
+  CostScheduler scheduler(2);
+  // One expensive task, all the cheap tasks should be taken by the other thread
+  std::vector<double> costs(20, 1);
+  costs[13] = 100;
+  std::atomic<int> started(0);
+  int expensive_start = -1;
+  std::vector<ThreadUtilization> utilization = scheduler.Run(costs, [&](size_t task, int /*thread*/) {
+    int order = started++;
+    if (task == 13) {
+      expensive_start = order;
+      usleep(200 * 1000);
+    } else {
+      usleep(1000);
+    }
+  });
+  EXPECT_LE(expensive_start, 1);
+  EXPECT_EQ(1, std::min(utilization[0].tasks, utilization[1].tasks));
+  EXPECT_GT(utilization[0].stolen + utilization[1].stolen, 0);
+  CostScheduler::LogUtilization(utilization);
+}
+
+class TaskCostHistoryTest : public TempFileTest {
+};
+
+TEST_F(TaskCostHistoryTest, SaveAndPredict) {
+  {
+    TaskCostHistory history(path);
+    history.Set("a", 100);
+    history.Set("b c", 3000);
+    history.Save();
+  }
+  TaskCostHistory history(path);
+  double ms;
+  ASSERT_TRUE(history.Get("b c", &ms));
+  EXPECT_EQ(3000, ms);
+  EXPECT_FALSE(history.Get("c", &ms));
+
+  // a has an estimate of 10 and took 100ms, so the estimate of c is scaled by 10
+  std::vector<double> costs = history.PredictCosts({"a", "c"}, {10, 5});
+  EXPECT_EQ(100, costs[0]);
+  EXPECT_EQ(50, costs[1]);
+}
+
+int main(int argc, char **argv) {
+  google::InstallFailureSignalHandler();
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}